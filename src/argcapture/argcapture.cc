@@ -0,0 +1,453 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// argcapture: LD_PRELOAD library that interposes the libm functions listed
+// in libmfuncs.def and samples their arguments into argument traces (see
+// argtrace.h), to collect the arguments real applications use:
+//
+//   LD_PRELOAD=libargcapture.so ARGCAPTURE_DIR=/tmp/args ./application
+//
+// Each thread samples into its own buffers, so the capture path takes no
+// lock, and writes its own <dir>/<program>.<pid>.<tid>.argtrace file.  The
+// options are read from the environment:
+//
+//   ARGCAPTURE_DIR:        output directory (default current directory).
+//   ARGCAPTURE_RATE:       fraction of the calls sampled, either a number in
+//                          [0, 1] or 1/N (default 1/1024).
+//   ARGCAPTURE_FUNCTIONS:  comma separated functions to capture (default
+//                          all).
+//
+// The buffers of a thread are written when they are full and when the
+// thread exits; the ones of threads still running at process exit are
+// written by the library destructor, which first stops the capture.
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "argtrace.h"
+#include "wyhash64.h"
+
+namespace
+{
+
+enum FuncId
+{
+#define LIBM_FUNC_F(name) ID_##name##f, ID_##name,
+#define LIBM_FUNC_F_F(name) LIBM_FUNC_F (name)
+#define LIBM_FUNC_F_LLI(name) LIBM_FUNC_F (name)
+#define LIBM_FUNC_F_FP_FP(name) LIBM_FUNC_F (name)
+#include "libmfuncs.def"
+#undef LIBM_FUNC_F
+#undef LIBM_FUNC_F_F
+#undef LIBM_FUNC_F_LLI
+#undef LIBM_FUNC_F_FP_FP
+  kNumFuncs
+};
+
+struct FuncInfo
+{
+  const char *name;
+  argtrace::ArgType type;
+};
+
+const FuncInfo kFuncs[] = {
+#define LIBM_FUNC_F(name)                                                     \
+  { #name "f", argtrace::F32 }, { #name, argtrace::F64 },
+#define LIBM_FUNC_F_F(name)                                                   \
+  { #name "f", argtrace::F32_F32 }, { #name, argtrace::F64_F64 },
+#define LIBM_FUNC_F_LLI(name)                                                 \
+  { #name "f", argtrace::F32_LLI }, { #name, argtrace::F64_LLI },
+#define LIBM_FUNC_F_FP_FP(name) LIBM_FUNC_F (name)
+#include "libmfuncs.def"
+#undef LIBM_FUNC_F
+#undef LIBM_FUNC_F_F
+#undef LIBM_FUNC_F_LLI
+#undef LIBM_FUNC_F_FP_FP
+};
+
+constexpr std::size_t kBufferRecords = 512;
+constexpr std::size_t kMaxRecordSize = 16;
+
+std::atomic<void *> realFuncs[kNumFuncs];
+
+// Set by the library constructor, until then (and if the configuration is
+// invalid) nothing is captured.
+bool enabled[kNumFuncs];
+std::uint64_t threshold;
+char outputDir[PATH_MAX] = ".";
+
+struct ThreadState
+{
+  wyhash64 rng;
+  int fd = -1;
+  bool failed = false;
+  std::uint8_t *buffers[kNumFuncs] = {};
+  std::uint32_t counts[kNumFuncs] = {};
+  // Set while the thread uses its buffers, see enter.
+  std::atomic<bool> busy = false;
+  ThreadState *next = nullptr;
+};
+
+std::atomic<ThreadState *> threads;
+// Set by the library destructor, which then owns all the buffers.
+std::atomic<bool> stopped;
+thread_local ThreadState *threadState;
+pthread_key_t threadKey;
+
+void
+warn (const char *msg, const char *arg)
+{
+  std::fprintf (stderr, "argcapture: %s: %s\n", msg, arg);
+}
+
+bool
+openOutput (ThreadState *ts)
+{
+  char path[PATH_MAX];
+  std::snprintf (path, sizeof (path), "%s/%s.%d.%d.argtrace", outputDir,
+		 program_invocation_short_name, static_cast<int> (getpid ()),
+		 static_cast<int> (gettid ()));
+  ts->fd = open (path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (ts->fd == -1)
+    {
+      warn (std::strerror (errno), path);
+      return false;
+    }
+  const auto header = argtrace::makeHeader ();
+  return write (ts->fd, &header, sizeof (header)) == sizeof (header);
+}
+
+void
+flush (ThreadState *ts, int id)
+{
+  if (ts->counts[id] == 0 || ts->failed)
+    return;
+  if (ts->fd == -1 && !openOutput (ts))
+    {
+      ts->failed = true;
+      return;
+    }
+
+  argtrace::BlockHeader bh{};
+  std::strncpy (bh.function, kFuncs[id].name, sizeof (bh.function) - 1);
+  bh.type = kFuncs[id].type;
+  bh.count = ts->counts[id];
+
+  struct iovec iov[2]
+      = { { &bh, sizeof (bh) },
+	  { ts->buffers[id],
+	    ts->counts[id] * argtrace::recordSize (kFuncs[id].type) } };
+  if (writev (ts->fd, iov, 2) != ssize_t (iov[0].iov_len + iov[1].iov_len))
+    ts->failed = true;
+  ts->counts[id] = 0;
+}
+
+void
+flushAll (ThreadState *ts)
+{
+  for (int id = 0; id < kNumFuncs; id++)
+    flush (ts, id);
+}
+
+// Mark the buffers of TS as in use, unless the capture was stopped.  With
+// the sequentially consistent BUSY and STOPPED accesses either the thread
+// sees STOPPED, or the destructor sees BUSY and waits for leave.
+bool
+enter (ThreadState *ts)
+{
+  ts->busy.store (true);
+  if (stopped.load ())
+    {
+      ts->busy.store (false, std::memory_order_release);
+      return false;
+    }
+  return true;
+}
+
+void
+leave (ThreadState *ts)
+{
+  ts->busy.store (false, std::memory_order_release);
+}
+
+void
+threadExit (void *p)
+{
+  ThreadState *ts = static_cast<ThreadState *> (p);
+  if (!enter (ts))
+    return;
+  flushAll (ts);
+  if (ts->fd != -1)
+    close (ts->fd);
+  // The state is kept in the list (so the destructor does not race with a
+  // removal), but it has nothing left to write.
+  ts->fd = -1;
+  ts->failed = true;
+  leave (ts);
+}
+
+ThreadState *
+newThreadState ()
+{
+  ThreadState *ts = new (std::nothrow) ThreadState;
+  if (ts == nullptr)
+    return nullptr;
+  ts->rng.seed (reinterpret_cast<std::uintptr_t> (ts) ^ gettid ());
+  ts->next = threads.load (std::memory_order_relaxed);
+  while (!threads.compare_exchange_weak (ts->next, ts,
+					 std::memory_order_release,
+					 std::memory_order_relaxed))
+    ;
+  pthread_setspecific (threadKey, ts);
+  threadState = ts;
+  return ts;
+}
+
+void
+capture (FuncId id, const void *x, std::size_t xsize, const void *y,
+	 std::size_t ysize)
+{
+  if (!enabled[id])
+    return;
+
+  ThreadState *ts = threadState;
+  if (ts == nullptr && (ts = newThreadState ()) == nullptr)
+    return;
+  if (ts->rng () > threshold || !enter (ts))
+    return;
+  if (ts->failed)
+    {
+      leave (ts);
+      return;
+    }
+
+  if (ts->buffers[id] == nullptr)
+    {
+      ts->buffers[id] = static_cast<std::uint8_t *> (
+	  std::malloc (kBufferRecords * kMaxRecordSize));
+      if (ts->buffers[id] == nullptr)
+	{
+	  leave (ts);
+	  return;
+	}
+    }
+
+  std::uint8_t *p = ts->buffers[id] + ts->counts[id] * (xsize + ysize);
+  std::memcpy (p, x, xsize);
+  if (ysize != 0)
+    std::memcpy (p + xsize, y, ysize);
+  if (++ts->counts[id] == kBufferRecords)
+    flush (ts, id);
+  leave (ts);
+}
+
+template <typename FUNC>
+FUNC
+real (FuncId id)
+{
+  void *f = realFuncs[id].load (std::memory_order_relaxed);
+  if (f == nullptr)
+    {
+      // Resolved on first use, since the functions might be called by other
+      // libraries constructors before the argcapture one.
+      f = dlsym (RTLD_NEXT, kFuncs[id].name);
+      if (f == nullptr)
+	{
+	  warn ("symbol not found", kFuncs[id].name);
+	  std::abort ();
+	}
+      realFuncs[id].store (f, std::memory_order_relaxed);
+    }
+  return reinterpret_cast<FUNC> (f);
+}
+
+template <typename F>
+F
+callF (FuncId id, F x)
+{
+  capture (id, &x, sizeof (x), nullptr, 0);
+  return real<F (*) (F)> (id) (x);
+}
+
+template <typename F>
+F
+callFF (FuncId id, F x, F y)
+{
+  capture (id, &x, sizeof (x), &y, sizeof (y));
+  return real<F (*) (F, F)> (id) (x, y);
+}
+
+template <typename F>
+F
+callFLLI (FuncId id, F x, long long int y)
+{
+  capture (id, &x, sizeof (x), &y, sizeof (y));
+  return real<F (*) (F, long long int)> (id) (x, y);
+}
+
+template <typename F>
+void
+callFpFp (FuncId id, F x, F *r0, F *r1)
+{
+  capture (id, &x, sizeof (x), nullptr, 0);
+  real<void (*) (F, F *, F *)> (id) (x, r0, r1);
+}
+
+bool
+parseRate (const char *str)
+{
+  char *end;
+  double rate;
+  if (std::strncmp (str, "1/", 2) == 0)
+    {
+      unsigned long long n = std::strtoull (str + 2, &end, 10);
+      if (*end != '\0' || n == 0)
+	return false;
+      rate = 1.0 / n;
+    }
+  else
+    {
+      rate = std::strtod (str, &end);
+      if (*end != '\0' || !(rate >= 0.0 && rate <= 1.0))
+	return false;
+    }
+  threshold = rate >= 1.0 ? UINT64_MAX
+			  : static_cast<std::uint64_t> (rate * 0x1p64);
+  return rate > 0.0;
+}
+
+bool
+parseFunctions (const char *str)
+{
+  if (str == nullptr)
+    {
+      for (int id = 0; id < kNumFuncs; id++)
+	enabled[id] = true;
+      return true;
+    }
+
+  while (*str != '\0')
+    {
+      std::size_t len = std::strcspn (str, ",");
+      bool found = false;
+      for (int id = 0; id < kNumFuncs; id++)
+	if (std::strlen (kFuncs[id].name) == len
+	    && std::strncmp (kFuncs[id].name, str, len) == 0)
+	  found = enabled[id] = true;
+      if (!found)
+	{
+	  warn ("invalid function list", str);
+	  return false;
+	}
+      str += len + (str[len] == ',');
+    }
+  return true;
+}
+
+void
+atforkChild ()
+{
+  // The child does not write the parent buffers.
+  threads.store (nullptr, std::memory_order_relaxed);
+  threadState = nullptr;
+}
+
+__attribute__ ((constructor)) void
+argcaptureInit ()
+{
+  const char *rate = std::getenv ("ARGCAPTURE_RATE");
+  if (!parseRate (rate != nullptr ? rate : "1/1024"))
+    {
+      if (rate != nullptr && std::strcmp (rate, "0") != 0)
+	warn ("invalid rate", rate);
+      return;
+    }
+
+  if (const char *dir = std::getenv ("ARGCAPTURE_DIR"))
+    std::snprintf (outputDir, sizeof (outputDir), "%s", dir);
+
+  if (pthread_key_create (&threadKey, threadExit) != 0)
+    return;
+  pthread_atfork (nullptr, nullptr, atforkChild);
+
+  if (!parseFunctions (std::getenv ("ARGCAPTURE_FUNCTIONS")))
+    for (int id = 0; id < kNumFuncs; id++)
+      enabled[id] = false;
+}
+
+__attribute__ ((destructor)) void
+argcaptureFini ()
+{
+  // The threads still running stop capturing, and the ones in the middle
+  // of a capture (or of their exit flush) finish it before their buffers
+  // are written.
+  stopped.store (true);
+  for (ThreadState *ts = threads.load (std::memory_order_acquire);
+       ts != nullptr; ts = ts->next)
+    {
+      while (ts->busy.load (std::memory_order_acquire))
+	sched_yield ();
+      flushAll (ts);
+    }
+}
+
+} // anonymous namespace
+
+//
+// The interposed symbols.
+//
+
+extern "C"
+{
+#define LIBM_FUNC_F(name)                                                     \
+  float name##f (float x) noexcept { return callF (ID_##name##f, x); }        \
+  double name (double x) noexcept { return callF (ID_##name, x); }
+#define LIBM_FUNC_F_F(name)                                                   \
+  float name##f (float x, float y) noexcept                                   \
+  {                                                                           \
+    return callFF (ID_##name##f, x, y);                                       \
+  }                                                                           \
+  double name (double x, double y) noexcept                                   \
+  {                                                                           \
+    return callFF (ID_##name, x, y);                                          \
+  }
+#define LIBM_FUNC_F_LLI(name)                                                 \
+  float name##f (float x, long long int y) noexcept                           \
+  {                                                                           \
+    return callFLLI (ID_##name##f, x, y);                                     \
+  }                                                                           \
+  double name (double x, long long int y) noexcept                            \
+  {                                                                           \
+    return callFLLI (ID_##name, x, y);                                        \
+  }
+#define LIBM_FUNC_F_FP_FP(name)                                               \
+  void name##f (float x, float *r0, float *r1) noexcept                       \
+  {                                                                           \
+    callFpFp (ID_##name##f, x, r0, r1);                                       \
+  }                                                                           \
+  void name (double x, double *r0, double *r1) noexcept                       \
+  {                                                                           \
+    callFpFp (ID_##name, x, r0, r1);                                          \
+  }
+#include "libmfuncs.def"
+#undef LIBM_FUNC_F
+#undef LIBM_FUNC_F_F
+#undef LIBM_FUNC_F_LLI
+#undef LIBM_FUNC_F_FP_FP
+}
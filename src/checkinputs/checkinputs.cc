@@ -5,12 +5,30 @@
 //
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <fstream>
 #include <limits>
+#include <map>
+#include <optional>
 #include <string>
+#include <unordered_map>
 
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "argtrace.h"
 #include "floatranges.h"
+#include "hyperloglog.h"
 #include "iohelper.h"
+#include "refimpls.h"
 #include "strhelper.h"
 
 #include <argparse/argparse.hpp>
@@ -272,6 +290,781 @@ check_f_f_f (const std::string &input, bool ignore_errors)
     }
 }
 
+template <typename T>
+static void
+print_args (const std::string &name, const std::vector<T> &numbers)
+{
+  auto minmaxt = std::minmax_element (numbers.begin (), numbers.end ());
+  if constexpr (std::is_floating_point_v<T>)
+    std::println ("{0:20}: min={1:a} ({1:g}) max={2:a} ({2:g}) count={3}",
+		  name, *minmaxt.first, *minmaxt.second, numbers.size ());
+  else
+    std::println ("{0:20}: min={1} max={2} count={3}", name, *minmaxt.first,
+		  *minmaxt.second, numbers.size ());
+}
+
+template <typename X, typename Y>
+static void
+check_argtrace_args (const std::string &name,
+		     const std::vector<argtrace::Args> &args, bool has_y)
+{
+  std::vector<X> numbers_x;
+  std::vector<Y> numbers_y;
+  for (const auto &a : args)
+    {
+      numbers_x.push_back (a.first<X> ());
+      if (has_y)
+	numbers_y.push_back (a.second<Y> ());
+    }
+
+  print_args (name, numbers_x);
+  if (has_y)
+    print_args ("", numbers_y);
+}
+
+// Summarize the arguments of each function captured by argcapture (see
+// argtrace.h), INPUT is either a trace file or a directory.
+static void
+check_argtrace (const std::string &input)
+{
+  std::map<std::string, std::pair<std::uint32_t,
+				  std::vector<argtrace::Args> > > functions;
+  for (const auto &fileName : argtrace::traceFiles (input))
+    {
+      auto reader = argtrace::Reader::open (fileName);
+      if (!reader)
+	error ("{}", reader.error ());
+      for (const auto &b : reader->blocks ())
+	{
+	  auto &f = functions[std::string (b.function)];
+	  f.first = b.type;
+	  for (std::uint32_t i = 0; i < b.count; i++)
+	    f.second.push_back (b[i]);
+	}
+    }
+
+  for (const auto &[name, f] : functions)
+    switch (f.first)
+      {
+      case argtrace::F32:
+      case argtrace::F32_F32:
+	check_argtrace_args<float, float> (name, f.second,
+					   f.first == argtrace::F32_F32);
+	break;
+      case argtrace::F64:
+      case argtrace::F64_F64:
+	check_argtrace_args<double, double> (name, f.second,
+					     f.first == argtrace::F64_F64);
+	break;
+      case argtrace::F32_LLI:
+	check_argtrace_args<float, long long int> (name, f.second, true);
+	break;
+      case argtrace::F64_LLI:
+	check_argtrace_args<double, long long int> (name, f.second, true);
+	break;
+      }
+}
+
+//
+// Code path classification (--function): each input of a workload is
+// evaluated with the libm function under test (through the refimpls
+// tables) and classified as special (non-finite or zero inputs, or
+// non-finite, zero or subnormal results), or by its latency relative to the
+// workload median as fast, slow (above --slow-factor) or accurate (above
+// --accurate-factor, the multiple precision fallbacks).
+//
+
+enum class Path
+{
+  FAST,
+  SPECIAL,
+  SLOW,
+  ACCURATE
+};
+
+static constexpr std::array<std::string_view, 4> kPathNames
+    = { "fast", "special", "slow", "accurate" };
+
+struct PathOptions
+{
+  int repeat;
+  double slowFactor;
+  double accurateFactor;
+  std::vector<Path> required;
+};
+
+struct Workload
+{
+  std::string name;
+  std::vector<std::vector<std::string> > inputs;
+};
+
+static std::vector<Workload>
+read_workloads (const std::string &input)
+{
+  std::ifstream file (input);
+  if (!file.is_open ())
+    error ("opening file {}", input);
+
+  std::vector<Workload> workloads = { { "default" } };
+
+  std::string line;
+  for (int line_number = 1; std::getline (file, line); line_number++)
+    {
+      if (line.starts_with ("##"))
+	{
+	  auto fields = strhelper::splitWithRanges (line.substr (2), ":");
+	  if (fields.size () < 2)
+	    error ("line {} invalid directive: {}", line_number, line);
+	  if (strhelper::trim (fields[0]).starts_with ("name"))
+	    workloads.push_back (Workload{ std::string (
+		strhelper::trim (fields[1])) });
+	  continue;
+	}
+
+      // Skip blank lines and comments.
+      strhelper::trim (line);
+      if (line.empty () || line.starts_with ("#"))
+	continue;
+
+      auto numbers = strhelper::splitWithRanges (line, ",");
+      for (auto &n : numbers)
+	strhelper::trim (n);
+      workloads.back ().inputs.push_back (numbers);
+    }
+
+  return workloads;
+}
+
+template <typename T>
+static T
+parse_input (const Workload &w, std::size_t i, std::size_t arg)
+{
+  if (w.inputs[i].size () <= arg)
+    error ("workload {}: input {} has only {} numbers", w.name, i,
+	   w.inputs[i].size ());
+  const std::string &s = w.inputs[i][arg];
+  if constexpr (std::is_floating_point_v<T>)
+    {
+      auto n = floatrange::fromStr<T> (s);
+      if (!n)
+	error ("workload {}: invalid number {}: {}", w.name, s, n.error ());
+      return n.value ();
+    }
+  else
+    {
+      T v;
+      auto [p, ec] = std::from_chars (s.data (), s.data () + s.size (), v);
+      if (ec != std::errc () || p != s.data () + s.size ())
+	error ("workload {}: invalid integer {}", w.name, s);
+      return v;
+    }
+}
+
+template <typename F>
+static bool
+special_input (F x)
+{
+  return !std::isfinite (x) || x == F (0);
+}
+
+template <typename F>
+static bool
+special_result (F r)
+{
+  return !std::isnormal (r);
+}
+
+// Minimum over a few trials of the mean latency of REPEAT calls of EVAL,
+// in nanoseconds.
+template <typename EVAL>
+static double
+time_input (const EVAL &eval, int repeat)
+{
+  double best = std::numeric_limits<double>::infinity ();
+  for (int t = 0; t < 3; t++)
+    {
+      auto start = std::chrono::steady_clock::now ();
+      for (int r = 0; r < repeat; r++)
+	eval ();
+      auto end = std::chrono::steady_clock::now ();
+      best = std::min (
+	  best, std::chrono::duration<double, std::nano> (end - start).count ()
+		    / repeat);
+    }
+  return best;
+}
+
+// Classify the N inputs of workload NAME, where EVAL (I) evaluates the
+// input I and returns whether it is a special case.  Returns false if the
+// workload misses one of the required paths.
+template <typename EVAL>
+static bool
+classify_workload (const std::string &name, std::size_t n, const EVAL &eval,
+		   const PathOptions &opts)
+{
+  if (n == 0)
+    return true;
+
+  std::vector<bool> special (n);
+  std::vector<double> latency (n);
+  for (std::size_t i = 0; i < n; i++)
+    {
+      special[i] = eval (i);
+      latency[i] = time_input ([&] { eval (i); }, opts.repeat);
+    }
+
+  std::vector<double> regular;
+  for (std::size_t i = 0; i < n; i++)
+    if (!special[i])
+      regular.push_back (latency[i]);
+  double median = 0.0;
+  if (!regular.empty ())
+    {
+      auto mid = regular.begin () + regular.size () / 2;
+      std::nth_element (regular.begin (), mid, regular.end ());
+      median = *mid;
+    }
+
+  std::array<std::size_t, kPathNames.size ()> counts = {};
+  for (std::size_t i = 0; i < n; i++)
+    {
+      Path p = Path::FAST;
+      if (special[i])
+	p = Path::SPECIAL;
+      else if (latency[i] > median * opts.accurateFactor)
+	p = Path::ACCURATE;
+      else if (latency[i] > median * opts.slowFactor)
+	p = Path::SLOW;
+      counts[static_cast<std::size_t> (p)]++;
+    }
+
+  std::string report;
+  for (std::size_t p = 0; p < counts.size (); p++)
+    report += std::format (" {}={:.1f}%", kPathNames[p],
+			   100.0 * counts[p] / n);
+  std::println ("{:20}: count={}{} (median {:.1f} ns)", name, n, report,
+		median);
+
+  bool ok = true;
+  for (Path p : opts.required)
+    if (counts[static_cast<std::size_t> (p)] == 0)
+      {
+	std::println ("{:20}: never reaches the {} path", name,
+		      kPathNames[static_cast<std::size_t> (p)]);
+	ok = false;
+      }
+  return ok;
+}
+
+// Keep the results alive, so the timed calls are not removed.
+template <typename F>
+static void
+sink (F r)
+{
+  static volatile F s;
+  s = r;
+}
+
+// FUNC, the libc FUNCTION, which might be missing (the refimpls libc
+// symbols are weak).
+template <typename FUNC>
+static FUNC
+libc_function (FUNC func, const std::string &function)
+{
+  if (func == nullptr)
+    error ("libc does not provide {}", function);
+  return func;
+}
+
+template <typename F>
+static bool
+classify_f (const std::vector<Workload> &workloads,
+	    const std::string &function, const PathOptions &opts)
+{
+  auto func = libc_function (
+      refimpls::getFunctionFloat<F> (function).value ().first, function);
+  bool ok = true;
+  for (const auto &w : workloads)
+    {
+      std::vector<F> x (w.inputs.size ());
+      for (std::size_t i = 0; i < x.size (); i++)
+	x[i] = parse_input<F> (w, i, 0);
+      ok &= classify_workload (
+	  w.name, x.size (),
+	  [&] (std::size_t i) {
+	    F r = func (x[i]);
+	    sink (r);
+	    return special_input (x[i]) || special_result (r);
+	  },
+	  opts);
+    }
+  return ok;
+}
+
+template <typename F>
+static bool
+classify_f_fp_fp (const std::vector<Workload> &workloads,
+		  const std::string &function, const PathOptions &opts)
+{
+  auto func = libc_function (
+      refimpls::getFunctionFloatpFloatp<F> (function).value ().first,
+      function);
+  bool ok = true;
+  for (const auto &w : workloads)
+    {
+      std::vector<F> x (w.inputs.size ());
+      for (std::size_t i = 0; i < x.size (); i++)
+	x[i] = parse_input<F> (w, i, 0);
+      ok &= classify_workload (
+	  w.name, x.size (),
+	  [&] (std::size_t i) {
+	    F r0, r1;
+	    func (x[i], &r0, &r1);
+	    sink (r0 + r1);
+	    return special_input (x[i]) || special_result (r0)
+		   || special_result (r1);
+	  },
+	  opts);
+    }
+  return ok;
+}
+
+template <typename F, typename Y, typename FUNC>
+static bool
+classify_f_y (const std::vector<Workload> &workloads, FUNC func,
+	      const std::string &function, const PathOptions &opts)
+{
+  libc_function (func, function);
+  bool ok = true;
+  for (const auto &w : workloads)
+    {
+      std::vector<F> x (w.inputs.size ());
+      std::vector<Y> y (w.inputs.size ());
+      for (std::size_t i = 0; i < x.size (); i++)
+	{
+	  x[i] = parse_input<F> (w, i, 0);
+	  y[i] = parse_input<Y> (w, i, 1);
+	}
+      ok &= classify_workload (
+	  w.name, x.size (),
+	  [&] (std::size_t i) {
+	    F r = func (x[i], y[i]);
+	    sink (r);
+	    bool special = special_input (x[i]) || special_result (r);
+	    if constexpr (std::is_floating_point_v<Y>)
+	      special |= special_input (y[i]);
+	    return special;
+	  },
+	  opts);
+    }
+  return ok;
+}
+
+static std::vector<Path>
+parse_paths (const std::string &str)
+{
+  std::vector<Path> ret;
+  for (const auto &name : strhelper::splitWithRanges (str, ","))
+    {
+      auto it = std::find (kPathNames.begin (), kPathNames.end (),
+			   strhelper::trim (name));
+      if (it == kPathNames.end ())
+	error ("invalid path: {} (expected one of fast, special, slow, "
+	       "accurate)",
+	       name);
+      ret.push_back (static_cast<Path> (it - kPathNames.begin ()));
+    }
+  return ret;
+}
+
+static bool
+classify_function (const std::string &input, const std::string &function,
+		   const PathOptions &opts)
+{
+  auto type = refimpls::getFunctionType (function);
+  if (!type)
+    error ("invalid function: {}", function);
+
+  const auto workloads = read_workloads (input);
+  switch (type.value ())
+    {
+    case refimpls::FunctionType::f32_f:
+      return classify_f<float> (workloads, function, opts);
+    case refimpls::FunctionType::f64_f:
+      return classify_f<double> (workloads, function, opts);
+    case refimpls::FunctionType::f32_f_fp_fp:
+      return classify_f_fp_fp<float> (workloads, function, opts);
+    case refimpls::FunctionType::f64_f_fp_fp:
+      return classify_f_fp_fp<double> (workloads, function, opts);
+    case refimpls::FunctionType::f32_f_f:
+      return classify_f_y<float, float> (
+	  workloads,
+	  refimpls::getFunctionFloatFloat<float> (function).value ().first,
+	  function, opts);
+    case refimpls::FunctionType::f64_f_f:
+      return classify_f_y<double, double> (
+	  workloads,
+	  refimpls::getFunctionFloatFloat<double> (function).value ().first,
+	  function, opts);
+    case refimpls::FunctionType::f32_f_lli:
+      return classify_f_y<float, long long int> (
+	  workloads,
+	  refimpls::getFunctionFloatLLI<float> (function).value ().first,
+	  function, opts);
+    case refimpls::FunctionType::f64_f_lli:
+      return classify_f_y<double, long long int> (
+	  workloads,
+	  refimpls::getFunctionFloatLLI<double> (function).value ().first,
+	  function, opts);
+    }
+  std::unreachable ();
+}
+
+//
+// Workload statistics (--stats): for each workload the estimated number of
+// distinct inputs (HyperLogLog), the estimated histogram of the distance
+// (in inputs) to the previous occurrence of the same input, the entropy of
+// the input binades (the sign and exponent of every argument), the fraction
+// of inputs in the same binades as the previous one, and a predictability
+// score (the mean of the duplicate fraction, the same binade fraction, and
+// one minus the binade entropy normalized to its maximum for the workload
+// size).
+//
+// The repeat distances are tracked in bounded memory on a sample of the
+// inputs, selected by their hash: the inputs whose hash has at least LEVEL
+// trailing zero bits, LEVEL being raised whenever more than kRepeatSamples
+// distinct inputs are tracked.  The counts are scaled by 2^LEVEL.
+//
+// The files are memory mapped and parsed in parallel chunks of lines, and
+// the workloads are then reduced in parallel.
+//
+
+struct InputRecord
+{
+  std::uint64_t hash;
+  std::uint64_t binade;
+};
+
+struct InputChunk
+{
+  std::vector<InputRecord> records;
+  // Workload names, with the index of their first record in the chunk.
+  std::vector<std::pair<std::size_t, std::string> > names;
+  std::size_t invalid = 0;
+};
+
+// Sign and exponent class of X, with distinct classes for zero, infinity
+// and NaN.
+template <typename F>
+static std::uint64_t
+binade_class (F x)
+{
+  const std::uint64_t sign = std::signbit (x) ? 1 << 16 : 0;
+  if (std::isnan (x))
+    return sign | 0xffff;
+  if (std::isinf (x))
+    return sign | 0xfffe;
+  if (x == F (0))
+    return sign;
+  return sign | (std::ilogb (x) + 0x8000);
+}
+
+template <typename F>
+static std::optional<F>
+parse_number (std::string_view s)
+{
+  bool negative = false;
+  if (s.starts_with ("\\-"))
+    {
+      s.remove_prefix (2);
+      negative = true;
+    }
+  else if (s.starts_with ('-'))
+    {
+      s.remove_prefix (1);
+      negative = true;
+    }
+  if (s.ends_with ('f') || s.ends_with ('F'))
+    s.remove_suffix (1);
+
+  F v;
+  std::from_chars_result r;
+  if (s.starts_with ("0x") || s.starts_with ("0X"))
+    r = std::from_chars (s.data () + 2, s.data () + s.size (), v,
+			 std::chars_format::hex);
+  else
+    r = std::from_chars (s.data (), s.data () + s.size (), v);
+  if (r.ec != std::errc () || r.ptr != s.data () + s.size ())
+    return std::nullopt;
+  return negative ? -v : v;
+}
+
+template <typename F>
+static void
+parse_chunk (const char *begin, const char *end, InputChunk &chunk)
+{
+  typedef std::conditional_t<sizeof (F) == 4, std::uint32_t, std::uint64_t>
+      UInt;
+
+  for (const char *p = begin; p < end;)
+    {
+      const char *nl
+	  = static_cast<const char *> (std::memchr (p, '\n', end - p));
+      const char *eol = nl != nullptr ? nl : end;
+      std::string line (p, eol);
+      p = eol + 1;
+
+      if (line.starts_with ("##"))
+	{
+	  auto fields = strhelper::splitWithRanges (line.substr (2), ":");
+	  if (fields.size () >= 2
+	      && strhelper::trim (fields[0]).starts_with ("name"))
+	    chunk.names.emplace_back (chunk.records.size (),
+				      strhelper::trim (fields[1]));
+	  continue;
+	}
+
+      strhelper::trim (line);
+      if (line.empty () || line.starts_with ("#"))
+	continue;
+
+      InputRecord r{ 0, 0 };
+      bool valid = true;
+      unsigned arg = 0;
+      for (auto &field : strhelper::splitWithRanges (line, ","))
+	{
+	  auto x = parse_number<F> (strhelper::trim (field));
+	  if (!x)
+	    {
+	      valid = false;
+	      break;
+	    }
+	  r.hash = HyperLogLog<>::mix (r.hash ^ std::bit_cast<UInt> (*x));
+	  r.binade |= binade_class (*x) << (17 * arg++);
+	}
+      if (valid)
+	chunk.records.push_back (r);
+      else
+	chunk.invalid++;
+    }
+}
+
+struct WorkloadStats
+{
+  std::string name;
+  std::size_t count = 0;
+  double distinct = 0.0;
+  // Repeat distances: bucket B counts distances in [2^B, 2^(B+1)).
+  std::array<std::size_t, 24> repeat = {};
+  std::size_t firstSeen = 0;
+  double entropy = 0.0;
+  std::size_t binades = 0;
+  double sameBinade = 0.0;
+  double predictability = 0.0;
+};
+
+// Inputs tracked for the repeat distances of a workload.
+static constexpr std::size_t kRepeatSamples = 1 << 16;
+
+static WorkloadStats
+workload_stats (const std::string &name, const InputRecord *records,
+		std::size_t n)
+{
+  WorkloadStats s;
+  s.name = name;
+  s.count = n;
+
+  HyperLogLog<> hll;
+  std::unordered_map<std::uint64_t, std::size_t> binades;
+  std::size_t same = 0;
+
+  // The repeat distances and first occurrences by the number of trailing
+  // zero bits of the input hash, so the counts of the inputs dropped from
+  // the sample when LEVEL is raised can be discarded.
+  static constexpr unsigned kLevels = 65;
+  std::unordered_map<std::uint64_t, std::size_t> last;
+  std::vector<decltype (s.repeat)> repeat (kLevels);
+  std::array<std::size_t, kLevels> firstSeen = {};
+  unsigned level = 0;
+
+  for (std::size_t i = 0; i < n; i++)
+    {
+      const std::uint64_t hash = records[i].hash;
+      hll.add (hash);
+      binades[records[i].binade]++;
+      if (i > 0 && records[i].binade == records[i - 1].binade)
+	same++;
+
+      const unsigned zeros = std::countr_zero (hash);
+      if (zeros < level)
+	continue;
+      auto [it, inserted] = last.try_emplace (hash, i);
+      if (inserted)
+	firstSeen[zeros]++;
+      else
+	{
+	  const std::size_t b = std::bit_width (i - it->second) - 1;
+	  repeat[zeros][std::min (b, s.repeat.size () - 1)]++;
+	  it->second = i;
+	}
+      while (last.size () > kRepeatSamples)
+	{
+	  level++;
+	  std::erase_if (last, [level] (const auto &e) {
+	    return std::countr_zero (e.first) < static_cast<int> (level);
+	  });
+	}
+    }
+
+  for (unsigned z = level; z < kLevels; z++)
+    {
+      s.firstSeen += firstSeen[z] << level;
+      for (std::size_t b = 0; b < s.repeat.size (); b++)
+	s.repeat[b] += repeat[z][b] << level;
+    }
+
+  s.distinct = std::min (hll.estimate (), static_cast<double> (n));
+  s.binades = binades.size ();
+  for (const auto &[c, count] : binades)
+    {
+      const double p = static_cast<double> (count) / n;
+      s.entropy -= p * std::log2 (p);
+    }
+  s.sameBinade = n > 1 ? static_cast<double> (same) / (n - 1) : 1.0;
+
+  const double maxEntropy = std::log2 (static_cast<double> (n));
+  const double entropyScore
+      = maxEntropy > 0.0 ? 1.0 - std::min (s.entropy / maxEntropy, 1.0) : 1.0;
+  s.predictability
+      = ((1.0 - s.distinct / n) + s.sameBinade + entropyScore) / 3.0;
+  return s;
+}
+
+template <typename F>
+static std::vector<WorkloadStats>
+stats_file (const std::string &input)
+{
+  int fd = open (input.c_str (), O_RDONLY);
+  if (fd == -1)
+    error ("{}: {}", input, std::strerror (errno));
+  struct stat st;
+  if (fstat (fd, &st) == -1)
+    error ("{}: {}", input, std::strerror (errno));
+  const std::size_t size = st.st_size;
+  const char *data = "";
+  if (size != 0)
+    {
+      void *m = mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m == MAP_FAILED)
+	error ("{}: mmap: {}", input, std::strerror (errno));
+      madvise (m, size, MADV_SEQUENTIAL);
+      data = static_cast<const char *> (m);
+    }
+  close (fd);
+
+  // Split the file in chunks of whole lines: each chunk starts after the
+  // first newline at or past its nominal start.
+  static constexpr std::size_t kMinChunk = 1 << 16;
+  const std::size_t nchunks = std::clamp<std::size_t> (
+      size / kMinChunk, 1, 4 * omp_get_max_threads ());
+  auto boundary = [&] (std::size_t c) -> std::size_t {
+    if (c == 0)
+      return 0;
+    if (c == nchunks)
+      return size;
+    const char *nl = static_cast<const char *> (std::memchr (
+	data + c * size / nchunks - 1, '\n', size - c * size / nchunks + 1));
+    return nl != nullptr ? nl - data + 1 : size;
+  };
+
+  std::vector<InputChunk> chunks (nchunks);
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t c = 0; c < nchunks; c++)
+    {
+      const std::size_t b = boundary (c), e = boundary (c + 1);
+      if (b < e)
+	parse_chunk<F> (data + b, data + e, chunks[c]);
+    }
+
+  if (size != 0)
+    munmap (const_cast<char *> (data), size);
+
+  // Join the chunks and split the records by workload.
+  std::vector<InputRecord> records;
+  std::vector<std::pair<std::size_t, std::string> > names
+      = { { 0, "default" } };
+  std::size_t invalid = 0;
+  for (auto &c : chunks)
+    {
+      for (auto &[i, name] : c.names)
+	names.emplace_back (records.size () + i, std::move (name));
+      records.insert (records.end (), c.records.begin (), c.records.end ());
+      invalid += c.invalid;
+    }
+  if (invalid != 0)
+    std::println ("{}: {} lines with invalid numbers ignored", input,
+		  invalid);
+
+  std::vector<WorkloadStats> stats (names.size ());
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t w = 0; w < names.size (); w++)
+    {
+      const std::size_t b = names[w].first;
+      const std::size_t e
+	  = w + 1 < names.size () ? names[w + 1].first : records.size ();
+      stats[w] = workload_stats (names[w].second, records.data () + b, e - b);
+    }
+
+  std::erase_if (stats, [] (const WorkloadStats &s) { return s.count == 0; });
+  return stats;
+}
+
+static void
+print_stats (const WorkloadStats &s)
+{
+  std::println ("{:20}: count={} distinct~{:.0f} ({:.1f}%) binades={} "
+		"entropy={:.2f} bits same-binade={:.1f}% "
+		"predictability={:.2f}",
+		s.name, s.count, s.distinct, 100.0 * s.distinct / s.count,
+		s.binades, s.entropy, 100.0 * s.sameBinade, s.predictability);
+
+  std::string repeat;
+  for (std::size_t b = 0; b < s.repeat.size (); b++)
+    if (s.repeat[b] != 0)
+      repeat += std::format (" {}{}:{}", UINT64_C (1) << b,
+			     b + 1 == s.repeat.size () ? "+" : "",
+			     s.repeat[b]);
+  std::println ("{:20}  repeat distance:{} first:{}", "", repeat,
+		s.firstSeen);
+}
+
+// Print the statistics of the workloads of INPUTS and return whether all
+// their predictability scores are at most MAX.
+template <typename F>
+static bool
+check_stats (const std::vector<std::string> &inputs, double max)
+{
+  bool ok = true;
+  for (const auto &input : inputs)
+    {
+      if (inputs.size () > 1)
+	std::println ("{}:", input);
+      for (const auto &s : stats_file<F> (input))
+	{
+	  print_stats (s);
+	  if (s.predictability > max)
+	    {
+	      std::println ("{:20}  rejected: predictability {:.2f} above "
+			    "{:.2f}",
+			    "", s.predictability, max);
+	      ok = false;
+	    }
+	}
+    }
+  return ok;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -295,11 +1088,54 @@ main (int argc, char *argv[])
       .store_into (ignore_errors)
       .flag ();
 
-  std::string input;
+  bool argtrace;
+  options.add_argument ("--argtrace")
+      .help ("input is an argcapture trace file or directory")
+      .store_into (argtrace)
+      .flag ();
+
+  options.add_argument ("--function", "-f")
+      .help ("classify the inputs of each workload by the code path they "
+	     "take in the libm function (fast, special, slow or accurate)");
+
+  options.add_argument ("--repeat")
+      .help ("calls of each input timed by --function")
+      .default_value (16)
+      .scan<'i', int> ();
+
+  options.add_argument ("--slow-factor")
+      .help ("latency over the workload median of the slow path")
+      .default_value (2.0)
+      .scan<'g', double> ();
+
+  options.add_argument ("--accurate-factor")
+      .help ("latency over the workload median of the accurate path")
+      .default_value (8.0)
+      .scan<'g', double> ();
+
+  options.add_argument ("--require-path")
+      .help ("flag (and fail for) the workloads that never reach these "
+	     "paths, as a comma separated list");
+
+  bool stats;
+  options.add_argument ("--stats")
+      .help ("report the duplication, repeat distance, binade entropy and "
+	     "predictability of each workload")
+      .store_into (stats)
+      .flag ();
+
+  options.add_argument ("--max-predictability")
+      .help ("with --stats, reject (and fail for) the workloads with a "
+	     "higher predictability score")
+      .default_value (1.0)
+      .scan<'g', double> ();
+
+  std::vector<std::string> inputs;
   options.add_argument ("input")
-      .help ("glibc benchtest input file to parse")
-      .nargs (1)
-      .store_into (input)
+      .help ("glibc benchtest input file to parse (--stats accepts "
+	     "several)")
+      .nargs (argparse::nargs_pattern::at_least_one)
+      .store_into (inputs)
       .required ();
 
   try
@@ -311,6 +1147,44 @@ main (int argc, char *argv[])
       error (std::string (err.what ()));
     }
 
+  if (stats)
+    {
+      const double max = options.get<double> ("--max-predictability");
+      bool ok;
+      if (type == "binary32")
+	ok = check_stats<float> (inputs, max);
+      else if (type == "binary64")
+	ok = check_stats<double> (inputs, max);
+      else
+	error ("invalid type for --stats: {}", type);
+      return ok ? 0 : 1;
+    }
+
+  if (inputs.size () != 1)
+    error ("only --stats accepts multiple inputs ({} given)", inputs.size ());
+  const std::string &input = inputs[0];
+
+  if (argtrace)
+    {
+      check_argtrace (input);
+      return 0;
+    }
+
+  if (auto function = options.present ("--function"))
+    {
+      PathOptions opts{ options.get<int> ("--repeat"),
+			options.get<double> ("--slow-factor"),
+			options.get<double> ("--accurate-factor"),
+			{} };
+      if (opts.repeat <= 0 || opts.slowFactor <= 1.0
+	  || opts.accurateFactor < opts.slowFactor)
+	error ("invalid --repeat or path factors ({}, {}, {})", opts.repeat,
+	       opts.slowFactor, opts.accurateFactor);
+      if (auto paths = options.present ("--require-path"))
+	opts.required = parse_paths (*paths);
+      return classify_function (input, *function, opts) ? 0 : 1;
+    }
+
   int nargs = options.get<int>("-n");
   if (nargs < 0 || nargs > 3)
     error ("invalid number of arguments ({})", nargs);
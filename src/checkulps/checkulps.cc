@@ -5,8 +5,10 @@
 //
 
 #include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <numbers>
+#include <numeric>
 #include <random>
 #include <ranges>
 
@@ -15,12 +17,26 @@
 #include <fenv.h>
 #include <omp.h>
 
+#include "argtrace.h"
+#include "corpus.h"
 #include "description.h"
 #include "floatranges.h"
+#include "fuzzinput.h"
+#include "goldentable.h"
+#include "hotspots.h"
 #include "iohelper.h"
+#include "libmtest.h"
+#include "lowdiscrepancy.h"
+#include "mpicheck.h"
 #include "refimpls.h"
+#include "snapshot.h"
+#include "tracefile.h"
+#include "worstcases.h"
 #include "wyhash64.h"
 #include "strhelper.h"
+#include "ulpcheck.h"
+#include "ulpkernel.h"
+#include "ulpsearch.h"
 
 // This is the threshold used by glibc that triggers a failure.
 static constexpr auto kMaxUlpStr = "0.0";
@@ -31,38 +47,6 @@ typedef wyhash64 RngType;
 
 using ClockType = std::chrono::high_resolution_clock;
 
-//
-// isSignaling: C11 macro that returns if a number is a signaling NaN.
-//
-
-template <std::floating_point T> bool isSignaling (T);
-
-template <>
-bool
-isSignaling<float> (float x)
-{
-  union
-  {
-    float f;
-    std::uint32_t u;
-  } n = { .f = x };
-  n.u ^= 0x00400000;
-  return (n.u & 0x7fffffff) > 0x7fc00000;
-}
-
-template <>
-bool
-isSignaling<double> (double x)
-{
-  union
-  {
-    double f;
-    std::uint64_t u;
-  } n = { .f = x };
-  n.u ^= UINT64_C (0x0008000000000000);
-  return (n.u & UINT64_C (0x7fffffffffffffff)) > UINT64_C (0x7ff8000000000000);
-}
-
 //
 // RoundMode: a class wrapper over C99 rounding modes, used to select which
 //               one to test.  The default is to check for all rounding modes,
@@ -201,42 +185,6 @@ failModeFromOptions (const std::string_view &failmode)
   error ("invalid fail mode: {}", failmode);
 }
 
-// Returns the size of an ulp for VALUE.
-template <typename F>
-F
-ulp (F value)
-{
-  F ulp;
-
-  switch (std::fpclassify (value))
-    {
-    case FP_ZERO:
-      /* Fall through...  */
-    case FP_SUBNORMAL:
-      ulp = std::ldexp (1.0, std::numeric_limits<F>::min_exponent
-				 - std::numeric_limits<F>::digits);
-      break;
-
-    case FP_NORMAL:
-      ulp = std::ldexp (1.0, std::ilogb (value)
-				 - std::numeric_limits<F>::digits + 1);
-      break;
-
-    default:
-      std::unreachable ();
-      break;
-    }
-  return ulp;
-}
-
-/* Returns the number of ulps that GIVEN is away from EXPECTED.  */
-template <typename F>
-F
-ulpdiff (F given, F expected)
-{
-  return std::fabs (given - expected) / ulp (expected);
-}
-
 template <typename F> using UlpAccumulator = std::map<F, uint64_t>;
 
 template <typename F>
@@ -267,6 +215,20 @@ getThreadNum (void)
 #endif
 }
 
+static int
+getNumThreads (void)
+{
+#ifdef _OPENMP
+  return omp_get_num_threads ();
+#else
+  return 1;
+#endif
+}
+
+// Samples between the checks for a snapshot request (see snapshot.h) in the
+// per-sample checking loops.
+static constexpr std::uint64_t kSnapshotInterval = 4096;
+
 //
 // RoundSetup: Helper class to setup/reset the rounding mode, along with
 //                extra setup required by MPFR.
@@ -301,7 +263,20 @@ public:
   RoundSetup &operator= (RoundSetup &&) = delete;
 };
 
-// Accumulate histogram printer helpers.
+// The --shard K/N of the run (see shardRange).
+static std::uint64_t shardIndex = 0;
+static std::uint64_t shardCount = 1;
+
+// Accumulate histogram printer helpers.  The count is the number of inputs
+// actually checked, so the shard of the sample with --shard.
+
+static std::string
+shardName ()
+{
+  return shardCount > 1 ? std::format (" (shard {}/{})", shardIndex,
+				       shardCount)
+			: std::string ();
+}
 
 template <typename F>
 static void
@@ -316,8 +291,8 @@ printAccumulator (const std::string_view &rndname,
       });
 
   printlnTimestamp (
-      "Checking rounding mode {:13}, range [{:9.2g},{:9.2g}], count {}",
-      rndname, sample.arg.start, sample.arg.end, ulptotal);
+      "Checking rounding mode {:13}, range [{:9.2g},{:9.2g}], count {}{}",
+      rndname, sample.arg.start, sample.arg.end, ulptotal, shardName ());
 
   for (const auto &ulp : ulpacc)
     printlnTimestamp ("    {:g}: {:16} {:6.2f}%", ulp.first, ulp.second,
@@ -337,9 +312,10 @@ printAccumulator (const std::string_view &rndname,
       });
 
   printlnTimestamp ("Checking rounding mode {:13}, range x=[{:9.2g},{:9.2g}], "
-		    "y=[{:9.2g},{:9.2g}], count {}",
+		    "y=[{:9.2g},{:9.2g}], count {}{}",
 		    rndname, sample.arg_x.start, sample.arg_x.end,
-		    sample.arg_y.start, sample.arg_y.end, ulptotal);
+		    sample.arg_y.start, sample.arg_y.end, ulptotal,
+		    shardName ());
 
   for (const auto &ulp : ulpacc)
     printlnTimestamp ("    {:g}: {:16} {:6.2f}%", ulp.first, ulp.second,
@@ -359,9 +335,10 @@ printAccumulator (const std::string_view &rndname,
       });
 
   printlnTimestamp ("Checking rounding mode {:13}, range x=[{:9.2g},{:9.2g}], "
-		    "y=[{},{}], count {}",
+		    "y=[{},{}], count {}{}",
 		    rndname, sample.arg_x.start, sample.arg_x.end,
-		    sample.arg_y.start, sample.arg_y.end, ulptotal);
+		    sample.arg_y.start, sample.arg_y.end, ulptotal,
+		    shardName ());
 
   for (const auto &ulp : ulpacc)
     printlnTimestamp ("    {:g}: {:16} {:6.2f}%", ulp.first, ulp.second,
@@ -380,7 +357,8 @@ printAccumulator (const std::string_view &rndname,
 	return previous + p.second;
       });
 
-  printlnTimestamp ("Checking rounding mode {:13}, {}", rndname, sample.name);
+  printlnTimestamp ("Checking rounding mode {:13}, {}, count {}{}", rndname,
+		    sample.name, ulptotal, shardName ());
 
   for (const auto &ulp : ulpacc)
     printlnTimestamp ("    {:g}: {:16} {:6.2f}%", ulp.first, ulp.second,
@@ -389,6 +367,140 @@ printAccumulator (const std::string_view &rndname,
 
 static std::vector<RngType::state_type> rngStates;
 
+// Hard inputs corpus of the function being checked, enabled with --corpus.
+static std::optional<Corpus> corpus;
+
+static void
+openCorpus (const std::optional<std::string> &corpusDir,
+	    const std::string &functionName)
+{
+  if (!corpusDir)
+    return;
+  auto r = Corpus::open (*corpusDir, functionName);
+  if (!r)
+    error ("{}", r.error ());
+  corpus.emplace (std::move (r.value ()));
+}
+
+static void
+saveCorpus (void)
+{
+  if (!corpus)
+    return;
+  if (auto r = corpus->save (); !r)
+    error ("{}", r.error ());
+}
+
+// Used on FailMode::FIRST, where the per-thread corpus collectors are not
+// merged: record the failure before exiting.
+template <typename RET>
+[[noreturn]] static void
+exitFailure (const RET &ret)
+{
+  if (corpus)
+    {
+      auto [x, y] = ret.inputBits ();
+      corpus->add (x, y, Corpus::FAILURE);
+      saveCorpus ();
+    }
+  std::exit (EXIT_FAILURE);
+}
+
+// Raw evaluation traces, enabled with --trace: each thread writes its own
+// file, <dir>/<function>.<thread>.trace.
+static std::optional<std::string> traceDir;
+static std::vector<std::unique_ptr<tracefile::Writer> > traceWriters;
+
+static void
+openTrace (const std::string &functionName, refimpls::FunctionType functype)
+{
+  if (!traceDir)
+    return;
+
+  std::uint32_t floatBits = 64, arg2 = tracefile::ARG2_NONE, outputs = 1;
+  switch (functype)
+    {
+    case refimpls::FunctionType::f32_f:
+      floatBits = 32;
+      break;
+    case refimpls::FunctionType::f32_f_f:
+      floatBits = 32;
+      [[fallthrough]];
+    case refimpls::FunctionType::f64_f_f:
+      arg2 = tracefile::ARG2_FLOAT;
+      break;
+    case refimpls::FunctionType::f32_f_lli:
+      floatBits = 32;
+      [[fallthrough]];
+    case refimpls::FunctionType::f64_f_lli:
+      arg2 = tracefile::ARG2_INTEGER;
+      break;
+    case refimpls::FunctionType::f32_f_fp_fp:
+      floatBits = 32;
+      [[fallthrough]];
+    case refimpls::FunctionType::f64_f_fp_fp:
+      outputs = 2;
+      break;
+    default:
+      break;
+    }
+
+  std::error_code ec;
+  std::filesystem::create_directories (*traceDir, ec);
+  if (ec)
+    error ("creating trace directory {}: {}", *traceDir, ec.message ());
+
+  const auto header
+      = tracefile::makeHeader (functionName, floatBits, arg2, outputs);
+  for (int i = 0; i < getMaxThread (); i++)
+    {
+      auto fileName = std::filesystem::path (*traceDir)
+		      / std::format ("{}.{}.trace", functionName, i);
+      auto w = tracefile::Writer::open (fileName.string (), header);
+      if (!w)
+	error ("{}", w.error ());
+      traceWriters.push_back (
+	  std::make_unique<tracefile::Writer> (std::move (w.value ())));
+    }
+}
+
+static void
+closeTrace (void)
+{
+  for (auto &w : traceWriters)
+    if (auto r = w->close (); !r)
+      error ("{}", r.error ());
+  traceWriters.clear ();
+}
+
+template <typename RET>
+static void
+traceResult (const RET &ret)
+{
+  using FloatType = typename RET::FloatType;
+  using Limits = floatrange::Limits<FloatType>;
+
+  tracefile::Record r{};
+  std::tie (r.x, r.y) = ret.inputBits ();
+  if constexpr (requires { ret.computed2; })
+    {
+      r.computed[0] = Limits::to (ret.computed1);
+      r.expected[0] = Limits::to (ret.expected1);
+      r.computed[1] = Limits::to (ret.computed2);
+      r.expected[1] = Limits::to (ret.expected2);
+    }
+  else
+    {
+      r.computed[0] = Limits::to (ret.computed);
+      r.expected[0] = Limits::to (ret.expected);
+    }
+  traceWriters[getThreadNum ()]->add (ret.roundMode.mode, r);
+}
+
+// The seed of the random samples checked by index, the same on all the MPI
+// ranks so they check the points of a single run.
+static RngType::state_type sequenceSeed;
+
 static void
 initRandomState (void)
 {
@@ -397,6 +509,8 @@ initRandomState (void)
   for (auto &s : rngStates)
     // std::random_device max is UINT32_MAX
     s = (RngType::state_type) rd () << 32 | rd ();
+  sequenceSeed = rngStates[0];
+  mpicheck::broadcast (sequenceSeed);
 }
 
 template <typename F> struct Result
@@ -406,10 +520,8 @@ template <typename F> struct Result
   Result (int r, F c, F e, F m)
       : roundMode (roundModeFromRound (r)), computed (c), expected (e), max (m)
   {
-    ulp = ulpdiff (computed, expected);
-    if (std::isnan (ulp) || std::isinf (ulp))
-      // Do not signal an error if the expected value is NaN/Inf.
-      ulp = 0.0;
+    // Do not signal an error if the expected value is NaN/Inf.
+    ulp = ulpError (computed, expected);
   }
 
   bool
@@ -421,18 +533,7 @@ template <typename F> struct Result
   bool
   checkFull (void) const
   {
-    if (isSignaling (computed) || isSignaling (expected))
-      return false;
-    else if (std::isnan (computed) && std::isnan (expected))
-      return true;
-    else if (std::isinf (computed) && std::isinf (expected))
-      /* Test for sign of infinities.  */
-      return std::signbit (computed) == std::signbit (expected);
-    else if (std::isinf (computed) || std::isnan (computed)
-	     || std::isinf (expected) || std::isnan (expected))
-      return false;
-
-    return check ();
+    return checkFullValue (computed, expected, ulp, max);
   }
 
   virtual void printTo (std::ostream &) const = 0;
@@ -477,6 +578,12 @@ template <typename F> struct ResultFloat : public Result<F>
 	Result<F>::expected);
   }
 
+  std::pair<std::uint64_t, std::uint64_t>
+  inputBits (void) const
+  {
+    return { floatrange::Limits<F>::to (input), 0 };
+  }
+
   F input;
 };
 
@@ -546,6 +653,12 @@ template <typename F> struct ResultFloatpFloatp
 		       expected1, expected2);
   }
 
+  std::pair<std::uint64_t, std::uint64_t>
+  inputBits (void) const
+  {
+    return { floatrange::Limits<F>::to (input), 0 };
+  }
+
   const RoundMode &roundMode;
   FloatType input;
   FloatType computed1;
@@ -589,6 +702,13 @@ template <typename F> struct ResultFloatFloat : public Result<F>
 		       input1, Result<F>::computed, Result<F>::expected);
   }
 
+  std::pair<std::uint64_t, std::uint64_t>
+  inputBits (void) const
+  {
+    return { floatrange::Limits<F>::to (input0),
+	     floatrange::Limits<F>::to (input1) };
+  }
+
   F input0;
   F input1;
 };
@@ -618,6 +738,13 @@ public:
 		       input1, Result<F>::computed, Result<F>::expected);
   }
 
+  std::pair<std::uint64_t, std::uint64_t>
+  inputBits (void) const
+  {
+    return { floatrange::Limits<F>::to (input0),
+	     static_cast<std::uint64_t> (input1) };
+  }
+
   F input0;
   long long int input1;
 };
@@ -820,6 +947,38 @@ public:
     return std::make_unique<RET> (rnd, input, computed, expected,
 				  SampleFull<RET>::max_ulp);
   }
+
+  // Evaluate the N inputs starting at the bit pattern START.
+  void
+  evalBlock (uint64_t start, std::size_t n, int rnd, FloatType *inputs,
+	     FloatType *computed, FloatType *expected,
+	     const std::uint32_t *golden = nullptr) const
+  {
+    for (std::size_t i = 0; i < n; i++)
+      inputs[i] = floatrange::Limits<FloatType>::from (start + i);
+    evalInputs (inputs, n, rnd, computed, expected, golden);
+  }
+
+  // Evaluate the N INPUTS.  If GOLDEN is not null the expected results are
+  // copied from it (a golden table slice, see goldentable.h) instead of
+  // evaluated by the reference.
+  void
+  evalInputs (const FloatType *inputs, std::size_t n, int rnd,
+	      FloatType *computed, FloatType *expected,
+	      const std::uint32_t *golden = nullptr) const
+  {
+    for (std::size_t i = 0; i < n; i++)
+      computed[i] = func (inputs[i]);
+
+    if constexpr (sizeof (FloatType) == sizeof (std::uint32_t))
+      if (golden != nullptr)
+	{
+	  std::memcpy (expected, golden, n * sizeof (FloatType));
+	  return;
+	}
+    for (std::size_t i = 0; i < n; i++)
+      expected[i] = ref_func (inputs[i], rnd);
+  }
 };
 template <typename F>
 using FullFloat
@@ -895,6 +1054,80 @@ template <typename F>
 using ListFloat
     = SampleListFloat<FuncF<F>, FuncFReference<F>, ResultFloat<F> >;
 
+template <typename FUNC, typename FUNC_REF, typename RET>
+class SampleListFloatpFloatp : public SampleList<RET>
+{
+  const FUNC &func;
+  const FUNC_REF &ref_func;
+
+public:
+  typedef typename RET::FloatType FloatType;
+
+  SampleListFloatpFloatp (FUNC &f, FUNC_REF &ref_f, RET::FloatType mulp)
+      : SampleList<RET> (mulp), func (f), ref_func (ref_f)
+  {
+  }
+
+  std::unique_ptr<RET>
+  operator() (FloatType input, int rnd) const
+  {
+    FloatType computed0, computed1;
+    func (input, &computed0, &computed1);
+
+    FloatType expected0, expected1;
+    ref_func (input, &expected0, &expected1, rnd);
+
+    return std::make_unique<RET> (rnd, input, computed0, computed1, expected0,
+				  expected1, SampleList<RET>::max_ulp);
+  }
+};
+template <typename F>
+using ListFloatpFloatp
+    = SampleListFloatpFloatp<FuncFpFp<F>, FuncFpFpReference<F>,
+			     ResultFloatpFloatp<F> >;
+
+template <typename RET, typename ARG2> struct SampleList2Arg
+{
+  RET::FloatType max_ulp;
+
+  SampleList2Arg (RET::FloatType maxp) : max_ulp (maxp) {}
+
+  virtual std::unique_ptr<RET> operator() (RET::FloatType, ARG2, int) const
+      = 0;
+};
+
+template <typename FUNC, typename FUNC_REF, typename RET, typename ARG2>
+class SampleListFloatArg2 : public SampleList2Arg<RET, ARG2>
+{
+  const FUNC &func;
+  const FUNC_REF &ref_func;
+
+public:
+  typedef typename RET::FloatType FloatType;
+
+  SampleListFloatArg2 (FUNC &f, FUNC_REF &ref_f, RET::FloatType mulp)
+      : SampleList2Arg<RET, ARG2> (mulp), func (f), ref_func (ref_f)
+  {
+  }
+
+  std::unique_ptr<RET>
+  operator() (FloatType input0, ARG2 input1, int rnd) const
+  {
+    FloatType computed = func (input0, input1);
+    FloatType expected = ref_func (input0, input1, rnd);
+
+    return std::make_unique<RET> (rnd, input0, input1, computed, expected,
+				  SampleList2Arg<RET, ARG2>::max_ulp);
+  }
+};
+template <typename F>
+using ListFloatFloat = SampleListFloatArg2<FuncFF<F>, FuncFFReference<F>,
+					   ResultFloatFloat<F>, F>;
+template <typename F>
+using ListFloatLLI
+    = SampleListFloatArg2<FuncFLLI<F>, FuncFLLIReference<F>,
+			  ResultFloatLLI<F>, long long int>;
+
 template <typename RET>
 static void
 checkRandomFloat (
@@ -913,46 +1146,78 @@ checkRandomFloat (
       for (unsigned i = 0; i < rngStates.size (); i++)
 	gens[i] = RngType (rngStates[i]);
 
-#pragma omp declare reduction(                                                \
-	ulpAccumulatorReduction : UlpAccumulator<                             \
-		FloatType> : ulpAccumulatorReduction(omp_out, omp_in))        \
-    initializer(omp_priv = UlpAccumulator<FloatType> ())
-
       auto start = ClockType::now ();
 
       std::uniform_real_distribution<FloatType> dist (sample.arg.start,
 						      sample.arg.end);
 
       UlpAccumulator<FloatType> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<FloatType> snapshot (title);
+      mpicheck::Blocks<FloatType> blocks (title, 0, sample.count, ulpaccrange,
+					  worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
 
 #pragma omp parallel firstprivate(dist, failmode) shared(sample, rnd)
-      {
-	RoundSetup<FloatType> roundSetup (rnd.mode);
-
-#pragma omp for reduction(ulpAccumulatorReduction : ulpaccrange)
-	for (std::uint64_t i = 0; i < sample.count; i++)
 	  {
-	    auto ret = funcs (gens[getThreadNum ()], dist, rnd.mode);
-	    if (!ret->check ())
-	      switch (failmode)
-		{
-		case FailMode::FIRST:
-		case FailMode::ALL:
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    UlpAccumulator<FloatType> ulpacc;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<FloatType>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+
+#pragma omp for nowait
+	    for (std::uint64_t i = blockStart; i < blockEnd; i++)
+	      {
+		if (i % kSnapshotInterval == 0 && snapshotlocal.requested ())
+		  snapshotlocal.publish (ulpacc, worstlocal);
+
+		auto ret = funcs (gens[getThreadNum ()], dist, rnd.mode);
+		if (!ret->check ())
+		  switch (failmode)
+		    {
+		    case FailMode::FIRST:
+		    case FailMode::ALL:
 #pragma omp critical
-		  {
-		    printlnErrorTimestamp ("{}", *ret);
-		    if (failmode == FailMode::FIRST)
-		      std::exit (EXIT_FAILURE);
-		  }
-		  [[fallthrough]];
-		default:
-		  break;
-		}
-	    ulpaccrange[ret->ulp] += 1;
+		      {
+			printlnErrorTimestamp ("{}", *ret);
+			if (failmode == FailMode::FIRST)
+			  exitFailure (*ret);
+		      }
+		      [[fallthrough]];
+		    default:
+		      break;
+		    }
+		ulpacc[ret->ulp] += 1;
+		worstlocal.add (*ret);
+		if (corpus)
+		  corpuslocal.add (*ret, ret->check ());
+		if (!traceWriters.empty ())
+		  traceResult (*ret);
+	      }
+
+	    snapshotlocal.finish (ulpacc, worstlocal);
+#pragma omp critical
+	    {
+	      ulpAccumulatorReduction (ulpaccrange, ulpacc);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
 	  }
-      }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
 
       printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
 
       auto end = ClockType::now ();
       printlnTimestamp (
@@ -982,11 +1247,6 @@ checkRandomFloatFloat (
       for (unsigned i = 0; i < rngStates.size (); i++)
 	gens[i] = RngType (rngStates[i]);
 
-#pragma omp declare reduction(                                                \
-	ulpAccumulatorReduction : UlpAccumulator<                             \
-		FloatType> : ulpAccumulatorReduction(omp_out, omp_in))        \
-    initializer(omp_priv = UlpAccumulator<FloatType> ())
-
       auto start = ClockType::now ();
 
       std::uniform_real_distribution<FloatType> distX (sample.arg_x.start,
@@ -995,35 +1255,73 @@ checkRandomFloatFloat (
 						       sample.arg_y.end);
 
       UlpAccumulator<FloatType> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<FloatType> snapshot (title);
+      mpicheck::Blocks<FloatType> blocks (title, 0, sample.count, ulpaccrange,
+					  worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
 
 #pragma omp parallel firstprivate(distX, distY, failmode) shared(sample, rnd)
-      {
-	RoundSetup<FloatType> roundSetup (rnd.mode);
-
-#pragma omp for reduction(ulpAccumulatorReduction : ulpaccrange)
-	for (std::uint64_t i = 0; i < sample.count; i++)
 	  {
-	    auto ret = funcs (gens[getThreadNum ()], distX, distY, rnd.mode);
-	    if (!ret->check ())
-	      switch (failmode)
-		{
-		case FailMode::FIRST:
-		case FailMode::ALL:
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    UlpAccumulator<FloatType> ulpacc;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<FloatType>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+
+#pragma omp for nowait
+	    for (std::uint64_t i = blockStart; i < blockEnd; i++)
+	      {
+		if (i % kSnapshotInterval == 0 && snapshotlocal.requested ())
+		  snapshotlocal.publish (ulpacc, worstlocal);
+
+		auto ret
+		    = funcs (gens[getThreadNum ()], distX, distY, rnd.mode);
+		if (!ret->check ())
+		  switch (failmode)
+		    {
+		    case FailMode::FIRST:
+		    case FailMode::ALL:
 #pragma omp critical
-		  {
-		    printlnErrorTimestamp ("{}", *ret);
-		    if (failmode == FailMode::FIRST)
-		      std::exit (EXIT_FAILURE);
-		  }
-		  [[fallthrough]];
-		default:
-		  break;
-		}
-	    ulpaccrange[ret->ulp] += 1;
+		      {
+			printlnErrorTimestamp ("{}", *ret);
+			if (failmode == FailMode::FIRST)
+			  exitFailure (*ret);
+		      }
+		      [[fallthrough]];
+		    default:
+		      break;
+		    }
+		ulpacc[ret->ulp] += 1;
+		worstlocal.add (*ret);
+		if (corpus)
+		  corpuslocal.add (*ret, ret->check ());
+		if (!traceWriters.empty ())
+		  traceResult (*ret);
+	      }
+
+	    snapshotlocal.finish (ulpacc, worstlocal);
+#pragma omp critical
+	    {
+	      ulpAccumulatorReduction (ulpaccrange, ulpacc);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
 	  }
-      }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
 
       printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
 
       auto end = ClockType::now ();
       printlnTimestamp (
@@ -1054,11 +1352,6 @@ checkRandomFloatLLI (
       for (unsigned i = 0; i < rngStates.size (); i++)
 	gens[i] = RngType (rngStates[i]);
 
-#pragma omp declare reduction(                                                \
-	ulpAccumulatorReduction : UlpAccumulator<                             \
-		FloatType> : ulpAccumulatorReduction(omp_out, omp_in))        \
-    initializer(omp_priv = UlpAccumulator<FloatType> ())
-
       auto start = ClockType::now ();
 
       std::uniform_real_distribution<FloatType> distX (sample.arg_x.start,
@@ -1067,35 +1360,73 @@ checkRandomFloatLLI (
 						     sample.arg_y.end);
 
       UlpAccumulator<FloatType> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<FloatType> snapshot (title);
+      mpicheck::Blocks<FloatType> blocks (title, 0, sample.count, ulpaccrange,
+					  worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
 
 #pragma omp parallel firstprivate(distX, distY, failmode) shared(sample, rnd)
-      {
-	RoundSetup<FloatType> roundSetup (rnd.mode);
-
-#pragma omp for reduction(ulpAccumulatorReduction : ulpaccrange)
-	for (std::uint64_t i = 0; i < sample.count; i++)
 	  {
-	    auto ret = funcs (gens[getThreadNum ()], distX, distY, rnd.mode);
-	    if (!ret->check ())
-	      switch (failmode)
-		{
-		case FailMode::FIRST:
-		case FailMode::ALL:
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    UlpAccumulator<FloatType> ulpacc;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<FloatType>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+
+#pragma omp for nowait
+	    for (std::uint64_t i = blockStart; i < blockEnd; i++)
+	      {
+		if (i % kSnapshotInterval == 0 && snapshotlocal.requested ())
+		  snapshotlocal.publish (ulpacc, worstlocal);
+
+		auto ret
+		    = funcs (gens[getThreadNum ()], distX, distY, rnd.mode);
+		if (!ret->check ())
+		  switch (failmode)
+		    {
+		    case FailMode::FIRST:
+		    case FailMode::ALL:
 #pragma omp critical
-		  {
-		    printlnErrorTimestamp ("{}", *ret);
-		    if (failmode == FailMode::FIRST)
-		      std::exit (EXIT_FAILURE);
-		  }
-		  [[fallthrough]];
-		default:
-		  break;
-		}
-	    ulpaccrange[ret->ulp] += 1;
+		      {
+			printlnErrorTimestamp ("{}", *ret);
+			if (failmode == FailMode::FIRST)
+			  exitFailure (*ret);
+		      }
+		      [[fallthrough]];
+		    default:
+		      break;
+		    }
+		ulpacc[ret->ulp] += 1;
+		worstlocal.add (*ret);
+		if (corpus)
+		  corpuslocal.add (*ret, ret->check ());
+		if (!traceWriters.empty ())
+		  traceResult (*ret);
+	      }
+
+	    snapshotlocal.finish (ulpacc, worstlocal);
+#pragma omp critical
+	    {
+	      ulpAccumulatorReduction (ulpaccrange, ulpacc);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
 	  }
-      }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
 
       printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
 
       auto end = ClockType::now ();
       printlnTimestamp (
@@ -1116,317 +1447,2241 @@ checkFull (const std::string_view &funcname, const SampleFull<RET> &funcs,
 
   for (auto &rnd : roundModes)
     {
-#pragma omp declare reduction(                                                \
-	ulpAccumulatorReduction : UlpAccumulator<                             \
-		FloatType> : ulpAccumulatorReduction(omp_out, omp_in))        \
-    initializer(omp_priv = UlpAccumulator<FloatType> ())
-
       UlpAccumulator<FloatType> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<FloatType> snapshot (title);
+      mpicheck::Blocks<FloatType> blocks (title, sample.start, sample.end,
+					  ulpaccrange, worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
 
 #pragma omp parallel firstprivate(failmode) shared(funcs, rnd)
-      {
-	RoundSetup<FloatType> roundSetup (rnd.mode);
-
-// Out of range inputs might take way less time than normal one, also use
-// a large chunk size to minimize the overhead from dynamic scheduline.
-#pragma omp for reduction(ulpAccumulatorReduction : ulpaccrange)              \
-    schedule(dynamic)
-	for (std::uint64_t i = sample.start; i < sample.end; i++)
 	  {
-	    auto ret = funcs (i, rnd.mode);
-	    if (!ret->checkFull ())
-	      switch (failmode)
-		{
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    UlpAccumulator<FloatType> ulpacc;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<FloatType>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+
+    // Out of range inputs might take way less time than normal one, also use
+    // a large chunk size to minimize the overhead from dynamic scheduline.
+#pragma omp for schedule(dynamic) nowait
+	    for (std::uint64_t i = blockStart; i < blockEnd; i++)
+	      {
+		if ((i - blockStart) % kSnapshotInterval == 0
+		    && snapshotlocal.requested ())
+		  snapshotlocal.publish (ulpacc, worstlocal);
+
+		auto ret = funcs (i, rnd.mode);
+		if (!ret->checkFull ())
+		  switch (failmode)
+		    {
 #if 0
-		case FailMode::FIRST:
-		case FailMode::ALL:
+		    case FailMode::FIRST:
+		    case FailMode::ALL:
 #  pragma omp critical
+		      {
+		      printlnErrorTimestamp ("{}", *ret);
+		      if (failmode == FailMode::FIRST)
+			std::exit (EXIT_FAILURE);
+		      }
+		      [[fallthrough]];
+#endif
+		    default:
+		      break;
+		    }
+		ulpacc[ret->ulp] += 1;
+		worstlocal.add (*ret);
+		if (corpus)
+		  corpuslocal.add (*ret, ret->checkFull ());
+		if (!traceWriters.empty ())
+		  traceResult (*ret);
+	      }
+
+	    snapshotlocal.finish (ulpacc, worstlocal);
+#pragma omp critical
+	    {
+	      ulpAccumulatorReduction (ulpaccrange, ulpacc);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
+	  }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
+
+      printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
+      printlnTimestamp ("");
+    }
+}
+
+// Golden reference tables directory (see genref), enabled with --golden.
+static std::optional<std::string> goldenDir;
+
+template <typename F>
+static std::optional<goldentable::TableSet>
+openGolden (const std::string_view &funcname, const RoundMode &rnd)
+{
+  if (!goldenDir || sizeof (F) != sizeof (std::uint32_t))
+    return std::nullopt;
+
+  auto tables = goldentable::TableSet::open (
+      *goldenDir, std::string (funcname), rnd.abbrev, rnd.mode);
+  if (!tables)
+    error ("{}", tables.error ());
+  if (tables->empty ())
+    {
+      printlnTimestamp ("No golden table for {} {}, using the reference",
+			funcname, rnd.abbrev);
+      return std::nullopt;
+    }
+  return std::move (tables.value ());
+}
+
+static void
+printGoldenBandwidth (std::uint64_t bytes, ClockType::time_point start)
+{
+  if (bytes == 0)
+    return;
+  std::chrono::duration<double> elapsed = ClockType::now () - start;
+  printlnTimestamp ("Golden tables: {:.2f} GiB read in {:.2f}s ({:.2f} GB/s)",
+		    bytes / 0x1p30, elapsed.count (),
+		    bytes / elapsed.count () / 1e9);
+}
+
+// Inputs of each full range block, and the blocks of each thread work chunk
+// (a 2 MiB, one huge page, golden table slice for binary32).
+static constexpr std::uint64_t kFullBlockSize = 1024;
+static constexpr std::uint64_t kFullChunkBlocks = 512;
+
+//
+// checkFullBlock: checkFull for the single output functions, where the
+//                 results are evaluated in blocks and classified by the
+//                 ulpkernel compare and histogram kernel.  Only the results
+//                 that are recorded in the corpus or in the trace build a
+//                 Result object.  With --golden the binary32 expected
+//                 results are read from the golden tables when available.
+//
+
+template <typename F>
+static void
+checkFullBlock (const std::string_view &funcname, const FullFloat<F> &funcs,
+		const Description::FullRange &sample,
+		const RoundSet &roundModes, FailMode failmode)
+{
+  static constexpr std::uint64_t kBlockSize = kFullBlockSize;
+  static constexpr std::uint64_t kChunkSize
+      = kFullBlockSize * kFullChunkBlocks;
+
+  for (auto &rnd : roundModes)
+    {
+      UlpAccumulator<F> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<F> snapshot (title);
+      const auto golden = openGolden<F> (funcname, rnd);
+      std::uint64_t goldenBytes = 0;
+
+      auto start = ClockType::now ();
+      mpicheck::Blocks<F> blocks (title, sample.start, sample.end,
+				  ulpaccrange, worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
+
+#pragma omp parallel firstprivate(failmode) shared(funcs, rnd, golden)       \
+    reduction(+ : goldenBytes)
+	  {
+	    RoundSetup<F> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    ulpkernel::LaneHistogram<F> histogram;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<F>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+	    auto histogramCopy = [&histogram] () {
+	      UlpAccumulator<F> ulps;
+	      histogram.mergeInto (ulps);
+	      return ulps;
+	    };
+
+	    F inputs[kBlockSize];
+	    F computed[kBlockSize];
+	    F expected[kBlockSize];
+	    F ulps[kBlockSize];
+	    std::uint8_t valid[kBlockSize];
+
+#pragma omp for schedule(dynamic, kFullChunkBlocks) nowait
+	    for (std::uint64_t b = blockStart; b < blockEnd; b += kBlockSize)
+	      {
+		if (snapshotlocal.requested ())
+		  snapshotlocal.publish (histogramCopy (), worstlocal);
+
+		const std::size_t n = std::min (kBlockSize, blockEnd - b);
+		const std::uint32_t *table = nullptr;
+		if (golden)
 		  {
-		  printlnErrorTimestamp ("{}", *ret);
-		  if (failmode == FailMode::FIRST)
-		    std::exit (EXIT_FAILURE);
+		    // Read ahead the whole work chunk on its first block.
+		    if ((b - blockStart) % kChunkSize == 0)
+		      golden->prefetch (b,
+					std::min (kChunkSize, blockEnd - b));
+		    table = golden->find (b, n);
+		    if (table != nullptr)
+		      goldenBytes += n * sizeof (std::uint32_t);
 		  }
-		  [[fallthrough]];
-#endif
-		default:
-		  break;
-		}
-	    ulpaccrange[ret->ulp] += 1;
+		funcs.evalBlock (b, n, rnd.mode, inputs, computed, expected,
+				 table);
+		ulpkernel::compareBlock (computed, expected, n, funcs.max_ulp,
+					 ulps, valid);
+		histogram.add (ulps, n);
+		for (std::size_t i = 0; i < n; i++)
+		  if (worstlocal.wants (ulps[i]))
+		    worstlocal.add (ResultFloat<F> (rnd.mode, inputs[i],
+						    computed[i], expected[i],
+						    funcs.max_ulp));
+
+		if (!corpus && traceWriters.empty ())
+		  continue;
+		for (std::size_t i = 0; i < n; i++)
+		  {
+		    // Exact results are not added to the corpus.
+		    if (traceWriters.empty () && valid[i] && !(ulps[i] > 0.0))
+		      continue;
+		    ResultFloat<F> ret (rnd.mode, inputs[i], computed[i],
+					expected[i], funcs.max_ulp);
+		    if (corpus)
+		      corpuslocal.add (ret, valid[i]);
+		    if (!traceWriters.empty ())
+		      traceResult (ret);
+		  }
+	      }
+
+	    snapshotlocal.finish (histogramCopy (), worstlocal);
+#pragma omp critical
+	    {
+	      histogram.mergeInto (ulpaccrange);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
 	  }
-      }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
 
+      printGoldenBandwidth (goldenBytes, start);
       printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
       printlnTimestamp ("");
     }
 }
 
-template <typename RET>
+// Check the COUNT list inputs evaluated with EVAL (index, rounding mode),
+// and print either every result (PRINTALL) or the failure count.
+template <typename RET, typename EVAL>
 static void
-checkList (const std::string_view &funcname,
-	   const std::vector<typename RET::FloatType> &values,
-	   const SampleList<RET> &funcs, const RoundSet &roundModes,
-	   FailMode failmode)
+checkListCases (const std::string_view &funcname, std::size_t count,
+		const EVAL &eval, const RoundSet &roundModes,
+		FailMode failmode, bool printAll)
 {
   using FloatType = typename RET::FloatType;
 
   for (auto &rnd : roundModes)
     {
-      RoundSetup<FloatType> roundSetup (rnd.mode);
+      auto start = ClockType::now ();
+
+      std::vector<std::unique_ptr<RET> > results (count);
+
+#pragma omp parallel shared(eval, rnd, results)
+      {
+	RoundSetup<FloatType> roundSetup (rnd.mode);
+
+#pragma omp for schedule(dynamic)
+	for (std::size_t i = 0; i < count; i++)
+	  results[i] = eval (i, rnd.mode);
+      }
 
-      for (auto value : values)
+      // Report in the input order, regardless of the evaluation order.
+      std::uint64_t failures = 0;
+      for (const auto &ret : results)
 	{
-	  auto ret = funcs (value, rnd.mode);
+	  if (!traceWriters.empty ())
+	    traceResult (*ret);
 	  if (!ret->checkFull ())
 	    {
+	      failures++;
+	      if (corpus)
+		{
+		  auto [x, y] = ret->inputBits ();
+		  corpus->add (x, y, Corpus::FAILURE);
+		}
+
 	      switch (failmode)
 		{
 		case FailMode::FIRST:
 		case FailMode::ALL:
-#pragma omp critical
-		  {
-		    printlnErrorTimestamp ("{}", *ret);
-		    if (failmode == FailMode::FIRST)
-		      std::exit (EXIT_FAILURE);
-		  }
+		  printlnErrorTimestamp ("{}", *ret);
+		  if (failmode == FailMode::FIRST)
+		    exitFailure (*ret);
 		  [[fallthrough]];
 		default:
 		  break;
 		}
 	    }
-	  else
+	  else if (printAll)
 	    printlnTimestamp ("{}", *ret);
 	}
+
+      if (!printAll)
+	{
+	  auto end = ClockType::now ();
+	  printlnTimestamp (
+	      "Checking rounding mode {:13}, count {}, failures {}, elapsed "
+	      "time {}",
+	      rnd.name, count, failures,
+	      std::chrono::duration_cast<std::chrono::duration<double> > (
+		  end - start));
+	}
     }
 
   printlnTimestamp ("");
 }
 
+template <typename RET>
+static void
+checkList (const std::string_view &funcname,
+	   const std::vector<typename RET::FloatType> &values,
+	   const SampleList<RET> &funcs, const RoundSet &roundModes,
+	   FailMode failmode, bool printAll)
+{
+  checkListCases<RET> (
+      funcname, values.size (),
+      [&] (std::size_t i, int rnd) { return funcs (values[i], rnd); },
+      roundModes, failmode, printAll);
+}
+
+//
+// Sharding: with --shard K/N only the K-th of N contiguous chunks of each
+// sample index range is checked.  The low-discrepancy sequences and the
+// full ranges are defined by index, so the N shards check exactly the
+// points of a single run; for the random samples each shard draws its
+// share of the count.
+//
+
+static std::pair<std::uint64_t, std::uint64_t>
+shardRange (std::uint64_t count)
+{
+  // floor (count * k / n) without overflow.
+  auto bound = [count] (std::uint64_t k) {
+    return count / shardCount * k + count % shardCount * k / shardCount;
+  };
+  return { bound (shardIndex), bound (shardIndex + 1) };
+}
+
+static std::expected<std::pair<std::uint64_t, std::uint64_t>, std::string>
+parseShard (const std::string &str)
+{
+  auto parts = strhelper::splitWithRanges (str, "/");
+  if (parts.size () != 2)
+    return std::unexpected (std::format ("invalid shard: {}", str));
+
+  std::uint64_t v[2];
+  for (int i = 0; i < 2; i++)
+    {
+      auto [ptr, ec] = std::from_chars (
+	  parts[i].data (), parts[i].data () + parts[i].size (), v[i]);
+      if (ec != std::errc{} || ptr != parts[i].data () + parts[i].size ())
+	return std::unexpected (std::format ("invalid shard: {}", str));
+    }
+  if (v[1] == 0 || v[0] >= v[1])
+    return std::unexpected (
+	std::format ("invalid shard: {} (expected K/N with K < N)", str));
+
+  return std::make_pair (v[0], v[1]);
+}
+
+template <typename SAMPLE>
+static SAMPLE
+shardSample (const SAMPLE &sample)
+{
+  auto [begin, end] = shardRange (sample.count);
+  SAMPLE ret = sample;
+  ret.count = end - begin;
+  return ret;
+}
+
+static Description::FullRange
+shardSample (const Description::FullRange &sample)
+{
+  auto [begin, end] = shardRange (sample.end - sample.start);
+  return Description::FullRange{ sample.name, sample.start + begin,
+				 sample.start + end };
+}
+
+// Whether the sample is checked with indexed points (checkSequence) instead
+// of the uniform random draws of checkRandomFloat and siblings.
+static bool
+indexedSample (const Description::SampleSequence &seq)
+{
+  return seq.sequence != Description::Sequence::RANDOM
+	 || !seq.distribution.isUniform ();
+}
+
 template <typename F>
+static distribution::Distribution<F>
+sampleDistribution (const Description::SampleSequence &seq,
+		    const Description::ArgType<F> &arg)
+{
+  return distribution::Distribution<F> (seq.distribution, arg.start,
+					arg.end);
+}
+
+template <typename RET, typename SAMPLE, typename SEQ, typename EVAL>
 static void
-runFloat (const Description &desc, const RoundSet &roundModes,
-	  FailMode failmode, const std::string &max_ulp_str)
+checkSequencePoints (const std::string_view &funcname, const SAMPLE &sample,
+		     const SEQ &seq, const EVAL &eval,
+		     const RoundSet &roundModes, FailMode failmode)
 {
-  auto func = getFunctionFloat<F> (desc.FunctionName).value ();
-  if (!func.first)
-    error ("libc does not provide {}", desc.FunctionName);
+  using FloatType = typename RET::FloatType;
 
-  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
-  if (!max_ulp)
-    error ("invalid floating point: {}", max_ulp_str);
+  const auto range = shardRange (sample.count);
 
-  printlnTimestamp ("Checking function {}", desc.FunctionName);
-  printlnTimestamp ("");
+  for (auto &rnd : roundModes)
+    {
+      auto start = ClockType::now ();
 
-  auto start = ClockType::now ();
+      UlpAccumulator<FloatType> ulpaccrange;
+      snapshot::WorstResults worstrange;
+      CorpusCollector corpusacc;
+      const std::string title = std::format ("{} {}", funcname, rnd.name);
+      snapshot::Snapshot<FloatType> snapshot (title);
+      mpicheck::Blocks<FloatType> blocks (title, range.first, range.second,
+					  ulpaccrange, worstrange);
+
+      while (auto block = blocks.next ())
+	{
+	  const std::uint64_t blockStart = block->first;
+	  const std::uint64_t blockEnd = block->second;
 
-  for (auto &sample : desc.Samples)
+#pragma omp parallel firstprivate(failmode) shared(seq, eval, rnd)
+	  {
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    CorpusCollector corpuslocal;
+	    UlpAccumulator<FloatType> ulpacc;
+	    snapshot::WorstResults worstlocal;
+	    typename snapshot::Snapshot<FloatType>::Thread snapshotlocal (
+		snapshot, getThreadNum (), getNumThreads ());
+
+#pragma omp for nowait
+	    for (std::uint64_t i = blockStart; i < blockEnd; i++)
+	      {
+		if (i % kSnapshotInterval == 0 && snapshotlocal.requested ())
+		  snapshotlocal.publish (ulpacc, worstlocal);
+
+		auto ret = eval (seq (i), rnd.mode);
+		if (!ret->check ())
+		  switch (failmode)
+		    {
+		    case FailMode::FIRST:
+		    case FailMode::ALL:
+#pragma omp critical
+		      {
+			printlnErrorTimestamp ("{}", *ret);
+			if (failmode == FailMode::FIRST)
+			  exitFailure (*ret);
+		      }
+		      [[fallthrough]];
+		    default:
+		      break;
+		    }
+		ulpacc[ret->ulp] += 1;
+		worstlocal.add (*ret);
+		if (corpus)
+		  corpuslocal.add (*ret, ret->check ());
+		if (!traceWriters.empty ())
+		  traceResult (*ret);
+	      }
+
+	    snapshotlocal.finish (ulpacc, worstlocal);
+#pragma omp critical
+	    {
+	      ulpAccumulatorReduction (ulpaccrange, ulpacc);
+	      worstrange.merge (worstlocal);
+	      corpusacc.merge (corpuslocal);
+	    }
+	  }
+	  snapshot.commit (ulpaccrange, worstrange);
+	}
+
+      printAccumulator (rnd.name, sample, ulpaccrange);
+      mpicheck::printWorst (worstrange);
+      if (corpus)
+	corpusacc.addTo (*corpus);
+
+      auto end = ClockType::now ();
+      printlnTimestamp (
+	  "Elapsed time {}",
+	  std::chrono::duration_cast<std::chrono::duration<double> > (
+	      end - start));
+      printlnTimestamp ("");
+    }
+}
+
+template <typename RET, typename SAMPLE, typename EVAL>
+static void
+checkSequence (const std::string_view &funcname, const SAMPLE &sample,
+	       const EVAL &eval, const RoundSet &roundModes, FailMode failmode)
+{
+  switch (sample.seq.sequence)
     {
-      if (auto *psample = std::get_if<Description::Sample1Arg<F> > (&sample))
-	checkRandomFloat (
-	    desc.FunctionName,
-	    RandomFloat<F>{ func.first, func.second, max_ulp.value () },
-	    *psample, roundModes, failmode);
-      else if (auto *psample = std::get_if<Description::FullRange> (&sample))
-	checkFull (desc.FunctionName,
-		   FullFloat<F>{ func.first, func.second, max_ulp.value () },
-		   *psample, roundModes, failmode);
-      else
-	error ("invalid sample type");
+    case Description::Sequence::SOBOL:
+      checkSequencePoints<RET> (funcname, sample,
+				lowdiscrepancy::Sobol (sample.seq.seed), eval,
+				roundModes, failmode);
+      break;
+    case Description::Sequence::HALTON:
+      checkSequencePoints<RET> (funcname, sample,
+				lowdiscrepancy::Halton (sample.seq.seed),
+				eval, roundModes, failmode);
+      break;
+    case Description::Sequence::RANDOM:
+      // A random sample with a non-uniform distribution, seeded as the
+      // random checks if there is no explicit seed.
+      checkSequencePoints<RET> (
+	  funcname, sample,
+	  lowdiscrepancy::Random (sample.seq.seed != 0 ? sample.seq.seed
+						       : sequenceSeed),
+	  eval, roundModes, failmode);
+      break;
+    default:
+      std::unreachable ();
     }
+}
 
-  auto end = ClockType::now ();
-  printlnTimestamp (
-      "Total elapsed time {}",
-      std::chrono::duration_cast<std::chrono::duration<double> > (end
-								  - start));
+template <typename RET>
+static void
+checkSequenceFloat (
+    const std::string_view &funcname, const SampleList<RET> &funcs,
+    const Description::Sample1Arg<typename RET::FloatType> &sample,
+    const RoundSet &roundModes, FailMode failmode)
+{
+  const auto dist = sampleDistribution (sample.seq, sample.arg);
+  checkSequence<RET> (
+      funcname, sample,
+      [&] (std::pair<std::uint64_t, std::uint64_t> p, int rnd) {
+	return funcs (dist (p.first), rnd);
+      },
+      roundModes, failmode);
+}
+
+template <typename RET>
+static void
+checkSequenceFloatFloat (
+    const std::string_view &funcname,
+    const SampleList2Arg<RET, typename RET::FloatType> &funcs,
+    const Description::Sample2Arg<typename RET::FloatType> &sample,
+    const RoundSet &roundModes, FailMode failmode)
+{
+  const auto distX = sampleDistribution (sample.seq, sample.arg_x);
+  const auto distY = sampleDistribution (sample.seq, sample.arg_y);
+  checkSequence<RET> (
+      funcname, sample,
+      [&] (std::pair<std::uint64_t, std::uint64_t> p, int rnd) {
+	return funcs (distX (p.first), distY (p.second), rnd);
+      },
+      roundModes, failmode);
+}
+
+template <typename RET>
+static void
+checkSequenceFloatLLI (
+    const std::string_view &funcname,
+    const SampleList2Arg<RET, long long int> &funcs,
+    const Description::Sample2ArgLli<typename RET::FloatType> &sample,
+    const RoundSet &roundModes, FailMode failmode)
+{
+  const auto distX = sampleDistribution (sample.seq, sample.arg_x);
+  checkSequence<RET> (
+      funcname, sample,
+      [&] (std::pair<std::uint64_t, std::uint64_t> p, int rnd) {
+	return funcs (distX (p.first),
+		      lowdiscrepancy::mapInteger (p.second, sample.arg_y.start,
+						  sample.arg_y.end),
+		      rnd);
+      },
+      roundModes, failmode);
+}
+
+//
+// Error-maximizing search, enabled with --search: instead of only sampling
+// the description ranges, a population of the inputs with the largest ULP
+// error is refined by hill climbing until the evaluation budget is exhausted
+// or the maximum stops improving.
+//
+
+// Evaluations per sample and rounding mode, set by --search.
+static std::optional<std::uint64_t> searchBudget;
+
+static constexpr std::size_t kSearchPopulation = 32;
+static constexpr std::uint64_t kSearchSamples = UINT64_C (1) << 20;
+static constexpr unsigned kSearchSteps = 64;
+static constexpr unsigned kSearchStallRounds = 16;
+static constexpr std::size_t kSearchReport = 10;
+
+// The ULP error of a search candidate.
+template <typename RET>
+static double
+searchError (const RET &ret)
+{
+  return ret.ulp;
 }
 
+// The ULP of the sincos results is clamped to the maximum, which would make
+// every candidate score the same.
 template <typename F>
+static double
+searchError (const ResultFloatpFloatp<F> &ret)
+{
+  return std::max (ulpError (ret.computed1, ret.expected1),
+		   ulpError (ret.computed2, ret.expected2));
+}
+
+// The search objective: the ULP error, with the mismatches of the special
+// values (a NaN or infinity on either side, whose ULP error is 0) ranked
+// above any finite error.
+template <typename RET>
+static double
+searchScore (const RET &ret)
+{
+  if (!ret.checkFull () && ret.check ())
+    return std::numeric_limits<double>::infinity ();
+  return searchError (ret);
+}
+
+template <typename RET, typename RANGE_X, typename RANGE_Y, typename EVAL>
 static void
-runFloatpFloatp (const Description &desc, const RoundSet &roundModes,
-		 FailMode failmode, const std::string &max_ulp_str)
+searchWorst (const std::string_view &funcname, const RANGE_X &rangex,
+	     const RANGE_Y &rangey, const EVAL &eval,
+	     const RoundSet &roundModes, FailMode failmode)
 {
-  auto func = getFunctionFloatpFloatp<F> (desc.FunctionName).value ();
-  if (!func.first)
-    error ("libc does not provide {}", desc.FunctionName);
+  using FloatType = typename RET::FloatType;
+  using ulpsearch::Candidate;
+  using ulpsearch::Population;
 
-  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
-  if (!max_ulp)
-    error ("invalid floating point: {}", max_ulp_str);
+  constexpr bool twoArgs = !std::is_same_v<RANGE_Y, ulpsearch::NoRange>;
 
-  printlnTimestamp ("Checking function {}", desc.FunctionName);
-  printlnTimestamp ("");
+  std::vector<RngType> gens (rngStates.size ());
+
+  for (auto &rnd : roundModes)
+    {
+      for (unsigned i = 0; i < rngStates.size (); i++)
+	gens[i] = RngType (rngStates[i]);
+
+      auto start = ClockType::now ();
+
+      // Phase 1: random sampling to seed the population.
+      const std::uint64_t samples
+	  = std::min (*searchBudget / 4 + 1, kSearchSamples);
+      Population population (kSearchPopulation);
+
+#pragma omp parallel shared(population, rnd)
+      {
+	RoundSetup<FloatType> roundSetup (rnd.mode);
+	Population local (kSearchPopulation);
+	auto &gen = gens[getThreadNum ()];
+
+#pragma omp for
+	for (std::uint64_t i = 0; i < samples; i++)
+	  {
+	    Candidate c{ rangex.random (gen), rangey.random (gen), 0.0 };
+	    c.ulp = searchScore (*eval (c, rnd.mode));
+	    local.add (c);
+	  }
+
+#pragma omp critical
+	population.merge (local);
+      }
+
+      // Phase 2: hill climbing from each population member, where the
+      // moves that do not decrease the error are accepted (so plateaus
+      // can be crossed).  Each step takes one evaluation from the budget,
+      // so the last round stops as soon as it is exhausted.
+      std::uint64_t evaluations = samples;
+      unsigned stall = 0;
+      while (evaluations < *searchBudget && stall < kSearchStallRounds)
+	{
+	  const auto parents = population.candidates ();
+	  Population next = population;
+
+#pragma omp parallel shared(next, parents, rnd, evaluations)
+	  {
+	    RoundSetup<FloatType> roundSetup (rnd.mode);
+	    Population local (kSearchPopulation);
+	    auto &gen = gens[getThreadNum ()];
+
+#pragma omp for schedule(dynamic)
+	    for (std::size_t i = 0; i < parents.size (); i++)
+	      {
+		Candidate cur = parents[i];
+		for (unsigned s = 0; s < kSearchSteps; s++)
+		  {
+		    std::uint64_t used;
+#pragma omp atomic capture
+		    used = evaluations++;
+		    if (used >= *searchBudget)
+		      break;
+
+		    Candidate c = cur;
+		    // For two argument functions move either or both.
+		    const unsigned which = twoArgs ? gen () % 3 : 0;
+		    if (which != 1)
+		      c.x = rangex.perturb (gen, c.x);
+		    if (which != 0)
+		      c.y = rangey.perturb (gen, c.y);
+		    c.ulp = searchScore (*eval (c, rnd.mode));
+		    if (c.ulp >= cur.ulp)
+		      cur = c;
+		    local.add (c);
+		  }
+	      }
+
+#pragma omp critical
+	    next.merge (local);
+	  }
+
+	  // The steps that found the budget exhausted were not evaluated.
+	  evaluations = std::min (evaluations, *searchBudget);
+	  stall = next.max () > population.max () ? 0 : stall + 1;
+	  population = std::move (next);
+	}
+
+      auto end = ClockType::now ();
+
+      printlnTimestamp ("Searching rounding mode {:13}, evaluations {}, max "
+			"ulp {:g}",
+			rnd.name, evaluations, population.max ());
+
+      // Report the worst inputs found, re-evaluating them to print the
+      // full result.
+      RoundSetup<FloatType> roundSetup (rnd.mode);
+      std::size_t reported = 0;
+      for (const auto &c : population.candidates ())
+	{
+	  auto ret = eval (c, rnd.mode);
+	  if (corpus && searchScore (*ret) > 0.0)
+	    {
+	      auto [x, y] = ret->inputBits ();
+	      corpus->add (x, y,
+			   Corpus::SEARCH
+			       | (ret->checkFull () ? 0 : Corpus::FAILURE));
+	    }
+
+	  if (!ret->checkFull ())
+	    switch (failmode)
+	      {
+	      case FailMode::FIRST:
+	      case FailMode::ALL:
+		printlnErrorTimestamp ("{}", *ret);
+		if (failmode == FailMode::FIRST)
+		  exitFailure (*ret);
+		[[fallthrough]];
+	      default:
+		break;
+	      }
+
+	  if (reported++ < kSearchReport)
+	    printlnTimestamp ("    {}", *ret);
+	}
+
+      printlnTimestamp (
+	  "Elapsed time {}",
+	  std::chrono::duration_cast<std::chrono::duration<double> > (
+	      end - start));
+      printlnTimestamp ("");
+    }
+}
+
+template <typename RET>
+static void
+searchFloat (const std::string_view &funcname, const SampleList<RET> &funcs,
+	     const Description::Sample1Arg<typename RET::FloatType> &sample,
+	     const RoundSet &roundModes, FailMode failmode)
+{
+  using FloatType = typename RET::FloatType;
+  using Range = ulpsearch::FloatRange<FloatType>;
+
+  searchWorst<RET> (
+      funcname, Range (sample.arg.start, sample.arg.end),
+      ulpsearch::NoRange{},
+      [&] (const ulpsearch::Candidate &c, int rnd) {
+	return funcs (Range::value (c.x), rnd);
+      },
+      roundModes, failmode);
+}
+
+template <typename RET, typename RANGE_Y, typename SAMPLE>
+static void
+searchFloatArg2 (
+    const std::string_view &funcname,
+    const SampleList2Arg<RET, typename RANGE_Y::ValueType> &funcs,
+    const SAMPLE &sample, const RoundSet &roundModes, FailMode failmode)
+{
+  using FloatType = typename RET::FloatType;
+  using RangeX = ulpsearch::FloatRange<FloatType>;
+
+  searchWorst<RET> (
+      funcname, RangeX (sample.arg_x.start, sample.arg_x.end),
+      RANGE_Y (sample.arg_y.start, sample.arg_y.end),
+      [&] (const ulpsearch::Candidate &c, int rnd) {
+	return funcs (RangeX::value (c.x), RANGE_Y::value (c.y), rnd);
+      },
+      roundModes, failmode);
+}
+
+static void
+searchSkipFull (const Description::FullRange &sample)
+{
+  printlnTimestamp ("Skipping full range {} in search mode", sample.name);
+  printlnTimestamp ("");
+}
+
+// First ordered input in [LO, HI] for which PRED holds, or HI + 1 if there
+// is none; PRED should be monotone (false up to some input, then true).
+template <typename PRED>
+static std::int64_t
+bisectFirst (std::int64_t lo, std::int64_t hi, const PRED &pred)
+{
+  std::int64_t first = hi + 1;
+  while (lo <= hi)
+    {
+      const std::int64_t mid = lo + (hi - lo) / 2;
+      if (pred (mid))
+	{
+	  first = mid;
+	  hi = mid - 1;
+	}
+      else
+	lo = mid + 1;
+    }
+  return first;
+}
+
+//
+// resultSample: resolve the output space sampling of SAMPLE (see
+//               Description::Sample1Arg): the input interval whose
+//               round-to-nearest reference results are in the result range
+//               is found by bisection on the input bit patterns, so the
+//               samples budget only goes to the inputs that reach it (for
+//               instance the subnormal results of exp).  The reference must
+//               be monotone on the sample input interval.
+//
+
+template <typename F>
+static Description::SampleType
+resultSample (const FuncFReference<F> &ref,
+	      const Description::SampleType &sample)
+{
+  auto *psample = std::get_if<Description::Sample1Arg<F> > (&sample);
+  if (!psample || !psample->result)
+    return sample;
+
+  Description::Sample1Arg<F> ret = *psample;
+  const F lo = ret.result->start;
+  const F hi = ret.result->end;
+
+  RoundSetup<F> roundSetup (FE_TONEAREST);
+  auto eval = [&] (std::int64_t o) {
+    return static_cast<F> (
+	ref (distribution::fromOrdered<F> (o), FE_TONEAREST));
+  };
+
+  const std::int64_t a = distribution::toOrdered (ret.arg.start);
+  const std::int64_t b = distribution::toOrdered (ret.arg.end);
+  const bool increasing = eval (a) <= eval (b);
+  // The first input reaching the result range, and the first one past it.
+  auto reached = [&] (std::int64_t o) {
+    return increasing ? eval (o) >= lo : eval (o) <= hi;
+  };
+  auto passed = [&] (std::int64_t o) {
+    return increasing ? eval (o) > hi : eval (o) < lo;
+  };
+  const std::int64_t first = bisectFirst (a, b, reached);
+  const std::int64_t last = bisectFirst (a, b, passed) - 1;
+  if (first > last)
+    error ("no input in [{:a}, {:a}] has a result in [{:a}, {:a}]",
+	   ret.arg.start, ret.arg.end, lo, hi);
+
+  ret.arg.start = distribution::fromOrdered<F> (first);
+  ret.arg.end = distribution::fromOrdered<F> (last);
+  printlnTimestamp ("Results in [{:a}, {:a}] from inputs [{:a}, {:a}] ({} "
+		    "values)",
+		    lo, hi, ret.arg.start, ret.arg.end, last - first + 1);
+  return ret;
+}
+
+//
+// Hot spots samples (see hotspots.h): the inputs are precomputed once and
+// checked as a list, sharded like the indexed samples.
+//
+
+template <typename F>
+static std::vector<F>
+hotspotMultiples (const Description::HotspotSample<F> &sample)
+{
+  auto candidates = hotspots::multiples (sample.kind, sample.arg.start,
+					 sample.arg.end, sample.count);
+  if (candidates.empty ())
+    error ("no multiple of {} in [{:a}, {:a}]", hotspots::name (sample.kind),
+	   sample.arg.start, sample.arg.end);
+  printlnTimestamp ("Closest input to a multiple of {}: {:a} ({:.3g} ulps)",
+		    hotspots::name (sample.kind), candidates[0].x,
+		    candidates[0].distance);
+
+  std::vector<F> values;
+  for (const auto &c : candidates)
+    values.push_back (c.x);
+  return values;
+}
+
+// The inputs around the zeros of the function in the sample range, found as
+// the sign changes of the round-to-nearest reference on an evenly spaced
+// grid of bit patterns, refined by bisection.
+template <typename F>
+static std::vector<F>
+hotspotZeros (const FuncFReference<F> &ref,
+	      const Description::HotspotSample<F> &sample)
+{
+  static constexpr std::uint64_t kGrid = 1 << 14;
+  static constexpr std::int64_t kNeighbors = 8;
+
+  RoundSetup<F> roundSetup (FE_TONEAREST);
+  // The result sign, or 2 for NaN.
+  auto sign = [&] (std::int64_t o) {
+    const F y = ref (distribution::fromOrdered<F> (o), FE_TONEAREST);
+    return std::isnan (y) ? 2 : (y > F (0)) - (y < F (0));
+  };
+
+  const std::int64_t a = distribution::toOrdered (sample.arg.start);
+  const std::int64_t b = distribution::toOrdered (sample.arg.end);
+  const std::uint64_t n = static_cast<std::uint64_t> (b - a);
+
+  std::vector<std::int64_t> crossings;
+  std::int64_t prev = a;
+  int sprev = sign (a);
+  if (sprev == 0)
+    crossings.push_back (a);
+  for (std::uint64_t i = 1; i <= kGrid; i++)
+    {
+      // floor (n * i / kGrid) without overflow.
+      const std::int64_t o = a
+			     + static_cast<std::int64_t> (
+				 n / kGrid * i + n % kGrid * i / kGrid);
+      if (o == prev)
+	continue;
+      const int s = sign (o);
+      if (s == 0)
+	crossings.push_back (o);
+      else if (sprev != 0 && sprev != 2 && s != 2 && s != sprev)
+	crossings.push_back (bisectFirst (
+	    prev + 1, o, [&] (std::int64_t x) { return sign (x) == s; }));
+      prev = o;
+      sprev = s;
+    }
+  if (crossings.empty ())
+    error ("no zero in [{:a}, {:a}]", sample.arg.start, sample.arg.end);
+
+  // The inputs closest to each crossing first.
+  hotspots::Closest<F> closest (sample.count);
+  for (auto c : crossings)
+    for (std::int64_t d = -kNeighbors; d <= kNeighbors; d++)
+      if (c + d >= a && c + d <= b)
+	closest.add (distribution::fromOrdered<F> (c + d), std::abs (d));
+  printlnTimestamp ("Found {} zeros in [{:a}, {:a}]", crossings.size (),
+		    sample.arg.start, sample.arg.end);
+
+  std::vector<F> values;
+  for (const auto &c : closest.sorted ())
+    values.push_back (c.x);
+  return values;
+}
+
+template <typename RET>
+static void
+checkHotspots (
+    const std::string_view &funcname,
+    const std::vector<typename RET::FloatType> &values,
+    const SampleList<RET> &funcs,
+    const Description::HotspotSample<typename RET::FloatType> &sample,
+    const RoundSet &roundModes, FailMode failmode)
+{
+  using FloatType = typename RET::FloatType;
+
+  const auto range = shardRange (values.size ());
+  printlnTimestamp ("Checking {} {} hotspots in [{:a}, {:a}]",
+		    range.second - range.first, hotspots::name (sample.kind),
+		    sample.arg.start, sample.arg.end);
+  checkList (funcname,
+	     std::vector<FloatType> (values.begin () + range.first,
+				     values.begin () + range.second),
+	     funcs, roundModes, failmode, false);
+}
+
+template <typename F>
+static void
+runFloat (const Description &desc, const RoundSet &roundModes,
+	  FailMode failmode, const std::string &max_ulp_str)
+{
+  auto func = getFunctionFloat<F> (desc.FunctionName).value ();
+  if (!func.first)
+    error ("libc does not provide {}", desc.FunctionName);
+
+  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
+  if (!max_ulp)
+    error ("invalid floating point: {}", max_ulp_str);
+
+  printlnTimestamp ("Checking function {}", desc.FunctionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  for (auto &descSample : desc.Samples)
+    {
+      const auto sample = resultSample (func.second, descSample);
+      if (auto *psample = std::get_if<Description::Sample1Arg<F> > (&sample);
+	  psample && searchBudget)
+	searchFloat (desc.FunctionName,
+		     ListFloat<F>{ func.first, func.second, max_ulp.value () },
+		     *psample, roundModes, failmode);
+      else if (psample && indexedSample (psample->seq))
+	checkSequenceFloat (
+	    desc.FunctionName,
+	    ListFloat<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample)
+	checkRandomFloat (
+	    desc.FunctionName,
+	    RandomFloat<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else if (auto *psample
+	       = std::get_if<Description::HotspotSample<F> > (&sample))
+	checkHotspots (
+	    desc.FunctionName,
+	    psample->kind == Description::Hotspot::ZEROS
+		? hotspotZeros (func.second, *psample)
+		: hotspotMultiples (*psample),
+	    ListFloat<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (auto *psample = std::get_if<Description::FullRange> (&sample);
+	       psample && searchBudget)
+	searchSkipFull (*psample);
+      else if (psample)
+	checkFullBlock (
+	    desc.FunctionName,
+	    FullFloat<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else
+	error ("invalid sample type");
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+template <typename F>
+static void
+runFloatpFloatp (const Description &desc, const RoundSet &roundModes,
+		 FailMode failmode, const std::string &max_ulp_str)
+{
+  auto func = getFunctionFloatpFloatp<F> (desc.FunctionName).value ();
+  if (!func.first)
+    error ("libc does not provide {}", desc.FunctionName);
+
+  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
+  if (!max_ulp)
+    error ("invalid floating point: {}", max_ulp_str);
+
+  printlnTimestamp ("Checking function {}", desc.FunctionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  for (auto &sample : desc.Samples)
+    {
+      if (auto *psample = std::get_if<Description::Sample1Arg<F> > (&sample);
+	  psample && searchBudget)
+	searchFloat (
+	    desc.FunctionName,
+	    ListFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample && indexedSample (psample->seq))
+	checkSequenceFloat (
+	    desc.FunctionName,
+	    ListFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample)
+	checkRandomFloat (
+	    desc.FunctionName,
+	    RandomFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else if (auto *psample
+	       = std::get_if<Description::HotspotSample<F> > (&sample))
+	checkHotspots (
+	    desc.FunctionName, hotspotMultiples (*psample),
+	    ListFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (auto *psample = std::get_if<Description::FullRange> (&sample);
+	       psample && searchBudget)
+	searchSkipFull (*psample);
+      else if (psample)
+	checkFull (
+	    desc.FunctionName,
+	    FullFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else
+	error ("invalid sample type");
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+template <typename F>
+static void
+runFloatFloat (const Description &desc, const RoundSet &roundModes,
+	       FailMode failmode, const std::string &max_ulp_str)
+{
+  auto func = getFunctionFloatFloat<F> (desc.FunctionName).value ();
+  if (!func.first)
+    error ("libc does not provide {}", desc.FunctionName);
+
+  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
+  if (!max_ulp)
+    error ("invalid floating point: {}", max_ulp_str);
+
+  printlnTimestamp ("Checking FunctionName {}", desc.FunctionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  for (auto &sample : desc.Samples)
+    {
+      if (auto *psample = std::get_if<Description::Sample2Arg<F> > (&sample);
+	  psample && searchBudget)
+	searchFloatArg2<ResultFloatFloat<F>, ulpsearch::FloatRange<F> > (
+	    desc.FunctionName,
+	    ListFloatFloat<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample && indexedSample (psample->seq))
+	checkSequenceFloatFloat (
+	    desc.FunctionName,
+	    ListFloatFloat<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample)
+	checkRandomFloatFloat (
+	    desc.FunctionName,
+	    RandomFloatFloat<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else
+	error ("invalid sample type");
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+template <typename F>
+static void
+runFloatLLI (const Description &desc, const RoundSet &roundModes,
+	     FailMode failmode, const std::string &max_ulp_str)
+{
+  auto func = getFunctionFloatLLI<F> (desc.FunctionName).value ();
+  if (!func.first)
+    error ("libc does not provide {}", desc.FunctionName);
+
+  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
+  if (!max_ulp)
+    error ("invalid floating point: {}", max_ulp_str);
+
+  printlnTimestamp ("Checking FunctionName {}", desc.FunctionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  for (auto &sample : desc.Samples)
+    {
+      if (auto *psample
+	  = std::get_if<Description::Sample2ArgLli<F> > (&sample);
+	  psample && searchBudget)
+	searchFloatArg2<ResultFloatLLI<F>, ulpsearch::IntegerRange> (
+	    desc.FunctionName,
+	    ListFloatLLI<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample && indexedSample (psample->seq))
+	checkSequenceFloatLLI (
+	    desc.FunctionName,
+	    ListFloatLLI<F>{ func.first, func.second, max_ulp.value () },
+	    *psample, roundModes, failmode);
+      else if (psample)
+	checkRandomFloatLLI (
+	    desc.FunctionName,
+	    RandomFloatLLI<F>{ func.first, func.second, max_ulp.value () },
+	    shardSample (*psample), roundModes, failmode);
+      else
+	error ("invalid sample type");
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+template <typename F>
+static void
+runFloatList (const std::string &functionName, const std::vector<F> &values,
+	      const RoundSet &roundModes, FailMode failmode,
+	      const std::string &maxUlpStr, bool printAll)
+{
+  auto func = getFunctionFloat<F> (functionName).value ();
+  if (!func.first)
+    error ("libc does not provide {}", functionName);
+
+  const auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+
+  printlnTimestamp ("Checking function {}", functionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  checkList<ResultFloat<F> > (
+      functionName, values,
+      ListFloat<F>{ func.first, func.second, maxUlp.value () }, roundModes,
+      failmode, printAll);
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+// Check the list inputs ARGS (the argument bit patterns, as in the argument
+// traces and the corpus entries) of the two argument and sincos functions.
+template <typename F>
+static void
+runArgsList (const std::string &functionName,
+	     refimpls::FunctionType functype,
+	     const std::vector<argtrace::Args> &args,
+	     const RoundSet &roundModes, FailMode failmode,
+	     const std::string &maxUlpStr, bool printAll)
+{
+  const auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+
+  printlnTimestamp ("Checking function {}", functionName);
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  switch (functype)
+    {
+    case refimpls::FunctionType::f32_f_f:
+    case refimpls::FunctionType::f64_f_f:
+      {
+	auto func = getFunctionFloatFloat<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	ListFloatFloat<F> list{ func.first, func.second, maxUlp.value () };
+	checkListCases<ResultFloatFloat<F> > (
+	    functionName, args.size (),
+	    [&] (std::size_t i, int rnd) {
+	      return list (args[i].first<F> (), args[i].second<F> (), rnd);
+	    },
+	    roundModes, failmode, printAll);
+      }
+      break;
+    case refimpls::FunctionType::f32_f_lli:
+    case refimpls::FunctionType::f64_f_lli:
+      {
+	auto func = getFunctionFloatLLI<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	ListFloatLLI<F> list{ func.first, func.second, maxUlp.value () };
+	checkListCases<ResultFloatLLI<F> > (
+	    functionName, args.size (),
+	    [&] (std::size_t i, int rnd) {
+	      return list (args[i].first<F> (),
+			   static_cast<long long int> (args[i].y), rnd);
+	    },
+	    roundModes, failmode, printAll);
+      }
+      break;
+    case refimpls::FunctionType::f32_f_fp_fp:
+    case refimpls::FunctionType::f64_f_fp_fp:
+      {
+	auto func = getFunctionFloatpFloatp<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	ListFloatpFloatp<F> list{ func.first, func.second, maxUlp.value () };
+	checkListCases<ResultFloatpFloatp<F> > (
+	    functionName, args.size (),
+	    [&] (std::size_t i, int rnd) {
+	      return list (args[i].first<F> (), rnd);
+	    },
+	    roundModes, failmode, printAll);
+      }
+      break;
+    default:
+      std::unreachable ();
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+template <typename F>
+static std::vector<F>
+stringListToFPList (const std::vector<std::string> &valueList)
+{
+  auto view = valueList | std::views::transform ([] (const std::string &s) {
+		auto result = floatrange::fromStr<F> (s);
+		if (!result.has_value ())
+		  error ("invalid number: {}", s);
+		return result.value ();
+	      });
+
+  std::vector<F> numbers (view.begin (), view.end ());
+  return numbers;
+}
+
+// Captured arguments file or directory (see argcapture), used as the list
+// mode values with --argtrace.
+static std::optional<std::string> argtraceFile;
+
+template <typename F>
+static std::vector<F>
+listValues (const std::string &functionName,
+	    const std::vector<std::string> &values)
+{
+  if (!argtraceFile)
+    return stringListToFPList<F> (values);
+
+  auto r = argtrace::readFirstArguments<F> (*argtraceFile, functionName);
+  if (!r)
+    error ("{}", r.error ());
+  return r.value ();
+}
+
+// Size of the second argument of the two argument and sincos (none)
+// function types.
+template <typename F>
+static std::size_t
+argYSize (refimpls::FunctionType functype)
+{
+  switch (functype)
+    {
+    case refimpls::FunctionType::f32_f_f:
+    case refimpls::FunctionType::f64_f_f:
+      return sizeof (F);
+    case refimpls::FunctionType::f32_f_lli:
+    case refimpls::FunctionType::f64_f_lli:
+      return sizeof (long long int);
+    default:
+      return 0;
+    }
+}
+
+// The --argtrace arguments of FUNCTIONNAME, a two argument or sincos
+// function whose second argument is YSIZE bytes (0 for sincos).
+template <typename F>
+static std::vector<argtrace::Args>
+listArgs (const std::string &functionName, std::size_t ysize)
+{
+  if (!argtraceFile)
+    error ("the list mode of {} requires --argtrace", functionName);
+
+  std::vector<argtrace::Args> args;
+  auto type = argtrace::readArguments (*argtraceFile, functionName, args);
+  if (!type)
+    error ("{}", type.error ());
+  if (argtrace::argSizes (type.value ())
+      != std::make_pair (sizeof (F), ysize))
+    error ("{}: invalid argument type for {}", *argtraceFile, functionName);
+  return args;
+}
+
+template <typename F>
+static std::vector<F>
+corpusToFPList (const std::vector<Corpus::Entry> &entries)
+{
+  auto view = entries | std::views::transform ([] (const Corpus::Entry &e) {
+		return floatrange::Limits<F>::from (e.x);
+	      });
+
+  std::vector<F> numbers (view.begin (), view.end ());
+  return numbers;
+}
+
+static std::vector<argtrace::Args>
+corpusToArgs (const std::vector<Corpus::Entry> &entries)
+{
+  std::vector<argtrace::Args> args;
+  args.reserve (entries.size ());
+  for (const auto &e : entries)
+    args.push_back (argtrace::Args{ e.x, e.y });
+  return args;
+}
+
+//
+// handleSmoke: check all the corpus entries of FUNCTIONNAME for all rounding
+//              modes.  It is used either as the --smoke mode or as a quick
+//              check before the description samples.
+//
+
+static void
+handleSmoke (const std::string &functionName, const RoundSet &roundModes,
+	     FailMode failmode, const std::string &maxUlp)
+{
+  auto functype = getFunctionType (functionName);
+  if (!functype)
+    error ("invalid FunctionName: {}", functionName);
+
+  if (corpus->entries ().empty ())
+    {
+      printlnTimestamp ("Corpus {} is empty", corpus->path ());
+      printlnTimestamp ("");
+      return;
+    }
+
+  printlnTimestamp ("Checking corpus {} ({} entries)", corpus->path (),
+		    corpus->entries ().size ());
+
+  switch (functype.value ())
+    {
+    case refimpls::FunctionType::f32_f:
+      runFloatList<float> (functionName,
+			   corpusToFPList<float> (corpus->entries ()),
+			   roundModes, failmode, maxUlp, false);
+      break;
+    case refimpls::FunctionType::f64_f:
+      runFloatList<double> (functionName,
+			    corpusToFPList<double> (corpus->entries ()),
+			    roundModes, failmode, maxUlp, false);
+      break;
+    case refimpls::FunctionType::f32_f_f:
+    case refimpls::FunctionType::f32_f_lli:
+    case refimpls::FunctionType::f32_f_fp_fp:
+      runArgsList<float> (functionName, functype.value (),
+			  corpusToArgs (corpus->entries ()), roundModes,
+			  failmode, maxUlp, false);
+      break;
+    case refimpls::FunctionType::f64_f_f:
+    case refimpls::FunctionType::f64_f_lli:
+    case refimpls::FunctionType::f64_f_fp_fp:
+      runArgsList<double> (functionName, functype.value (),
+			   corpusToArgs (corpus->entries ()), roundModes,
+			   failmode, maxUlp, false);
+      break;
+    }
+
+  printlnTimestamp ("");
+}
+
+//
+// handleSweep: check the binary32 FUNCTIONS against their golden tables over
+//              the full input range in a single pass.  Each block of inputs
+//              is evaluated by all the functions, so the input generation,
+//              loop overhead and block scheduling are shared.  With "all"
+//              every function with a golden table is checked.
+//
+
+struct SweepFunction
+{
+  std::string name;
+  std::pair<FuncF<float>, FuncFReference<float> > impl;
+  FullFloat<float> funcs;
+  std::optional<goldentable::TableSet> golden;
+  UlpAccumulator<float> ulpacc;
+
+  SweepFunction (const std::string &n,
+		 const std::pair<FuncF<float>, FuncFReference<float> > &i,
+		 float maxUlp)
+      : name (n), impl (i), funcs (impl.first, impl.second, maxUlp)
+  {
+  }
+};
+
+static void
+handleSweep (const std::string &functionNames, const RoundSet &roundModes,
+	     const std::string &maxUlpStr)
+{
+  const auto maxUlp = floatrange::fromStr<float> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+
+  std::vector<std::string> names;
+  if (functionNames == "all")
+    {
+      auto r = goldentable::functions (*goldenDir);
+      if (!r)
+	error ("{}", r.error ());
+      for (const auto &name : r.value ())
+	if (auto functype = getFunctionType (name);
+	    functype && functype.value () == refimpls::FunctionType::f32_f)
+	  names.push_back (name);
+    }
+  else
+    for (const auto &name : strhelper::splitWithRanges (functionNames, ","))
+      names.push_back (std::string (name));
+
+  // SweepFunction is not movable (FUNCS refers to IMPL).
+  std::vector<std::unique_ptr<SweepFunction> > functions;
+  for (const auto &name : names)
+    {
+      auto functype = getFunctionType (name);
+      if (!functype)
+	error ("invalid FunctionName: {}", name);
+      if (functype.value () != refimpls::FunctionType::f32_f)
+	error ("function type \"{}\" not supported by --sweep",
+	       functype.value ());
+      auto impl = getFunctionFloat<float> (name).value ();
+      if (!impl.first)
+	error ("libc does not provide {}", name);
+      functions.push_back (
+	  std::make_unique<SweepFunction> (name, impl, maxUlp.value ()));
+    }
+  if (functions.empty ())
+    error ("no functions to sweep");
+
+  const auto sample = shardSample (
+      Description::FullRange{ "full range", 0, UINT64_C (1) << 32 });
+  static constexpr std::uint64_t kChunkSize
+      = kFullBlockSize * kFullChunkBlocks;
+
+  printlnTimestamp ("Checking {} functions", functions.size ());
+  printlnTimestamp ("");
+
+  auto start = ClockType::now ();
+
+  for (auto &rnd : roundModes)
+    {
+      for (auto &f : functions)
+	{
+	  f->golden = openGolden<float> (f->name, rnd);
+	  f->ulpacc.clear ();
+	}
+      std::uint64_t goldenBytes = 0;
+
+      auto rndStart = ClockType::now ();
+
+#pragma omp parallel shared(functions, rnd) reduction(+ : goldenBytes)
+      {
+	RoundSetup<float> roundSetup (rnd.mode);
+	std::vector<ulpkernel::LaneHistogram<float> > histograms (
+	    functions.size ());
+
+	float inputs[kFullBlockSize];
+	float computed[kFullBlockSize];
+	float expected[kFullBlockSize];
+	float ulps[kFullBlockSize];
+	std::uint8_t valid[kFullBlockSize];
+
+#pragma omp for schedule(dynamic, kFullChunkBlocks)
+	for (std::uint64_t b = sample.start; b < sample.end;
+	     b += kFullBlockSize)
+	  {
+	    const std::size_t n = std::min (kFullBlockSize, sample.end - b);
+	    for (std::size_t i = 0; i < n; i++)
+	      inputs[i] = floatrange::Limits<float>::from (b + i);
+
+	    for (std::size_t f = 0; f < functions.size (); f++)
+	      {
+		const SweepFunction &fn = *functions[f];
+		const std::uint32_t *table = nullptr;
+		if (fn.golden)
+		  {
+		    if ((b - sample.start) % kChunkSize == 0)
+		      fn.golden->prefetch (
+			  b, std::min (kChunkSize, sample.end - b));
+		    table = fn.golden->find (b, n);
+		    if (table != nullptr)
+		      goldenBytes += n * sizeof (std::uint32_t);
+		  }
+		fn.funcs.evalInputs (inputs, n, rnd.mode, computed, expected,
+				     table);
+		ulpkernel::compareBlock (computed, expected, n,
+					 fn.funcs.max_ulp, ulps, valid);
+		histograms[f].add (ulps, n);
+	      }
+	  }
+
+#pragma omp critical
+	for (std::size_t f = 0; f < functions.size (); f++)
+	  histograms[f].mergeInto (functions[f]->ulpacc);
+      }
+
+      printGoldenBandwidth (goldenBytes, rndStart);
+      for (const auto &f : functions)
+	printAccumulator (
+	    rnd.name,
+	    Description::FullRange{ f->name, sample.start, sample.end },
+	    f->ulpacc);
+      printlnTimestamp ("");
+    }
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+static void
+handleDescription (const std::string &descFile, const RoundSet &roundModes,
+		   FailMode failmode, const std::string &maxUlp,
+		   const std::optional<std::string> &corpusDir, bool smoke)
+{
+  Description desc;
+  if (auto r = desc.parse (descFile); !r)
+    error ("{}", r.error ());
+
+  initRandomState ();
+
+  auto functype = getFunctionType (desc.FunctionName);
+  if (!functype)
+    error ("invalid FunctionName: {}", desc.FunctionName);
+
+  openCorpus (corpusDir, desc.FunctionName);
+  openTrace (desc.FunctionName, functype.value ());
+  if (corpus)
+    {
+      handleSmoke (desc.FunctionName, roundModes, failmode, maxUlp);
+      if (smoke)
+	{
+	  saveCorpus ();
+	  closeTrace ();
+	  return;
+	}
+    }
+
+  switch (functype.value ())
+    {
+    case refimpls::FunctionType::f32_f:
+      runFloat<float> (desc, roundModes, failmode, maxUlp);
+      break;
+    case refimpls::FunctionType::f64_f:
+      runFloat<double> (desc, roundModes, failmode, maxUlp);
+      break;
+
+    case refimpls::FunctionType::f32_f_f:
+      runFloatFloat<float> (desc, roundModes, failmode, maxUlp);
+      break;
+    case refimpls::FunctionType::f64_f_f:
+      runFloatFloat<double> (desc, roundModes, failmode, maxUlp);
+      break;
+
+    case refimpls::FunctionType::f32_f_lli:
+      runFloatLLI<float> (desc, roundModes, failmode, maxUlp);
+      break;
+    case refimpls::FunctionType::f64_f_lli:
+      runFloatLLI<double> (desc, roundModes, failmode, maxUlp);
+      break;
+
+    case refimpls::FunctionType::f32_f_fp_fp:
+      runFloatpFloatp<float> (desc, roundModes, failmode, maxUlp);
+      break;
+    case refimpls::FunctionType::f64_f_fp_fp:
+      runFloatpFloatp<double> (desc, roundModes, failmode, maxUlp);
+      break;
+
+    default:
+      error ("function type \"{}\" not implemented", functype.value ());
+    }
+
+  saveCorpus ();
+  closeTrace ();
+}
+
+//
+// SeedWriter: write fuzzulps seed corpus files, one input per file.
+//
+
+class SeedWriter
+{
+  const std::string dir;
+  const std::string prefix;
+  std::uint64_t count = 0;
+
+public:
+  SeedWriter (const std::string &d, const std::string &p) : dir (d), prefix (p)
+  {
+    std::error_code ec;
+    std::filesystem::create_directories (dir, ec);
+    if (ec)
+      error ("creating seeds directory {}: {}", dir, ec.message ());
+  }
+
+  template <typename... Args>
+  void
+  operator() (Args... args)
+  {
+    auto name = (std::filesystem::path (dir)
+		 / std::format ("{}-{:06}", prefix, count++))
+		    .string ();
+    if (!fuzzinput::writeSeed (name, fuzzinput::encode (args...)))
+      error ("writing seed {}", name);
+  }
+
+  std::uint64_t
+  size () const
+  {
+    return count;
+  }
+};
+
+// Number of random seeds exported for each description sample, along with
+// the range limits.
+static constexpr std::uint64_t kSeedsPerSample = 64;
+
+template <typename F>
+static void
+exportSeeds (SeedWriter &seeds, RngType &gen,
+	     const Description::Sample1Arg<F> &sample)
+{
+  seeds (sample.arg.start);
+  seeds (sample.arg.end);
+
+  std::uniform_real_distribution<F> dist (sample.arg.start, sample.arg.end);
+  for (std::uint64_t i = 0; i < std::min (sample.count, kSeedsPerSample); i++)
+    seeds (dist (gen));
+}
+
+// The hot spots are exported as the range limits and the multiples closest
+// to the constant (the zeros need the reference).
+template <typename F>
+static void
+exportSeeds (SeedWriter &seeds, RngType &gen,
+	     const Description::HotspotSample<F> &sample)
+{
+  seeds (sample.arg.start);
+  seeds (sample.arg.end);
+
+  if (sample.kind == Description::Hotspot::ZEROS)
+    return;
+  for (const auto &c : hotspots::multiples (
+	   sample.kind, sample.arg.start, sample.arg.end,
+	   std::min (sample.count, kSeedsPerSample)))
+    seeds (c.x);
+}
+
+template <typename F>
+static void
+exportSeeds (SeedWriter &seeds, RngType &gen,
+	     const Description::Sample2Arg<F> &sample)
+{
+  seeds (sample.arg_x.start, sample.arg_y.start);
+  seeds (sample.arg_x.start, sample.arg_y.end);
+  seeds (sample.arg_x.end, sample.arg_y.start);
+  seeds (sample.arg_x.end, sample.arg_y.end);
+
+  std::uniform_real_distribution<F> distX (sample.arg_x.start,
+					   sample.arg_x.end);
+  std::uniform_real_distribution<F> distY (sample.arg_y.start,
+					   sample.arg_y.end);
+  for (std::uint64_t i = 0; i < std::min (sample.count, kSeedsPerSample); i++)
+    {
+      F x = distX (gen);
+      F y = distY (gen);
+      seeds (x, y);
+    }
+}
+
+template <typename F>
+static void
+exportSeeds (SeedWriter &seeds, RngType &gen,
+	     const Description::Sample2ArgLli<F> &sample)
+{
+  seeds (sample.arg_x.start, sample.arg_y.start);
+  seeds (sample.arg_x.start, sample.arg_y.end);
+  seeds (sample.arg_x.end, sample.arg_y.start);
+  seeds (sample.arg_x.end, sample.arg_y.end);
+
+  std::uniform_real_distribution<F> distX (sample.arg_x.start,
+					   sample.arg_x.end);
+  std::uniform_int_distribution<long long int> distY (sample.arg_y.start,
+						      sample.arg_y.end);
+  for (std::uint64_t i = 0; i < std::min (sample.count, kSeedsPerSample); i++)
+    {
+      F x = distX (gen);
+      long long int y = distY (gen);
+      seeds (x, y);
+    }
+}
+
+// Full ranges are exported as evenly spaced bit patterns.
+template <typename F>
+static void
+exportFullSeeds (SeedWriter &seeds, const Description::FullRange &sample)
+{
+  const std::uint64_t step
+      = std::max<std::uint64_t> ((sample.end - sample.start) / kSeedsPerSample,
+				 1);
+  for (std::uint64_t n = sample.start; n < sample.end; n += step)
+    seeds (floatrange::Limits<F>::from (n));
+}
+
+template <typename F>
+static void
+exportCorpusSeeds (SeedWriter &seeds, refimpls::FunctionType functype)
+{
+  for (const auto &e : corpus->entries ())
+    switch (functype)
+      {
+      case refimpls::FunctionType::f32_f_f:
+      case refimpls::FunctionType::f64_f_f:
+	seeds (floatrange::Limits<F>::from (e.x),
+	       floatrange::Limits<F>::from (e.y));
+	break;
+      case refimpls::FunctionType::f32_f_lli:
+      case refimpls::FunctionType::f64_f_lli:
+	seeds (floatrange::Limits<F>::from (e.x),
+	       static_cast<long long int> (e.y));
+	break;
+      default:
+	seeds (floatrange::Limits<F>::from (e.x));
+	break;
+      }
+}
+
+template <typename F>
+static void
+exportDescriptionSeeds (const Description &desc,
+			refimpls::FunctionType functype, SeedWriter &seeds)
+{
+  RngType gen (rngStates[0]);
+
+  for (auto &sample : desc.Samples)
+    std::visit (
+	[&] (auto &&arg) {
+	  using T = std::decay_t<decltype (arg)>;
+	  if constexpr (std::is_same_v<T, Description::FullRange>)
+	    exportFullSeeds<F> (seeds, arg);
+	  else
+	    exportSeeds (seeds, gen, arg);
+	},
+	sample);
+
+  if (corpus)
+    exportCorpusSeeds<F> (seeds, functype);
+}
+
+//
+// handleExportSeeds: write a fuzzulps seed corpus from the description
+//                    samples (range limits and random inputs) and from the
+//                    hard inputs corpus, if any.
+//
+
+static void
+handleExportSeeds (const std::string &descFile, const std::string &seedsDir,
+		   const std::optional<std::string> &corpusDir)
+{
+  Description desc;
+  if (auto r = desc.parse (descFile); !r)
+    error ("{}", r.error ());
+
+  initRandomState ();
+
+  auto functype = getFunctionType (desc.FunctionName);
+  if (!functype)
+    error ("invalid FunctionName: {}", desc.FunctionName);
+
+  openCorpus (corpusDir, desc.FunctionName);
+
+  SeedWriter seeds (seedsDir, desc.FunctionName);
+  switch (functype.value ())
+    {
+    case refimpls::FunctionType::f32_f:
+    case refimpls::FunctionType::f32_f_f:
+    case refimpls::FunctionType::f32_f_lli:
+    case refimpls::FunctionType::f32_f_fp_fp:
+      exportDescriptionSeeds<float> (desc, functype.value (), seeds);
+      break;
+    case refimpls::FunctionType::f64_f:
+    case refimpls::FunctionType::f64_f_f:
+    case refimpls::FunctionType::f64_f_lli:
+    case refimpls::FunctionType::f64_f_fp_fp:
+      exportDescriptionSeeds<double> (desc, functype.value (), seeds);
+      break;
+    }
+
+  printlnTimestamp ("Exported {} seeds to {}", seeds.size (), seedsDir);
+}
+
+template <typename F>
+static void
+addToCorpus (const std::vector<F> &values)
+{
+  if (corpus)
+    for (auto v : values)
+      corpus->add (floatrange::Limits<F>::to (v), 0, Corpus::MANUAL);
+}
+
+static void
+addToCorpus (const std::vector<argtrace::Args> &args)
+{
+  if (corpus)
+    for (const auto &a : args)
+      corpus->add (a.x, a.y, Corpus::MANUAL);
+}
+
+static void
+handleList (const std::string &functionName,
+	    const std::vector<std::string> &values, const RoundSet &roundModes,
+	    FailMode failmode, const std::string &maxUlp,
+	    const std::optional<std::string> &corpusDir)
+{
+  auto functype = getFunctionType (functionName);
+  if (!functype)
+    error ("invalid FunctionName: {}", functionName);
+
+  openCorpus (corpusDir, functionName);
+  openTrace (functionName, functype.value ());
+
+  switch (functype.value ())
+    {
+    case refimpls::FunctionType::f32_f:
+      {
+	auto fvalues = listValues<float> (functionName, values);
+	addToCorpus (fvalues);
+	runFloatList<float> (functionName, fvalues, roundModes, failmode,
+			     maxUlp, true);
+      }
+      break;
+    case refimpls::FunctionType::f64_f:
+      {
+	auto fvalues = listValues<double> (functionName, values);
+	addToCorpus (fvalues);
+	runFloatList<double> (functionName, fvalues, roundModes, failmode,
+			      maxUlp, true);
+      }
+      break;
 
-  auto start = ClockType::now ();
+    case refimpls::FunctionType::f32_f_f:
+    case refimpls::FunctionType::f32_f_lli:
+    case refimpls::FunctionType::f32_f_fp_fp:
+      {
+	auto args = listArgs<float> (functionName,
+				     argYSize<float> (functype.value ()));
+	addToCorpus (args);
+	runArgsList<float> (functionName, functype.value (), args,
+			    roundModes, failmode, maxUlp, true);
+      }
+      break;
+    case refimpls::FunctionType::f64_f_f:
+    case refimpls::FunctionType::f64_f_lli:
+    case refimpls::FunctionType::f64_f_fp_fp:
+      {
+	auto args = listArgs<double> (functionName,
+				      argYSize<double> (functype.value ()));
+	addToCorpus (args);
+	runArgsList<double> (functionName, functype.value (), args,
+			     roundModes, failmode, maxUlp, true);
+      }
+      break;
 
-  for (auto &sample : desc.Samples)
-    {
-      if (auto *psample = std::get_if<Description::Sample1Arg<F> > (&sample))
-	checkRandomFloat (
-	    desc.FunctionName,
-	    RandomFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
-	    *psample, roundModes, failmode);
-      else if (auto *psample = std::get_if<Description::FullRange> (&sample))
-	checkFull (
-	    desc.FunctionName,
-	    FullFloatpFloatp<F>{ func.first, func.second, max_ulp.value () },
-	    *psample, roundModes, failmode);
-      else
-	error ("invalid sample type");
+    default:
+      error ("function type \"{}\" not implemented", functype.value ());
     }
 
-  auto end = ClockType::now ();
-  printlnTimestamp (
-      "Total elapsed time {}",
-      std::chrono::duration_cast<std::chrono::duration<double> > (end
-								  - start));
+  saveCorpus ();
+  closeTrace ();
 }
 
-template <typename F>
-static void
-runFloatFloat (const Description &desc, const RoundSet &roundModes,
-	       FailMode failmode, const std::string &max_ulp_str)
+// Check the cases TESTS, evaluated with EVAL (index, rounding mode), in the
+// rounding mode RND, and print the ULP histogram.  Returns the number of
+// failures.
+template <typename RET, typename EVAL>
+static std::uint64_t
+checkCases (const std::vector<std::size_t> &tests, const EVAL &eval,
+	    const RoundMode &rnd, FailMode failmode)
 {
-  auto func = getFunctionFloatFloat<F> (desc.FunctionName).value ();
-  if (!func.first)
-    error ("libc does not provide {}", desc.FunctionName);
+  using FloatType = typename RET::FloatType;
 
-  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
-  if (!max_ulp)
-    error ("invalid floating point: {}", max_ulp_str);
+  std::vector<std::unique_ptr<RET> > results (tests.size ());
 
-  printlnTimestamp ("Checking FunctionName {}", desc.FunctionName);
-  printlnTimestamp ("");
+#pragma omp parallel shared(tests, results)
+  {
+    RoundSetup<FloatType> roundSetup (rnd.mode);
 
-  auto start = ClockType::now ();
+#pragma omp for schedule(dynamic)
+    for (std::size_t i = 0; i < tests.size (); i++)
+      results[i] = eval (tests[i], rnd.mode);
+  }
 
-  for (auto &sample : desc.Samples)
+  UlpAccumulator<FloatType> ulpacc;
+  std::uint64_t failures = 0;
+  for (const auto &ret : results)
     {
-      if (auto *psample = std::get_if<Description::Sample2Arg<F> > (&sample))
-	checkRandomFloatFloat (
-	    desc.FunctionName,
-	    RandomFloatFloat<F>{ func.first, func.second, max_ulp.value () },
-	    *psample, roundModes, failmode);
-      else
-	error ("invalid sample type");
+      ulpacc[ret->ulp]++;
+      if (ret->checkFull ())
+	continue;
+      failures++;
+      switch (failmode)
+	{
+	case FailMode::FIRST:
+	case FailMode::ALL:
+	  printlnErrorTimestamp ("{}", *ret);
+	  if (failmode == FailMode::FIRST)
+	    exitFailure (*ret);
+	  [[fallthrough]];
+	default:
+	  break;
+	}
     }
 
-  auto end = ClockType::now ();
-  printlnTimestamp (
-      "Total elapsed time {}",
-      std::chrono::duration_cast<std::chrono::duration<double> > (end
-								  - start));
+  printlnTimestamp ("Checking rounding mode {:13}, count {}, failures {}",
+		    rnd.name, tests.size (), failures);
+  for (const auto &ulp : ulpacc)
+    printlnTimestamp ("    {:g}: {:16} {:6.2f}%", ulp.first, ulp.second,
+		      ((double) ulp.second / (double) tests.size ()) * 100.0);
+
+  return failures;
 }
 
-template <typename F>
+//
+// handleLibmTest: check the libc functions against the correctly rounded
+//                 results of the glibc auto-libm-test-out files (see
+//                 libmtest.h).  The expected values are precomputed, so no
+//                 MPFR evaluation is done.
+//
+
+template <typename RET, typename EVAL>
 static void
-runFloatLLI (const Description &desc, const RoundSet &roundModes,
-	     FailMode failmode, const std::string &max_ulp_str)
+checkLibmTests (const std::vector<int> &rounding, const EVAL &eval,
+		const RoundSet &roundModes, FailMode failmode)
 {
-  auto func = getFunctionFloatLLI<F> (desc.FunctionName).value ();
-  if (!func.first)
-    error ("libc does not provide {}", desc.FunctionName);
-
-  const auto max_ulp = floatrange::fromStr<F> (max_ulp_str);
-  if (!max_ulp)
-    error ("invalid floating point: {}", max_ulp_str);
+  for (auto &rnd : roundModes)
+    {
+      std::vector<std::size_t> tests;
+      for (std::size_t i = 0; i < rounding.size (); i++)
+	if (rounding[i] == rnd.mode)
+	  tests.push_back (i);
+      if (!tests.empty ())
+	checkCases<RET> (tests, eval, rnd, failmode);
+    }
 
-  printlnTimestamp ("Checking FunctionName {}", desc.FunctionName);
   printlnTimestamp ("");
+}
 
-  auto start = ClockType::now ();
+// The inputs and expected results of the test LINES with NARGS inputs and
+// NOUTS outputs, parsed as X (and Y) and the results as F.  The lines the
+// function can not take (another input count or type) are skipped.
+template <typename F, typename X, typename Y> struct LibmTestCases
+{
+  std::vector<int> rounding;
+  std::vector<X> x;
+  std::vector<Y> y;
+  std::vector<std::array<F, 2> > expected;
+  std::size_t skipped = 0;
+};
 
-  for (auto &sample : desc.Samples)
+template <typename F, typename X, typename Y>
+static LibmTestCases<F, X, Y>
+libmTestCases (const std::vector<libmtest::Line> &lines, std::size_t nargs,
+	       std::size_t nouts)
+{
+  LibmTestCases<F, X, Y> ret;
+  for (const auto &line : lines)
     {
-      if (auto *psample
-	  = std::get_if<Description::Sample2ArgLli<F> > (&sample))
-	checkRandomFloatLLI (
-	    desc.FunctionName,
-	    RandomFloatLLI<F>{ func.first, func.second, max_ulp.value () },
-	    *psample, roundModes, failmode);
-      else
-	error ("invalid sample type");
+      if (line.inputs.size () != nargs || line.outputs.size () < nouts)
+	{
+	  ret.skipped++;
+	  continue;
+	}
+      auto x = libmtest::parseValue<X> (line.inputs[0]);
+      auto y = nargs > 1 ? libmtest::parseValue<Y> (line.inputs[1])
+			 : std::optional<Y> (Y ());
+      // lgamma also lists the sign of the gamma function, which is ignored.
+      auto e0 = libmtest::parseValue<F> (line.outputs[0]);
+      auto e1 = nouts > 1 ? libmtest::parseValue<F> (line.outputs[1])
+			  : std::optional<F> (F ());
+      if (!x || !y || !e0 || !e1)
+	{
+	  ret.skipped++;
+	  continue;
+	}
+      ret.rounding.push_back (line.rounding);
+      ret.x.push_back (*x);
+      ret.y.push_back (*y);
+      ret.expected.push_back ({ *e0, *e1 });
     }
-
-  auto end = ClockType::now ();
-  printlnTimestamp (
-      "Total elapsed time {}",
-      std::chrono::duration_cast<std::chrono::duration<double> > (end
-								  - start));
+  return ret;
 }
 
+template <typename F>
 static void
-handleDescription (const std::string &descFile, const RoundSet &roundModes,
-		   FailMode failmode, const std::string &maxUlp)
+libmTestFunction (const std::string &functionName,
+		  const std::vector<libmtest::Line> &lines,
+		  const RoundSet &roundModes, FailMode failmode,
+		  const std::string &maxUlpStr)
 {
-  Description desc;
-  if (auto r = desc.parse (descFile); !r)
-    error ("{}", r.error ());
+  auto functype = getFunctionType (functionName);
+  if (!functype)
+    {
+      printlnTimestamp ("Skipping function {}: not supported", functionName);
+      printlnTimestamp ("");
+      return;
+    }
 
-  initRandomState ();
+  const auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+  const F max = maxUlp.value ();
 
-  auto functype = getFunctionType (desc.FunctionName);
-  if (!functype)
-    error ("invalid FunctionName: {}", desc.FunctionName);
+  auto run = [&] (const auto &func, const auto &cases, auto &&check) {
+    if (!func.first)
+      {
+	printlnTimestamp ("Skipping function {}: libc does not provide it",
+			  functionName);
+	printlnTimestamp ("");
+	return;
+      }
+    printlnTimestamp ("Checking function {}, tests {}, skipped {}",
+		      functionName, cases.rounding.size (), cases.skipped);
+    check (func.first, cases);
+  };
 
   switch (functype.value ())
     {
     case refimpls::FunctionType::f32_f:
-      runFloat<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f:
-      runFloat<double> (desc, roundModes, failmode, maxUlp);
+      run (getFunctionFloat<F> (functionName).value (),
+	   libmTestCases<F, F, F> (lines, 1, 1),
+	   [&] (const auto &func, const auto &cases) {
+	     checkLibmTests<ResultFloat<F> > (
+		 cases.rounding,
+		 [&] (std::size_t i, int rnd) {
+		   return std::make_unique<ResultFloat<F> > (
+		       rnd, cases.x[i], func (cases.x[i]),
+		       cases.expected[i][0], max);
+		 },
+		 roundModes, failmode);
+	   });
       break;
-
     case refimpls::FunctionType::f32_f_f:
-      runFloatFloat<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_f:
-      runFloatFloat<double> (desc, roundModes, failmode, maxUlp);
+      run (getFunctionFloatFloat<F> (functionName).value (),
+	   libmTestCases<F, F, F> (lines, 2, 1),
+	   [&] (const auto &func, const auto &cases) {
+	     checkLibmTests<ResultFloatFloat<F> > (
+		 cases.rounding,
+		 [&] (std::size_t i, int rnd) {
+		   return std::make_unique<ResultFloatFloat<F> > (
+		       rnd, cases.x[i], cases.y[i],
+		       func (cases.x[i], cases.y[i]), cases.expected[i][0],
+		       max);
+		 },
+		 roundModes, failmode);
+	   });
       break;
-
     case refimpls::FunctionType::f32_f_lli:
-      runFloatLLI<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_lli:
-      runFloatLLI<double> (desc, roundModes, failmode, maxUlp);
+      run (getFunctionFloatLLI<F> (functionName).value (),
+	   libmTestCases<F, F, long long int> (lines, 2, 1),
+	   [&] (const auto &func, const auto &cases) {
+	     checkLibmTests<ResultFloatLLI<F> > (
+		 cases.rounding,
+		 [&] (std::size_t i, int rnd) {
+		   return std::make_unique<ResultFloatLLI<F> > (
+		       rnd, cases.x[i], cases.y[i],
+		       func (cases.x[i], cases.y[i]), cases.expected[i][0],
+		       max);
+		 },
+		 roundModes, failmode);
+	   });
       break;
-
     case refimpls::FunctionType::f32_f_fp_fp:
-      runFloatpFloatp<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_fp_fp:
-      runFloatpFloatp<double> (desc, roundModes, failmode, maxUlp);
+      run (getFunctionFloatpFloatp<F> (functionName).value (),
+	   libmTestCases<F, F, F> (lines, 1, 2),
+	   [&] (const auto &func, const auto &cases) {
+	     checkLibmTests<ResultFloatpFloatp<F> > (
+		 cases.rounding,
+		 [&] (std::size_t i, int rnd) {
+		   F c0, c1;
+		   func (cases.x[i], &c0, &c1);
+		   return std::make_unique<ResultFloatpFloatp<F> > (
+		       rnd, cases.x[i], c0, c1, cases.expected[i][0],
+		       cases.expected[i][1], max);
+		 },
+		 roundModes, failmode);
+	   });
       break;
-
-    default:
-      error ("function type \"{}\" not implemented", functype.value ());
     }
 }
 
-template <typename F>
 static void
-runFloatList (const std::string &functionName, const std::vector<F> &values,
-	      const RoundSet &roundModes, FailMode failmode,
-	      const std::string &maxUlpStr)
+handleLibmTest (const std::string &path,
+		const std::optional<std::string> &symbol,
+		const RoundSet &roundModes, FailMode failmode,
+		const std::string &maxUlp)
 {
-  auto func = getFunctionFloat<F> (functionName).value ();
-  if (!func.first)
-    error ("libc does not provide {}", functionName);
-
-  const auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
-  if (!maxUlp)
-    error ("invalid floating point: {}", maxUlpStr);
-
-  printlnTimestamp ("Checking function {}", functionName);
-  printlnTimestamp ("");
+  auto files = libmtest::testFiles (path);
+  if (files.empty ())
+    error ("no auto-libm-test-out files in {}", path);
+
+  // The test lines by C function name, the binary32 ones with the 'f'
+  // suffix.
+  std::map<std::string, std::vector<libmtest::Line> > functions;
+  for (const auto &file : files)
+    {
+      auto lines = libmtest::read (file, { "binary32", "binary64" });
+      if (!lines)
+	error ("{}", lines.error ());
+      for (auto &line : lines.value ())
+	{
+	  std::string name = line.format == "binary32" ? line.function + "f"
+						       : line.function;
+	  if (!symbol || *symbol == name)
+	    functions[name].push_back (std::move (line));
+	}
+    }
+  if (functions.empty ())
+    error ("no {} tests in {}", symbol ? *symbol : "binary32/binary64", path);
 
   auto start = ClockType::now ();
 
-  checkList<ResultFloat<F> > (
-      functionName, values,
-      ListFloat<F>{ func.first, func.second, maxUlp.value () }, roundModes,
-      failmode);
+  for (const auto &[name, lines] : functions)
+    if (lines.front ().format == "binary32")
+      libmTestFunction<float> (name, lines, roundModes, failmode, maxUlp);
+    else
+      libmTestFunction<double> (name, lines, roundModes, failmode, maxUlp);
 
   auto end = ClockType::now ();
   printlnTimestamp (
@@ -1435,72 +3690,202 @@ runFloatList (const std::string &functionName, const std::vector<F> &values,
 								  - start));
 }
 
-template <typename F>
-static std::vector<F>
-stringListToFPList (const std::vector<std::string> &valueList)
+//
+// handleWorstCases: check the libc functions on the CORE-MATH worst case
+//                   inputs (see worstcases.h) in all the selected rounding
+//                   modes, and report the pass rate of each file.
+//
+
+template <typename RET, typename EVAL>
+static std::uint64_t
+checkWorstCases (std::size_t count, const EVAL &eval,
+		 const RoundSet &roundModes, FailMode failmode)
 {
-  auto view = valueList | std::views::transform ([] (const std::string &s) {
-		auto result = floatrange::fromStr<F> (s);
-		if (!result.has_value ())
-		  error ("invalid number: {}", s);
-		return result.value ();
-	      });
+  std::vector<std::size_t> tests (count);
+  std::iota (tests.begin (), tests.end (), 0);
 
-  std::vector<F> numbers (view.begin (), view.end ());
-  return numbers;
+  std::uint64_t failures = 0;
+  for (auto &rnd : roundModes)
+    failures += checkCases<RET> (tests, eval, rnd, failmode);
+  return failures;
 }
 
-static void
-handleList (const std::string &functionName,
-	    const std::vector<std::string> &values, const RoundSet &roundModes,
-	    FailMode failmode, const std::string &maxUlp)
+template <typename Y, typename F>
+static std::vector<std::pair<F, Y> >
+worstCasesInputs (const std::string &file, std::size_t nargs)
 {
-  auto functype = getFunctionType (functionName);
-  if (!functype)
-    error ("invalid FunctionName: {}", functionName);
+  auto r = worstcases::read<F, Y> (file, nargs);
+  if (!r)
+    error ("{}", r.error ());
+  return r.value ();
+}
 
-  switch (functype.value ())
+// Check the inputs of FILE for FUNCTIONNAME.  Returns the number of checks
+// and failures.
+template <typename F>
+static std::pair<std::uint64_t, std::uint64_t>
+worstCasesFile (const std::string &file, const std::string &functionName,
+		refimpls::FunctionType functype, const RoundSet &roundModes,
+		FailMode failmode, const std::string &maxUlpStr)
+{
+  const auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+
+  printlnTimestamp ("Checking function {} with {}", functionName, file);
+
+  std::size_t count = 0;
+  std::uint64_t failures = 0;
+  switch (functype)
     {
     case refimpls::FunctionType::f32_f:
-      runFloatList<float> (functionName, stringListToFPList<float> (values),
-			   roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f:
-      runFloatList<double> (functionName, stringListToFPList<double> (values),
-			    roundModes, failmode, maxUlp);
+      {
+	auto func = getFunctionFloat<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	auto inputs = worstCasesInputs<F, F> (file, 1);
+	ListFloat<F> list{ func.first, func.second, maxUlp.value () };
+	count = inputs.size ();
+	failures = checkWorstCases<ResultFloat<F> > (
+	    count,
+	    [&] (std::size_t i, int rnd) {
+	      return list (inputs[i].first, rnd);
+	    },
+	    roundModes, failmode);
+      }
       break;
-
-#if 0
     case refimpls::FunctionType::f32_f_f:
-      runFloatFloatValue<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_f:
-      runFloatFloatValue<double> (desc, roundModes, failmode, maxUlp);
+      {
+	auto func = getFunctionFloatFloat<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	auto inputs = worstCasesInputs<F, F> (file, 2);
+	ListFloatFloat<F> list{ func.first, func.second, maxUlp.value () };
+	count = inputs.size ();
+	failures = checkWorstCases<ResultFloatFloat<F> > (
+	    count,
+	    [&] (std::size_t i, int rnd) {
+	      return list (inputs[i].first, inputs[i].second, rnd);
+	    },
+	    roundModes, failmode);
+      }
       break;
-
     case refimpls::FunctionType::f32_f_lli:
-      runFloatLLIValue<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_lli:
-      runFloatLLIValue<double> (desc, roundModes, failmode, maxUlp);
+      {
+	auto func = getFunctionFloatLLI<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	auto inputs = worstCasesInputs<long long int, F> (file, 2);
+	ListFloatLLI<F> list{ func.first, func.second, maxUlp.value () };
+	count = inputs.size ();
+	failures = checkWorstCases<ResultFloatLLI<F> > (
+	    count,
+	    [&] (std::size_t i, int rnd) {
+	      return list (inputs[i].first, inputs[i].second, rnd);
+	    },
+	    roundModes, failmode);
+      }
       break;
-
     case refimpls::FunctionType::f32_f_fp_fp:
-      runFloatpFloatpValue<float> (desc, roundModes, failmode, maxUlp);
-      break;
     case refimpls::FunctionType::f64_f_fp_fp:
-      runFloatpFloatpValue<double> (desc, roundModes, failmode, maxUlp);
+      {
+	auto func = getFunctionFloatpFloatp<F> (functionName).value ();
+	if (!func.first)
+	  error ("libc does not provide {}", functionName);
+	auto inputs = worstCasesInputs<F, F> (file, 1);
+	ListFloatpFloatp<F> list{ func.first, func.second, maxUlp.value () };
+	count = inputs.size ();
+	failures = checkWorstCases<ResultFloatpFloatp<F> > (
+	    count,
+	    [&] (std::size_t i, int rnd) {
+	      return list (inputs[i].first, rnd);
+	    },
+	    roundModes, failmode);
+      }
       break;
-#endif
+    }
 
-    default:
-      error ("function type \"{}\" not implemented", functype.value ());
+  const std::uint64_t checks = count * roundModes.size ();
+  printlnTimestamp ("File {}: inputs {}, passed {}/{} ({:.2f}%)", file, count,
+		    checks - failures, checks,
+		    checks ? (double) (checks - failures) / checks * 100.0
+			   : 100.0);
+  printlnTimestamp ("");
+  return { checks, failures };
+}
+
+static void
+handleWorstCases (const std::string &path,
+		  const std::optional<std::string> &symbol,
+		  const RoundSet &roundModes, FailMode failmode,
+		  const std::string &maxUlp)
+{
+  auto files = worstcases::files (path);
+  // With a single file, -s names its function; otherwise it selects the
+  // files of the function.
+  const bool single = files.size () == 1 && files.front () == path;
+
+  auto start = ClockType::now ();
+
+  std::uint64_t checks = 0, failures = 0, checked = 0;
+  for (const auto &file : files)
+    {
+      std::string functionName = worstcases::functionName (file);
+      if (symbol && single)
+	functionName = *symbol;
+      else if (symbol && *symbol != functionName)
+	continue;
+
+      auto functype = getFunctionType (functionName);
+      if (!functype)
+	{
+	  printlnTimestamp ("Skipping {}: function {} not supported", file,
+			    functionName);
+	  continue;
+	}
+
+      std::pair<std::uint64_t, std::uint64_t> r;
+      switch (functype.value ())
+	{
+	case refimpls::FunctionType::f32_f:
+	case refimpls::FunctionType::f32_f_f:
+	case refimpls::FunctionType::f32_f_lli:
+	case refimpls::FunctionType::f32_f_fp_fp:
+	  r = worstCasesFile<float> (file, functionName, functype.value (),
+				     roundModes, failmode, maxUlp);
+	  break;
+	case refimpls::FunctionType::f64_f:
+	case refimpls::FunctionType::f64_f_f:
+	case refimpls::FunctionType::f64_f_lli:
+	case refimpls::FunctionType::f64_f_fp_fp:
+	  r = worstCasesFile<double> (file, functionName, functype.value (),
+				      roundModes, failmode, maxUlp);
+	  break;
+	}
+      checks += r.first;
+      failures += r.second;
+      checked++;
     }
+  if (checked == 0)
+    error ("no worst case files checked in {}", path);
+
+  auto end = ClockType::now ();
+  printlnTimestamp ("Files {}, passed {}/{}", checked, checks - failures,
+		    checks);
+  printlnTimestamp (
+      "Total elapsed time {}",
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
 }
 
 int
 main (int argc, char *argv[])
 {
+  mpicheck::init (&argc, &argv);
+
   argparse::ArgumentParser options ("checkulps");
 
   options.add_argument ("--description", "-d")
@@ -1522,6 +3907,71 @@ main (int argc, char *argv[])
       .help ("max ULP used in check")
       .default_value (kMaxUlpStr);
 
+  options.add_argument ("--corpus", "-C")
+      .help ("hard inputs corpus directory, failures and worst cases are "
+	     "added to it and it is checked before the description samples");
+
+  options.add_argument ("--smoke")
+      .help ("only check the corpus entries (requires --corpus)")
+      .flag ();
+
+  options.add_argument ("--export-seeds")
+      .help ("write a fuzzulps seed corpus for the description (requires "
+	     "-d)");
+
+  options.add_argument ("--search")
+      .help ("search for the inputs with the largest ULP error on the "
+	     "description samples, using at most N evaluations per sample "
+	     "and rounding mode")
+      .scan<'u', std::uint64_t> ();
+
+  options.add_argument ("--shard")
+      .help ("check only the K-th of N chunks of each sample (K/N, with K "
+	     "starting at 0)");
+
+  options.add_argument ("--trace")
+      .help ("write every evaluated input, computed and expected value to "
+	     "per-thread trace files in the directory (see ulpanalyze)");
+
+  options.add_argument ("--golden")
+      .help ("read the expected results of the binary32 full range samples "
+	     "from the golden tables in the directory (see genref)");
+
+  options.add_argument ("--sweep")
+      .help ("check the comma separated binary32 functions (or \"all\" with "
+	     "a golden table) over the full range in a single pass (requires "
+	     "--golden)");
+
+  options.add_argument ("--argtrace")
+      .help ("with -s, check the function arguments captured by argcapture "
+	     "(a trace file or directory) instead of the listed values");
+
+  options.add_argument ("--snapshot")
+      .help ("write the partial results requested with SIGUSR1 to the file "
+	     "instead of stderr");
+
+  options.add_argument ("--libm-test")
+      .help ("check against the expected results of the glibc "
+	     "auto-libm-test-out file (or the files in the directory), "
+	     "optionally only for the -s function");
+
+  options.add_argument ("--worst-cases")
+      .help ("check the inputs of the CORE-MATH worst case file (or the "
+	     "*.wc files in the directory) in all the rounding modes, "
+	     "optionally only for the -s function");
+
+#ifdef CHECKULPS_MPI
+  options.add_argument ("--mpi-block")
+      .help ("samples of each block handed out to the MPI worker ranks")
+      .default_value (mpicheck::blockSize)
+      .scan<'u', std::uint64_t> ();
+
+  options.add_argument ("--mpi-progress")
+      .help ("seconds between the MPI progress reports of rank 0")
+      .default_value (mpicheck::progressInterval)
+      .scan<'g', double> ();
+#endif
+
   options.add_argument ("values")
       .nargs (argparse::nargs_pattern::any)
       .remaining ();
@@ -1542,15 +3992,84 @@ main (int argc, char *argv[])
 
   std::string maxUlp = options.get<std::string> ("-m");
 
-  if (auto descFile = options.present ("-d"))
-    handleDescription (*descFile, roundModes, failMode, maxUlp);
+  auto corpusDir = options.present ("--corpus");
+  bool smoke = options.get<bool> ("--smoke");
+  if (smoke && !corpusDir)
+    error ("--smoke requires --corpus");
+
+  if (auto shard = options.present ("--shard"))
+    {
+      auto r = parseShard (*shard);
+      if (!r)
+	error ("{}", r.error ());
+      std::tie (shardIndex, shardCount) = r.value ();
+    }
+
+  traceDir = options.present ("--trace");
+  goldenDir = options.present ("--golden");
+  argtraceFile = options.present ("--argtrace");
+  snapshot::install (options.present ("--snapshot"));
+
+  if (auto budget = options.present<std::uint64_t> ("--search"))
+    searchBudget = *budget;
+
+#ifdef CHECKULPS_MPI
+  mpicheck::blockSize = options.get<std::uint64_t> ("--mpi-block");
+  mpicheck::progressInterval = options.get<double> ("--mpi-progress");
+  if (mpicheck::blockSize == 0)
+    error ("--mpi-block should be positive");
+#endif
+  // The ranks only share the description sample checks, and the corpus and
+  // trace files are per process.
+  if (mpicheck::distributed ()
+      && (!options.present ("-d") || options.present ("--sweep")
+	  || options.present ("--export-seeds")
+	  || options.present ("--libm-test")
+	  || options.present ("--worst-cases") || searchBudget || corpusDir
+	  || traceDir))
+    error ("with MPI only the -d checks are supported, without --search, "
+	   "--corpus or --trace");
+
+  if (auto sweep = options.present ("--sweep"))
+    {
+      if (!goldenDir)
+	error ("--sweep requires --golden");
+      handleSweep (*sweep, roundModes, maxUlp);
+    }
+  else if (auto seedsDir = options.present ("--export-seeds"))
+    {
+      auto descFile = options.present ("-d");
+      if (!descFile)
+	error ("--export-seeds requires -d");
+      handleExportSeeds (*descFile, *seedsDir, corpusDir);
+    }
+  else if (auto libmTest = options.present ("--libm-test"))
+    handleLibmTest (*libmTest, options.present ("-s"), roundModes, failMode,
+		    maxUlp);
+  else if (auto worstCases = options.present ("--worst-cases"))
+    handleWorstCases (*worstCases, options.present ("-s"), roundModes,
+		      failMode, maxUlp);
+  else if (auto descFile = options.present ("-d"))
+    handleDescription (*descFile, roundModes, failMode, maxUlp, corpusDir,
+		       smoke);
   else if (auto symbol = options.present ("-s"))
     {
+      if (smoke)
+	{
+	  openCorpus (corpusDir, *symbol);
+	  handleSmoke (*symbol, roundModes, failMode, maxUlp);
+	  saveCorpus ();
+	  mpicheck::finalize ();
+	  return 0;
+	}
+
       try
 	{
 	  handleList (*symbol,
-		      options.get<std::vector<std::string> > ("values"),
-		      roundModes, failMode, maxUlp);
+		      argtraceFile
+			  ? std::vector<std::string>{}
+			  : options.get<std::vector<std::string> > ("values"),
+		      roundModes, failMode, maxUlp, corpusDir);
 	}
       catch (std::logic_error &e)
 	{
@@ -1559,4 +4078,6 @@ main (int argc, char *argv[])
     }
   else
     error ("no -d or -s provided");
+
+  mpicheck::finalize ();
 }
@@ -0,0 +1,186 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "corpus.h"
+
+static constexpr std::string_view kCorpusMagic = "CMCORPUS";
+static constexpr std::uint32_t kCorpusVersion = 1;
+
+struct CorpusHeader
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+  std::uint64_t count;
+};
+
+static const std::array<std::pair<Corpus::Tag, std::string_view>, 4>
+    kTagNames = { { { Corpus::MANUAL, "manual" },
+		    { Corpus::FAILURE, "failure" },
+		    { Corpus::WORST, "worst" },
+		    { Corpus::SEARCH, "search" } } };
+
+std::string
+Corpus::tagsName (std::uint32_t tags)
+{
+  std::string ret;
+  for (const auto &[tag, name] : kTagNames)
+    if (tags & tag)
+      {
+	if (!ret.empty ())
+	  ret += ',';
+	ret += name;
+      }
+  return ret.empty () ? std::string ("none") : ret;
+}
+
+static std::expected<std::vector<Corpus::Entry>, std::string>
+readEntries (const std::string &fileName)
+{
+  std::vector<Corpus::Entry> entries;
+
+  std::ifstream file (fileName, std::ios::binary);
+  if (!file.is_open ())
+    // A missing file is just an empty corpus.
+    return entries;
+
+  CorpusHeader header;
+  if (!file.read (reinterpret_cast<char *> (&header), sizeof (header)))
+    return std::unexpected (
+	std::format ("{}: truncated corpus header", fileName));
+  if (std::memcmp (header.magic, kCorpusMagic.data (), sizeof (header.magic))
+      != 0)
+    return std::unexpected (
+	std::format ("{}: invalid corpus file", fileName));
+  if (header.version != kCorpusVersion)
+    return std::unexpected (std::format (
+	"{}: unsupported corpus version {}", fileName, header.version));
+
+  // Check the count against the file size before allocating the entries,
+  // a corrupted header could ask for any size.
+  std::error_code ec;
+  const std::uintmax_t size = std::filesystem::file_size (fileName, ec);
+  if (ec)
+    return std::unexpected (
+	std::format ("{}: {}", fileName, ec.message ()));
+  if (header.count > (size - sizeof (header)) / sizeof (Corpus::Entry))
+    return std::unexpected (
+	std::format ("{}: truncated corpus entries", fileName));
+
+  entries.resize (header.count);
+  if (!file.read (reinterpret_cast<char *> (entries.data ()),
+		  header.count * sizeof (Corpus::Entry)))
+    return std::unexpected (
+	std::format ("{}: truncated corpus entries", fileName));
+
+  return entries;
+}
+
+// Sort ENTRIES and remove the duplicated inputs, merging their tags.
+static void
+normalizeEntries (std::vector<Corpus::Entry> &entries)
+{
+  std::sort (entries.begin (), entries.end ());
+  auto out = entries.begin ();
+  for (auto it = entries.begin (); it != entries.end (); ++it)
+    {
+      if (out != entries.begin () && *(out - 1) == *it)
+	(out - 1)->tags |= it->tags;
+      else
+	*out++ = *it;
+    }
+  entries.erase (out, entries.end ());
+}
+
+std::expected<Corpus, std::string>
+Corpus::open (const std::string &dir, const std::string &function)
+{
+  std::error_code ec;
+  std::filesystem::create_directories (dir, ec);
+  if (ec)
+    return std::unexpected (std::format ("creating corpus directory {}: {}",
+					 dir, ec.message ()));
+
+  Corpus corpus (
+      (std::filesystem::path (dir) / (function + ".corpus")).string ());
+
+  auto entries = readEntries (corpus.fileName);
+  if (!entries)
+    return std::unexpected (entries.error ());
+  corpus.stored = std::move (entries.value ());
+  normalizeEntries (corpus.stored);
+
+  return corpus;
+}
+
+std::expected<void, std::string>
+Corpus::save ()
+{
+  if (pending.empty ())
+    return {};
+
+  // Serialize concurrent checkulps instances updating the same corpus.
+  const std::string lockName = fileName + ".lock";
+  int lockfd = ::open (lockName.c_str (), O_RDWR | O_CREAT, 0644);
+  if (lockfd == -1)
+    return std::unexpected (
+	std::format ("{}: {}", lockName, std::strerror (errno)));
+  flock (lockfd, LOCK_EX);
+
+  auto ret = [&] () -> std::expected<void, std::string> {
+    auto entries = readEntries (fileName);
+    if (!entries)
+      return std::unexpected (entries.error ());
+
+    stored = std::move (entries.value ());
+    stored.insert (stored.end (), pending.begin (), pending.end ());
+    normalizeEntries (stored);
+
+    const std::string tmpName = fileName + ".tmp";
+    {
+      std::ofstream file (tmpName, std::ios::binary | std::ios::trunc);
+      if (!file.is_open ())
+	return std::unexpected (std::format ("creating {}", tmpName));
+
+      CorpusHeader header{};
+      std::memcpy (header.magic, kCorpusMagic.data (),
+		   sizeof (header.magic));
+      header.version = kCorpusVersion;
+      header.count = stored.size ();
+      file.write (reinterpret_cast<const char *> (&header),
+		  sizeof (header));
+      file.write (reinterpret_cast<const char *> (stored.data ()),
+		  stored.size () * sizeof (Entry));
+      if (!file)
+	return std::unexpected (std::format ("writing {}", tmpName));
+    }
+
+    std::error_code ec;
+    std::filesystem::rename (tmpName, fileName, ec);
+    if (ec)
+      return std::unexpected (
+	  std::format ("renaming {}: {}", tmpName, ec.message ()));
+
+    pending.clear ();
+    return {};
+  }();
+
+  flock (lockfd, LOCK_UN);
+  close (lockfd);
+  return ret;
+}
@@ -0,0 +1,184 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _CORPUS_H
+#define _CORPUS_H
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "cxxcompat.h"
+
+//
+// Corpus: a per function store of hard inputs (failures, worst cases found
+//         by sampling, manually added values).  Each function has its own
+//         binary file <dir>/<function>.corpus, kept sorted by input bit
+//         pattern and deduplicated; duplicated inputs have their provenance
+//         tags merged.
+//
+//         The file layout is a fixed header followed by fixed-size entries,
+//         both in host byte order:
+//
+//           Header { char magic[8]; uint32_t version; uint32_t reserved;
+//                    uint64_t count; }
+//           Entry  { uint64_t x; uint64_t y; uint32_t tags;
+//                    uint32_t reserved; }
+//
+//         X and Y hold the argument bit patterns (Y is 0 for single argument
+//         functions and the integer value for the long long ones).
+//
+
+class Corpus
+{
+public:
+  enum Tag : std::uint32_t
+  {
+    MANUAL = 1U << 0,
+    FAILURE = 1U << 1,
+    WORST = 1U << 2,
+    SEARCH = 1U << 3,
+  };
+
+  struct Entry
+  {
+    std::uint64_t x;
+    std::uint64_t y;
+    std::uint32_t tags;
+    std::uint32_t reserved;
+
+    auto
+    operator<=> (const Entry &other) const
+    {
+      return std::tie (x, y) <=> std::tie (other.x, other.y);
+    }
+
+    bool
+    operator== (const Entry &other) const
+    {
+      return x == other.x && y == other.y;
+    }
+  };
+
+  static std::expected<Corpus, std::string> open (const std::string &dir,
+						  const std::string &function);
+
+  // Queue a new entry, it is only written on save.
+  void
+  add (std::uint64_t x, std::uint64_t y, std::uint32_t tags)
+  {
+    pending.push_back (Entry{ x, y, tags, 0 });
+  }
+
+  // Merge the pending entries with the on-disk ones (which might have been
+  // updated by a concurrent run) and atomically replace the file.
+  std::expected<void, std::string> save ();
+
+  const std::vector<Entry> &
+  entries () const
+  {
+    return stored;
+  }
+
+  const std::string &
+  path () const
+  {
+    return fileName;
+  }
+
+  static std::string tagsName (std::uint32_t tags);
+
+private:
+  explicit Corpus (const std::string &f) : fileName (f) {}
+
+  std::string fileName;
+  std::vector<Entry> stored;
+  std::vector<Entry> pending;
+};
+
+//
+// CorpusCollector: per-thread accumulator of the inputs that should be added
+//                  to the corpus, so the checking loops do not need any
+//                  synchronization.  It keeps the first kMaxFailures failures
+//                  and the kMaxWorst inputs with the largest ULP error.
+//
+
+class CorpusCollector
+{
+  static constexpr std::size_t kMaxFailures = 256;
+  static constexpr std::size_t kMaxWorst = 16;
+
+  typedef std::pair<double, Corpus::Entry> WorstEntry;
+
+  static bool
+  worstCompare (const WorstEntry &a, const WorstEntry &b)
+  {
+    return a.first > b.first;
+  }
+
+  std::vector<Corpus::Entry> failures;
+  // Min-heap on the ULP error, the front is the smallest worst case.
+  std::vector<WorstEntry> worst;
+
+  void
+  addWorst (double ulp, const Corpus::Entry &e)
+  {
+    worst.push_back (WorstEntry{ ulp, e });
+    std::push_heap (worst.begin (), worst.end (), worstCompare);
+    if (worst.size () > kMaxWorst)
+      {
+	std::pop_heap (worst.begin (), worst.end (), worstCompare);
+	worst.pop_back ();
+      }
+  }
+
+public:
+  template <typename RET>
+  void
+  add (const RET &ret, bool passed)
+  {
+    if (!passed && failures.size () < kMaxFailures)
+      {
+	auto [x, y] = ret.inputBits ();
+	failures.push_back (Corpus::Entry{ x, y, Corpus::FAILURE, 0 });
+      }
+
+    // Exact results are not interesting as worst cases.
+    if (!(ret.ulp > 0.0))
+      return;
+    if (worst.size () == kMaxWorst && ret.ulp <= worst.front ().first)
+      return;
+    auto [x, y] = ret.inputBits ();
+    addWorst (ret.ulp, Corpus::Entry{ x, y, Corpus::WORST, 0 });
+  }
+
+  void
+  merge (const CorpusCollector &other)
+  {
+    for (const auto &f : other.failures)
+      if (failures.size () < kMaxFailures)
+	failures.push_back (f);
+    for (const auto &w : other.worst)
+      if (worst.size () < kMaxWorst || w.first > worst.front ().first)
+	addWorst (w.first, w.second);
+  }
+
+  void
+  addTo (Corpus &corpus) const
+  {
+    for (const auto &f : failures)
+      corpus.add (f.x, f.y, f.tags);
+    for (const auto &w : worst)
+      corpus.add (w.second.x, w.second.y, w.second.tags);
+  }
+};
+
+#endif
@@ -140,20 +140,63 @@ parseRange (const std::string &str)
   std::unreachable ();
 }
 
+static std::expected<Description::SampleSequence, std::string>
+parseSequence (const nlohmann::json &r)
+{
+  Description::SampleSequence seq;
+
+  if (r.contains ("sequence"))
+    {
+      const auto name = r["sequence"].get<std::string> ();
+      if (name == "random")
+	seq.sequence = Description::Sequence::RANDOM;
+      else if (name == "sobol")
+	seq.sequence = Description::Sequence::SOBOL;
+      else if (name == "halton")
+	seq.sequence = Description::Sequence::HALTON;
+      else
+	return std::unexpected (std::format ("invalid sequence: {}", name));
+    }
+
+  // "mapping" selects one of the two first distributions: "linear" is
+  // uniform on the values and "bits" uniform on the representable numbers.
+  if (r.contains ("mapping") && r.contains ("distribution"))
+    return std::unexpected (
+	std::string ("mapping and distribution are mutually exclusive"));
+  if (r.contains ("mapping"))
+    {
+      const auto name = r["mapping"].get<std::string> ();
+      if (name == "bits")
+	seq.distribution = TRY (distribution::Spec::parse ("bits"));
+      else if (name != "linear")
+	return std::unexpected (std::format (
+	    "invalid mapping: {} (expected linear or bits)", name));
+    }
+  if (r.contains ("distribution"))
+    seq.distribution = TRY (distribution::Spec::parse (
+	r["distribution"].get<std::string> ()));
+
+  if (r.contains ("seed"))
+    seq.seed = r["seed"].get<uint64_t> ();
+
+  return seq;
+}
+
 static std::expected<Description::SampleType, std::string>
 handle1Arg (refimpls::FunctionType functype, const std::string &start,
-	    const std::string &end, uint64_t count)
+	    const std::string &end, uint64_t count,
+	    const Description::SampleSequence &seq)
 {
   switch (functype)
     {
     case refimpls::FunctionType::f32_f:
       return Description::SampleType (Description::Sample1Arg<float>{
 	  TRY (parseRange<float> (start)), TRY (parseRange<float> (end)),
-	  count });
+	  count, seq });
     case refimpls::FunctionType::f64_f:
       return Description::SampleType (Description::Sample1Arg<double>{
 	  TRY (parseRange<double> (start)), TRY (parseRange<double> (end)),
-	  count });
+	  count, seq });
     default:
       std::unreachable ();
     }
@@ -162,7 +205,8 @@ handle1Arg (refimpls::FunctionType functype, const std::string &start,
 static std::expected<Description::SampleType, std::string>
 handle2Arg (refimpls::FunctionType functype, const std::string &start_x,
 	    const std::string &end_x, const std::string &start_y,
-	    const std::string &end_y, uint64_t count)
+	    const std::string &end_y, uint64_t count,
+	    const Description::SampleSequence &seq)
 {
   switch (functype)
     {
@@ -170,27 +214,114 @@ handle2Arg (refimpls::FunctionType functype, const std::string &start_x,
       return Description::SampleType (Description::Sample2Arg<float>{
 	  TRY (parseRange<float> (start_x)), TRY (parseRange<float> (end_x)),
 	  TRY (parseRange<float> (start_y)), TRY (parseRange<float> (end_y)),
-	  count });
+	  count, seq });
     case refimpls::FunctionType::f64_f_f:
       return Description::SampleType (Description::Sample2Arg<double>{
 	  TRY (parseRange<double> (start_x)), TRY (parseRange<double> (end_x)),
 	  TRY (parseRange<double> (start_y)), TRY (parseRange<double> (end_y)),
-	  count });
+	  count, seq });
     case refimpls::FunctionType::f32_f_lli:
       return Description::SampleType (Description::Sample2ArgLli<float>{
 	  TRY (parseRange<float> (start_x)), TRY (parseRange<float> (end_x)),
 	  TRY (parseRange<long long int> (start_y)),
-	  TRY (parseRange<long long int> (end_y)), count });
+	  TRY (parseRange<long long int> (end_y)), count, seq });
     case refimpls::FunctionType::f64_f_lli:
       return Description::SampleType (Description::Sample2ArgLli<double>{
 	  TRY (parseRange<double> (start_x)), TRY (parseRange<double> (end_x)),
 	  TRY (parseRange<long long int> (start_y)),
-	  TRY (parseRange<long long int> (end_y)), count });
+	  TRY (parseRange<long long int> (end_y)), count, seq });
     default:
       std::unreachable ();
     }
 }
 
+// Set the result range of the single argument sample SAMPLE, defined by R.
+// The inputs of a result range usually span many binades, so they are drawn
+// uniformly on the representable numbers unless the sample sets another
+// distribution.
+static std::expected<void, std::string>
+handleResult (refimpls::FunctionType functype, const nlohmann::json &r,
+	      Description::SampleType &sample)
+{
+  const auto &result = r["result"];
+  if (result.size () != 2)
+    return std::unexpected (std::format (
+	"invalid result size: {} (expected 2)", result.size ()));
+  const auto start = result[0].template get<std::string> ();
+  const auto end = result[1].template get<std::string> ();
+
+  auto set = [&]<typename F> (Description::Sample1Arg<F> &s)
+      -> std::expected<void, std::string> {
+    s.result = Description::ArgType<F>{ TRY (parseRange<F> (start)),
+					TRY (parseRange<F> (end)) };
+    if (!r.contains ("mapping") && !r.contains ("distribution"))
+      s.seq.distribution = TRY (distribution::Spec::parse ("bits"));
+    return {};
+  };
+
+  switch (functype)
+    {
+    case refimpls::FunctionType::f32_f:
+      return set (std::get<Description::Sample1Arg<float> > (sample));
+    case refimpls::FunctionType::f64_f:
+      return set (std::get<Description::Sample1Arg<double> > (sample));
+    default:
+      return std::unexpected (
+	  std::format ("result ranges are not supported for {}", functype));
+    }
+}
+
+static std::expected<Description::SampleType, std::string>
+handleHotspots (refimpls::FunctionType functype, const nlohmann::json &r)
+{
+  const auto name = r["hotspots"].get<std::string> ();
+  Description::Hotspot kind;
+  if (name == "pi/2")
+    kind = Description::Hotspot::PI_2;
+  else if (name == "pi")
+    kind = Description::Hotspot::PI;
+  else if (name == "ln2")
+    kind = Description::Hotspot::LN2;
+  else if (name == "zeros")
+    kind = Description::Hotspot::ZEROS;
+  else
+    return std::unexpected (std::format ("invalid hotspots: {}", name));
+
+  if (!r.contains ("x") || r["x"].size () != 2)
+    return std::unexpected (
+	std::string ("hotspots require an x range with 2 elements"));
+  const auto start = r["x"][0].template get<std::string> ();
+  const auto end = r["x"][1].template get<std::string> ();
+  const auto count = r["count"].get<uint64_t> ();
+
+  // The zeros are searched on the function reference result, which needs a
+  // single result.
+  const bool twoResults = functype == refimpls::FunctionType::f32_f_fp_fp
+			  || functype == refimpls::FunctionType::f64_f_fp_fp;
+  if (kind == Description::Hotspot::ZEROS && twoResults)
+    return std::unexpected (
+	std::format ("zeros hotspots are not supported for {}", functype));
+
+  switch (functype)
+    {
+    case refimpls::FunctionType::f32_f:
+    case refimpls::FunctionType::f32_f_fp_fp:
+      return Description::SampleType (Description::HotspotSample<float>{
+	  kind,
+	  { TRY (parseRange<float> (start)), TRY (parseRange<float> (end)) },
+	  count });
+    case refimpls::FunctionType::f64_f:
+    case refimpls::FunctionType::f64_f_fp_fp:
+      return Description::SampleType (Description::HotspotSample<double>{
+	  kind,
+	  { TRY (parseRange<double> (start)), TRY (parseRange<double> (end)) },
+	  count });
+    default:
+      return std::unexpected (
+	  std::format ("hotspots are not supported for {}", functype));
+    }
+}
+
 template <class... Ts> struct overloaded : Ts...
 {
   using Ts::operator()...;
@@ -236,7 +367,10 @@ Description::parse (const std::string &fname)
     {
       for (const auto &r : data["samples"])
 	{
-	  if (r.contains ("x") && r.contains ("y"))
+	  if (r.contains ("hotspots"))
+	    this->Samples.push_back (
+		TRY (handleHotspots (functype.value (), r)));
+	  else if (r.contains ("x") && r.contains ("y"))
 	    {
 	      if (r["x"].size () != 2 || r["y"].size () != 2)
 		return std::unexpected (
@@ -248,7 +382,7 @@ Description::parse (const std::string &fname)
 		  r["x"][1].template get<std::string> (),
 		  r["y"][0].template get<std::string> (),
 		  r["y"][1].template get<std::string> (),
-		  r["count"].get<uint64_t> ()));
+		  r["count"].get<uint64_t> (), TRY (parseSequence (r))));
 	      this->Samples.push_back (sample);
 	    }
 	  else if (r.contains ("x"))
@@ -260,7 +394,9 @@ Description::parse (const std::string &fname)
 	      auto sample = TRY (handle1Arg (
 		  functype.value (), r["x"][0].template get<std::string> (),
 		  r["x"][1].template get<std::string> (),
-		  r["count"].get<uint64_t> ()));
+		  r["count"].get<uint64_t> (), TRY (parseSequence (r))));
+	      if (r.contains ("result"))
+		TRY (handleResult (functype.value (), r, sample));
 
 	      this->Samples.push_back (sample);
 	    }
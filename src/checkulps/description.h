@@ -9,11 +9,13 @@
 
 #include <cstdint>
 #include <expected>
+#include <optional>
 #include <string>
 #include <vector>
 #include <format>
 
 #include "cxxcompat.h"
+#include "distribution.h"
 
 class Description
 {
@@ -25,16 +27,40 @@ public:
     uint64_t end;
   };
 
+  // How the sample points are generated: independent pseudo-random draws, or
+  // a scrambled low-discrepancy sequence (reproducible by index, so it can
+  // be split across --shard runs).
+  enum class Sequence
+  {
+    RANDOM,
+    SOBOL,
+    HALTON
+  };
+
+  // The points are mapped to the argument ranges by the sample
+  // distribution (uniform on the values by default).
+  struct SampleSequence
+  {
+    Sequence sequence = Sequence::RANDOM;
+    distribution::Spec distribution;
+    uint64_t seed = 0;
+  };
+
   template <typename F> struct ArgType
   {
     F start;
     F end;
   };
 
+  // With a result range, the sample is taken in output space: ARG is the
+  // (monotone) input interval searched for the inputs whose results are in
+  // RESULT, and the inputs are drawn from them (see checkulps).
   template <typename F> struct Sample1Arg
   {
     ArgType<F> arg;
     uint64_t count;
+    SampleSequence seq;
+    std::optional<ArgType<F> > result = std::nullopt;
   };
 
   template <typename F> struct Sample2Arg
@@ -42,6 +68,7 @@ public:
     ArgType<F> arg_x;
     ArgType<F> arg_y;
     uint64_t count;
+    SampleSequence seq;
   };
 
   template <typename F> struct Sample2ArgLli
@@ -49,6 +76,24 @@ public:
     ArgType<F> arg_x;
     ArgType<long long int> arg_y;
     uint64_t count;
+    SampleSequence seq;
+  };
+
+  // Argument reduction hot spots: the inputs closest to the multiples of a
+  // constant (see hotspots.h), or to the zeros of the function.
+  enum class Hotspot
+  {
+    PI_2,
+    PI,
+    LN2,
+    ZEROS
+  };
+
+  template <typename F> struct HotspotSample
+  {
+    Hotspot kind;
+    ArgType<F> arg;
+    uint64_t count;
   };
 
   std::expected<void, std::string> parse (const std::string &);
@@ -60,6 +105,8 @@ public:
                        Sample2Arg<double>,
 		       Sample2ArgLli<float>,
                        Sample2ArgLli<double>,
+		       HotspotSample<float>,
+		       HotspotSample<double>,
 		       FullRange>
       SampleType;
   // clang-format on
@@ -120,6 +167,19 @@ struct std::formatter<Description::SampleType> : std::formatter<std::string>
 				     arg.arg_x.start, arg.arg_x.end,
 				     arg.arg_y.start, arg.arg_y.end);
 	    }
+	  else if constexpr (std::is_same_v<
+				 T, Description::HotspotSample<float> >)
+	    {
+	      return std::format_to (ctx.out (), "HotspotSample<float>: {}-{}",
+				     arg.arg.start, arg.arg.end);
+	    }
+	  else if constexpr (std::is_same_v<
+				 T, Description::HotspotSample<double> >)
+	    {
+	      return std::format_to (ctx.out (),
+				     "HotspotSample<double>: {}-{}",
+				     arg.arg.start, arg.arg.end);
+	    }
 	  else if constexpr (std::is_same_v<T, Description::FullRange>)
 	    {
 	      return std::format_to (ctx.out (), "FullRange: {} {}-{}",
@@ -0,0 +1,64 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _FUZZINPUT_H
+#define _FUZZINPUT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//
+// The fuzzulps input layout: the function arguments bit patterns
+// concatenated in host byte order (4 bytes for float, 8 bytes for double
+// and long long).  It is shared by the fuzzer harness and the checkulps
+// seed corpus export.
+//
+
+namespace fuzzinput
+{
+
+template <typename... Args>
+inline std::vector<std::uint8_t>
+encode (Args... args)
+{
+  std::vector<std::uint8_t> ret;
+  (
+      [&] (auto arg) {
+	const auto *p = reinterpret_cast<const std::uint8_t *> (&arg);
+	ret.insert (ret.end (), p, p + sizeof (arg));
+      }(args),
+      ...);
+  return ret;
+}
+
+// Consume sizeof (T) bytes from DATA, returns false if there are not enough
+// bytes.
+template <typename T>
+inline bool
+decode (const std::uint8_t *&data, std::size_t &size, T &out)
+{
+  if (size < sizeof (T))
+    return false;
+  std::memcpy (&out, data, sizeof (T));
+  data += sizeof (T);
+  size -= sizeof (T);
+  return true;
+}
+
+inline bool
+writeSeed (const std::string &fileName, const std::vector<std::uint8_t> &seed)
+{
+  std::ofstream file (fileName, std::ios::binary | std::ios::trunc);
+  file.write (reinterpret_cast<const char *> (seed.data ()), seed.size ());
+  return static_cast<bool> (file);
+}
+
+} // namespace fuzzinput
+
+#endif
@@ -0,0 +1,281 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// libFuzzer/AFL++ compatible harness: each fuzzer input is decoded as the
+// function arguments bit patterns (see fuzzinput.h), evaluated by the libm
+// function and checked against the MPFR reference for the selected rounding
+// modes.  An error above the threshold aborts, so it is reported as a crash
+// and the input is saved by the fuzzer.
+//
+// Since the harness is configured before libFuzzer parses its own command
+// line, the options are read from the environment:
+//
+//   FUZZULPS_FUNCTION: function to check (required).
+//   FUZZULPS_ROUNDING: rounding modes to check (default rndn,rndu,rndd,rndz).
+//   FUZZULPS_MAXULPS:  max ULP allowed (default 0.0).
+
+#include <cstdlib>
+#include <map>
+#include <optional>
+
+#include <fenv.h>
+
+#include "floatranges.h"
+#include "fuzzinput.h"
+#include "iohelper.h"
+#include "refimpls.h"
+#include "strhelper.h"
+#include "ulpcheck.h"
+
+using namespace refimpls;
+using namespace iohelper;
+
+static const std::map<std::string_view, int> kRoundModes
+    = { { "rndn", FE_TONEAREST },
+	{ "rndu", FE_UPWARD },
+	{ "rndd", FE_DOWNWARD },
+	{ "rndz", FE_TOWARDZERO } };
+
+static std::vector<int> roundModes;
+static int (*testOneInput) (const std::uint8_t *, std::size_t);
+
+static std::string_view
+roundName (int rnd)
+{
+  for (const auto &[name, mode] : kRoundModes)
+    if (mode == rnd)
+      return name;
+  std::unreachable ();
+}
+
+template <typename F>
+[[noreturn]] static void
+reportFailure (int rnd, const std::string &input, F computed, F expected,
+	       F ulp)
+{
+  printlnErrorTimestamp ("{} ulp={:1.0f} input={} computed={:#a} "
+			 "expected={:#a}",
+			 roundName (rnd), ulp, input, computed, expected);
+  std::abort ();
+}
+
+template <typename F> struct FuzzFloat
+{
+  static inline FuncF<F> func;
+  static inline std::optional<FuncFReference<F> > ref;
+  static inline F maxUlp;
+
+  static int
+  test (const std::uint8_t *data, std::size_t size)
+  {
+    F x;
+    if (!fuzzinput::decode (data, size, x))
+      return 0;
+
+    for (int rnd : roundModes)
+      {
+	fesetround (rnd);
+	F computed = func (x);
+	F expected = (*ref) (x, rnd);
+	F ulp = ulpError (computed, expected);
+	if (!checkFullValue (computed, expected, ulp, maxUlp))
+	  reportFailure (rnd, std::format ("{:#a}", x), computed, expected,
+			 ulp);
+      }
+    fesetround (FE_TONEAREST);
+    return 0;
+  }
+};
+
+template <typename F> struct FuzzFloatFloat
+{
+  static inline FuncFF<F> func;
+  static inline std::optional<FuncFFReference<F> > ref;
+  static inline F maxUlp;
+
+  static int
+  test (const std::uint8_t *data, std::size_t size)
+  {
+    F x, y;
+    if (!fuzzinput::decode (data, size, x)
+	|| !fuzzinput::decode (data, size, y))
+      return 0;
+
+    for (int rnd : roundModes)
+      {
+	fesetround (rnd);
+	F computed = func (x, y);
+	F expected = (*ref) (x, y, rnd);
+	F ulp = ulpError (computed, expected);
+	if (!checkFullValue (computed, expected, ulp, maxUlp))
+	  reportFailure (rnd, std::format ("({:#a},{:#a})", x, y), computed,
+			 expected, ulp);
+      }
+    fesetround (FE_TONEAREST);
+    return 0;
+  }
+};
+
+template <typename F> struct FuzzFloatpFloatp
+{
+  static inline FuncFpFp<F> func;
+  static inline std::optional<FuncFpFpReference<F> > ref;
+  static inline F maxUlp;
+
+  static void
+  check (int rnd, F x, F computed, F expected)
+  {
+    F ulp = ulpError (computed, expected);
+    if (!checkFullValue (computed, expected, ulp, maxUlp))
+      reportFailure (rnd, std::format ("{:#a}", x), computed, expected, ulp);
+  }
+
+  static int
+  test (const std::uint8_t *data, std::size_t size)
+  {
+    F x;
+    if (!fuzzinput::decode (data, size, x))
+      return 0;
+
+    for (int rnd : roundModes)
+      {
+	fesetround (rnd);
+	F computed1, computed2;
+	func (x, &computed1, &computed2);
+	F expected1, expected2;
+	(*ref) (x, &expected1, &expected2, rnd);
+	check (rnd, x, computed1, expected1);
+	check (rnd, x, computed2, expected2);
+      }
+    fesetround (FE_TONEAREST);
+    return 0;
+  }
+};
+
+template <typename F> struct FuzzFloatLLI
+{
+  static inline FuncFLLI<F> func;
+  static inline std::optional<FuncFLLIReference<F> > ref;
+  static inline F maxUlp;
+
+  static int
+  test (const std::uint8_t *data, std::size_t size)
+  {
+    F x;
+    long long int y;
+    if (!fuzzinput::decode (data, size, x)
+	|| !fuzzinput::decode (data, size, y))
+      return 0;
+
+    for (int rnd : roundModes)
+      {
+	fesetround (rnd);
+	F computed = func (x, y);
+	F expected = (*ref) (x, y, rnd);
+	F ulp = ulpError (computed, expected);
+	if (!checkFullValue (computed, expected, ulp, maxUlp))
+	  reportFailure (rnd, std::format ("({:#a},{})", x, y), computed,
+			 expected, ulp);
+      }
+    fesetround (FE_TONEAREST);
+    return 0;
+  }
+};
+
+template <typename FUZZ, typename F, typename FUNCS>
+static void
+setupFuzz (const std::string &name, const FUNCS &funcs,
+	   const std::string &maxUlpStr)
+{
+  if (!funcs || !funcs->first)
+    error ("libc does not provide {}", name);
+
+  auto maxUlp = floatrange::fromStr<F> (maxUlpStr);
+  if (!maxUlp)
+    error ("invalid floating point: {}", maxUlpStr);
+
+  FUZZ::func = funcs->first;
+  FUZZ::ref.emplace (funcs->second);
+  FUZZ::maxUlp = maxUlp.value ();
+  testOneInput = FUZZ::test;
+
+  setupReferenceImpl<F> ();
+}
+
+static const char *
+getEnv (const char *name, const char *def)
+{
+  const char *v = std::getenv (name);
+  return v != nullptr ? v : def;
+}
+
+extern "C" int
+LLVMFuzzerInitialize (int *argc, char ***argv)
+{
+  const char *function = std::getenv ("FUZZULPS_FUNCTION");
+  if (function == nullptr)
+    error ("FUZZULPS_FUNCTION not set");
+  const std::string name (function);
+  const std::string maxUlp (getEnv ("FUZZULPS_MAXULPS", "0.0"));
+
+  for (const auto &rnd : strhelper::splitWithRanges (
+	   getEnv ("FUZZULPS_ROUNDING", "rndn,rndu,rndd,rndz"), ","))
+    if (auto it = kRoundModes.find (rnd); it != kRoundModes.end ())
+      roundModes.push_back (it->second);
+    else
+      error ("invalid rounding mode: {}", rnd);
+
+  auto functype = getFunctionType (name);
+  if (!functype)
+    error ("invalid FunctionName: {}", name);
+
+  switch (functype.value ())
+    {
+    case FunctionType::f32_f:
+      setupFuzz<FuzzFloat<float>, float> (
+	  name, getFunctionFloat<float> (name), maxUlp);
+      break;
+    case FunctionType::f64_f:
+      setupFuzz<FuzzFloat<double>, double> (
+	  name, getFunctionFloat<double> (name), maxUlp);
+      break;
+
+    case FunctionType::f32_f_f:
+      setupFuzz<FuzzFloatFloat<float>, float> (
+	  name, getFunctionFloatFloat<float> (name), maxUlp);
+      break;
+    case FunctionType::f64_f_f:
+      setupFuzz<FuzzFloatFloat<double>, double> (
+	  name, getFunctionFloatFloat<double> (name), maxUlp);
+      break;
+
+    case FunctionType::f32_f_lli:
+      setupFuzz<FuzzFloatLLI<float>, float> (
+	  name, getFunctionFloatLLI<float> (name), maxUlp);
+      break;
+    case FunctionType::f64_f_lli:
+      setupFuzz<FuzzFloatLLI<double>, double> (
+	  name, getFunctionFloatLLI<double> (name), maxUlp);
+      break;
+
+    case FunctionType::f32_f_fp_fp:
+      setupFuzz<FuzzFloatpFloatp<float>, float> (
+	  name, getFunctionFloatpFloatp<float> (name), maxUlp);
+      break;
+    case FunctionType::f64_f_fp_fp:
+      setupFuzz<FuzzFloatpFloatp<double>, double> (
+	  name, getFunctionFloatpFloatp<double> (name), maxUlp);
+      break;
+    }
+
+  return 0;
+}
+
+extern "C" int
+LLVMFuzzerTestOneInput (const std::uint8_t *data, std::size_t size)
+{
+  return testOneInput (data, size);
+}
@@ -0,0 +1,387 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// genref: generate golden reference tables (see goldentable.h) with the
+// correctly rounded results of a binary32 function, computed by the MPFR
+// reference implementation, for a set of rounding modes and a range of
+// input bit patterns.
+//
+// The range is split in chunks of kChunkSize inputs evaluated in parallel.
+// With --shard K/N only the K-th of N chunk ranges is generated, in its own
+// table file, so the work can be split across machines sharing the output
+// directory.  Completed chunks are recorded in a <table>.progress file, so
+// an interrupted run resumes where it stopped; the file is removed once the
+// table is complete.  A final pass compares random table entries against
+// fresh reference evaluations.
+
+#include <bit>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include <fcntl.h>
+#include <fenv.h>
+#include <omp.h>
+#include <unistd.h>
+
+#include "goldentable.h"
+#include "iohelper.h"
+#include "refimpls.h"
+#include "strhelper.h"
+#include "wyhash64.h"
+
+using namespace refimpls;
+using namespace iohelper;
+
+using ClockType = std::chrono::high_resolution_clock;
+
+static constexpr std::uint64_t kChunkSize = 1 << 20;
+static constexpr std::uint64_t kFullRange = UINT64_C (1) << 32;
+
+static const std::map<std::string_view, int> kRoundModes
+    = { { "rndn", FE_TONEAREST },
+	{ "rndu", FE_UPWARD },
+	{ "rndd", FE_DOWNWARD },
+	{ "rndz", FE_TOWARDZERO } };
+
+static std::uint64_t
+parseBits (const std::string &str)
+{
+  char *end;
+  errno = 0;
+  std::uint64_t v = std::strtoull (str.c_str (), &end, 0);
+  if (str.empty () || *end != '\0' || errno != 0 || v > kFullRange)
+    error ("invalid bit pattern: {}", str);
+  return v;
+}
+
+static std::pair<std::uint64_t, std::uint64_t>
+parseShard (const std::string &str)
+{
+  auto parts = strhelper::splitWithRanges (str, "/");
+  if (parts.size () != 2)
+    error ("invalid shard: {}", str);
+  std::uint64_t k = parseBits (std::string (parts[0]));
+  std::uint64_t n = parseBits (std::string (parts[1]));
+  if (n == 0 || k >= n)
+    error ("invalid shard: {} (expected K/N with K < N)", str);
+  return { k, n };
+}
+
+//
+// Table generation.
+//
+
+struct Job
+{
+  std::string function;
+  FuncFReference<float> ref;
+  std::string rndname;
+  int rnd;
+  std::uint64_t start;
+  std::uint64_t end;
+};
+
+// Correctly rounded result for the input bit pattern BITS.
+static std::uint32_t
+reference (const Job &job, std::uint64_t bits)
+{
+  float x = std::bit_cast<float> (static_cast<std::uint32_t> (bits));
+  return std::bit_cast<std::uint32_t> (
+      static_cast<float> (job.ref (x, job.rnd)));
+}
+
+static void
+writeAll (int fd, const void *buf, std::size_t size, off_t off,
+	  const std::string &path)
+{
+  const char *p = static_cast<const char *> (buf);
+  while (size > 0)
+    {
+      ssize_t r = pwrite (fd, p, size, off);
+      if (r < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  error ("writing {}: {}", path, std::strerror (errno));
+	}
+      p += r;
+      size -= r;
+      off += r;
+    }
+}
+
+// Open (or create) the table file and its progress file, and return which
+// chunks are already generated.
+static std::vector<std::uint8_t>
+openTable (const Job &job, const std::string &path, int &fd, int &progressFd)
+{
+  const std::string progressPath = path + ".progress";
+  const std::uint64_t nchunks
+      = (job.end - job.start + kChunkSize - 1) / kChunkSize;
+  std::vector<std::uint8_t> done (nchunks, 0);
+
+  bool exists = std::filesystem::exists (path);
+  bool resume = std::filesystem::exists (progressPath);
+
+  fd = open (path.c_str (), O_RDWR | O_CREAT, 0644);
+  if (fd == -1)
+    error ("{}: {}", path, std::strerror (errno));
+
+  if (exists)
+    {
+      goldentable::Header h;
+      if (pread (fd, &h, sizeof (h), 0) != sizeof (h))
+	error ("{}: truncated golden table header", path);
+      if (auto r = goldentable::checkHeader (h, path); !r)
+	error ("{}", r.error ());
+      if (h.start != job.start || h.end != job.end
+	  || h.rounding != job.rnd
+	  || std::string_view (h.function, strnlen (h.function,
+						    sizeof (h.function)))
+		 != job.function)
+	error ("{}: table does not match the requested function and range",
+	       path);
+    }
+
+  if (exists && !resume)
+    {
+      // A complete table.
+      std::fill (done.begin (), done.end (), 1);
+      progressFd = -1;
+      return done;
+    }
+
+  progressFd = open (progressPath.c_str (), O_RDWR | O_CREAT, 0644);
+  if (progressFd == -1)
+    error ("{}: {}", progressPath, std::strerror (errno));
+
+  if (exists)
+    {
+      ssize_t r = pread (progressFd, done.data (), done.size (), 0);
+      if (r < 0)
+	error ("{}: {}", progressPath, std::strerror (errno));
+    }
+  else
+    {
+      const auto header = goldentable::makeHeader (job.function, job.rnd,
+						   job.start, job.end);
+      const off_t size = goldentable::kDataOffset
+			 + (job.end - job.start) * sizeof (std::uint32_t);
+      if (ftruncate (fd, size) == -1)
+	error ("{}: {}", path, std::strerror (errno));
+      writeAll (fd, &header, sizeof (header), 0, path);
+      writeAll (progressFd, done.data (), done.size (), 0, progressPath);
+    }
+
+  return done;
+}
+
+static void
+generateTable (const Job &job, const std::string &path)
+{
+  int fd, progressFd;
+  std::vector<std::uint8_t> done = openTable (job, path, fd, progressFd);
+  const std::uint64_t nchunks = done.size ();
+  const std::uint64_t pending = std::count (done.begin (), done.end (), 0);
+
+  if (pending == 0)
+    {
+      printlnTimestamp ("{}: complete", path);
+      close (fd);
+      return;
+    }
+  printlnTimestamp ("{}: generating {} of {} chunks", path, pending,
+		    nchunks);
+
+  auto start = ClockType::now ();
+
+#pragma omp parallel
+  {
+    refimpls::setupReferenceImpl<float> ();
+    std::vector<std::uint32_t> buffer (kChunkSize);
+
+#pragma omp for schedule(dynamic)
+    for (std::uint64_t c = 0; c < nchunks; c++)
+      {
+	if (done[c])
+	  continue;
+
+	const std::uint64_t b = job.start + c * kChunkSize;
+	const std::uint64_t n = std::min (kChunkSize, job.end - b);
+	for (std::uint64_t i = 0; i < n; i++)
+	  buffer[i] = reference (job, b + i);
+
+	writeAll (fd, buffer.data (), n * sizeof (std::uint32_t),
+		  goldentable::kDataOffset + c * kChunkSize
+					       * sizeof (std::uint32_t),
+		  path);
+	// The chunk is only marked as done once its data is on disk.
+	if (fdatasync (fd) == -1)
+	  error ("{}: {}", path, std::strerror (errno));
+
+#pragma omp critical
+	{
+	  done[c] = 1;
+	  writeAll (progressFd, &done[c], 1, c, path + ".progress");
+	}
+      }
+  }
+
+  close (fd);
+  close (progressFd);
+  std::filesystem::remove (path + ".progress");
+
+  auto end = ClockType::now ();
+  printlnTimestamp (
+      "{}: done in {}", path,
+      std::chrono::duration_cast<std::chrono::duration<double> > (end
+								  - start));
+}
+
+// Compare COUNT random entries of the table against the reference.
+static bool
+verifyTable (const Job &job, const std::string &path, std::uint64_t count)
+{
+  auto table = goldentable::Table::open (path);
+  if (!table)
+    error ("{}", table.error ());
+  const std::uint32_t *data = table->data ();
+  const std::uint64_t size = job.end - job.start;
+
+  std::uint64_t mismatches = 0;
+
+#pragma omp parallel reduction(+ : mismatches)
+  {
+    refimpls::setupReferenceImpl<float> ();
+    wyhash64 gen (std::random_device{}());
+
+#pragma omp for
+    for (std::uint64_t i = 0; i < count; i++)
+      {
+	const std::uint64_t off = gen () % size;
+	const std::uint32_t expected = reference (job, job.start + off);
+	if (data[off] != expected)
+	  {
+#pragma omp critical
+	    printlnErrorTimestamp ("{}: mismatch input={:#x} table={:#x} "
+				   "reference={:#x}",
+				   path, job.start + off, data[off], expected);
+	    mismatches++;
+	  }
+      }
+  }
+
+  printlnTimestamp ("{}: verified {} entries, {} mismatches", path, count,
+		    mismatches);
+  return mismatches == 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  argparse::ArgumentParser options ("genref");
+
+  options.add_argument ("--symbol", "-s")
+      .help ("binary32 math function to generate the table for")
+      .required ();
+
+  options.add_argument ("--rounding", "-r")
+      .help ("rounding modes to generate")
+      .default_value (std::string ("rndn,rndu,rndd,rndz"));
+
+  options.add_argument ("--output", "-o")
+      .help ("output directory")
+      .required ();
+
+  options.add_argument ("--start")
+      .help ("first input bit pattern")
+      .default_value (std::string ("0"));
+
+  options.add_argument ("--end")
+      .help ("input bit pattern end (exclusive)")
+      .default_value (std::string ("0x100000000"));
+
+  options.add_argument ("--shard")
+      .help ("generate only the K-th of N chunk ranges (K/N, with K "
+	     "starting at 0)");
+
+  options.add_argument ("--verify")
+      .help ("number of random table entries checked against the "
+	     "reference (0 to disable)")
+      .default_value (std::uint64_t (1) << 16)
+      .scan<'u', std::uint64_t> ();
+
+  try
+    {
+      options.parse_args (argc, argv);
+    }
+  catch (const std::runtime_error &err)
+    {
+      error (std::string (err.what ()));
+    }
+
+  const std::string function = options.get<std::string> ("-s");
+  auto functype = getFunctionType (function);
+  if (!functype)
+    error ("invalid function: {}", function);
+  if (functype.value () != refimpls::FunctionType::f32_f)
+    error ("function type \"{}\" not supported", functype.value ());
+  auto funcs = getFunctionFloat<float> (function).value ();
+
+  std::uint64_t start = parseBits (options.get<std::string> ("--start"));
+  std::uint64_t end = parseBits (options.get<std::string> ("--end"));
+  if (start >= end)
+    error ("invalid range: [{:#x}, {:#x})", start, end);
+
+  if (auto shard = options.present ("--shard"))
+    {
+      // Split on chunk boundaries, so the chunks of all the shards are the
+      // same as a single run.
+      auto [k, n] = parseShard (*shard);
+      const std::uint64_t nchunks
+	  = (end - start + kChunkSize - 1) / kChunkSize;
+      const std::uint64_t cbegin = nchunks * k / n;
+      const std::uint64_t cend = nchunks * (k + 1) / n;
+      if (cbegin == cend)
+	error ("shard {} is empty", *shard);
+      end = std::min (end, start + cend * kChunkSize);
+      start = start + cbegin * kChunkSize;
+    }
+
+  const std::string outputDir = options.get<std::string> ("-o");
+  std::error_code ec;
+  std::filesystem::create_directories (outputDir, ec);
+  if (ec)
+    error ("creating output directory {}: {}", outputDir, ec.message ());
+
+  const std::uint64_t verify = options.get<std::uint64_t> ("--verify");
+
+  bool ok = true;
+  for (const auto &rnd :
+       strhelper::splitWithRanges (options.get<std::string> ("-r"), ","))
+    {
+      auto it = kRoundModes.find (rnd);
+      if (it == kRoundModes.end ())
+	error ("invalid rounding mode: {}", rnd);
+
+      Job job{ function, funcs.second, std::string (it->first), it->second,
+	       start, end };
+      const auto path = std::filesystem::path (outputDir)
+			/ goldentable::fileName (function, job.rndname,
+						 start, end);
+
+      generateTable (job, path.string ());
+      if (verify != 0)
+	ok &= verifyTable (job, path.string (), verify);
+    }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
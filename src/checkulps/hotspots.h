@@ -0,0 +1,288 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _HOTSPOTS_H
+#define _HOTSPOTS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <mpfr.h>
+
+#include "description.h"
+
+//
+// hotspots: the floating point numbers closest to the multiples of a
+//           constant (pi/2 for sin, cos and tan, ln2 for exp and expm1),
+//           where the argument reduction cancels the most bits.
+//
+//           For the binade [2^e, 2^(e+1)) of a format with p bits of
+//           precision, the inputs are x = m * u with u = 2^(e-p+1) and m in
+//           [2^(p-1), 2^p), and x is close to k * C when m / k is a good
+//           rational approximation of alpha = C / u.  The candidates are the
+//           convergents and the upper semiconvergents of the continued
+//           fraction of alpha (the best approximations), along with their
+//           first multiples in the mantissa range, and the distance of each
+//           one to the closest multiple, |m - k * alpha| ulps, is computed
+//           with MPFR at a precision large enough for the binade.
+//
+
+namespace hotspots
+{
+
+template <typename F> struct Candidate
+{
+  F x;
+  // Distance to the hot spot, in ulps of X.
+  double distance;
+
+  bool
+  operator< (const Candidate &other) const
+  {
+    return distance < other.distance;
+  }
+};
+
+//
+// Closest: bounded set of the candidates with the smallest distance.
+//
+
+template <typename F> class Closest
+{
+  std::size_t count;
+  // Max-heap on the distance, the front is the farthest candidate.
+  std::vector<Candidate<F> > heap;
+
+public:
+  explicit Closest (std::size_t n) : count (n) {}
+
+  void
+  add (F x, double distance)
+  {
+    if (count == 0
+	|| (heap.size () == count && !(distance < heap.front ().distance)))
+      return;
+    heap.push_back (Candidate<F>{ x, distance });
+    std::push_heap (heap.begin (), heap.end ());
+    if (heap.size () > count)
+      {
+	std::pop_heap (heap.begin (), heap.end ());
+	heap.pop_back ();
+      }
+  }
+
+  void
+  merge (const Closest &other)
+  {
+    for (const auto &c : other.heap)
+      add (c.x, c.distance);
+  }
+
+  // The candidates, closest first.
+  std::vector<Candidate<F> >
+  sorted () const
+  {
+    std::vector<Candidate<F> > ret (heap);
+    std::sort (ret.begin (), ret.end ());
+    return ret;
+  }
+};
+
+inline std::string_view
+name (Description::Hotspot kind)
+{
+  switch (kind)
+    {
+    case Description::Hotspot::PI_2:
+      return "pi/2";
+    case Description::Hotspot::PI:
+      return "pi";
+    case Description::Hotspot::LN2:
+      return "ln2";
+    case Description::Hotspot::ZEROS:
+      return "zeros";
+    }
+  return "";
+}
+
+inline void
+setConstant (mpfr_t c, Description::Hotspot kind)
+{
+  switch (kind)
+    {
+    case Description::Hotspot::PI_2:
+      mpfr_const_pi (c, MPFR_RNDN);
+      mpfr_div_2ui (c, c, 1, MPFR_RNDN);
+      break;
+    case Description::Hotspot::PI:
+      mpfr_const_pi (c, MPFR_RNDN);
+      break;
+    case Description::Hotspot::LN2:
+      mpfr_const_log2 (c, MPFR_RNDN);
+      break;
+    default:
+      std::unreachable ();
+    }
+}
+
+// Upper semiconvergents and multiples tried for each continued fraction
+// term; the best approximations come first, so a few of each are enough.
+static constexpr std::uint64_t kSemiconvergents = 8;
+static constexpr std::uint64_t kMultiples = 4;
+
+// Add to OUT the inputs of the binade [2^E, 2^(E+1)) in [LO, HI] (positive)
+// closest to the multiples of the KIND constant.
+template <typename F>
+void
+binadeMultiples (Description::Hotspot kind, int e, F lo, F hi,
+		 Closest<F> &out)
+{
+  constexpr int p = std::numeric_limits<F>::digits;
+  const int uexp = e - p + 1;
+
+  // The mantissa range of the binade intersected with [LO, HI].
+  const double mlo = std::ceil (std::ldexp (static_cast<double> (lo), -uexp));
+  const double mhi = std::floor (std::ldexp (static_cast<double> (hi), -uexp));
+  const std::uint64_t mmin = std::max (UINT64_C (1) << (p - 1),
+				       static_cast<std::uint64_t> (
+					   std::max (mlo, 0.0)));
+  const std::uint64_t mmax
+      = mhi >= 0x1p63 ? (UINT64_C (1) << p) - 1
+		      : std::min ((UINT64_C (1) << p) - 1,
+				  static_cast<std::uint64_t> (mhi));
+  if (mmin > mmax)
+    return;
+
+  // The binade might be far from the constant (alpha tiny or huge), and the
+  // intermediate values should not be limited by the reference setup.
+  const mpfr_exp_t emin = mpfr_get_emin ();
+  const mpfr_exp_t emax = mpfr_get_emax ();
+  mpfr_set_emin (mpfr_get_emin_min ());
+  mpfr_set_emax (mpfr_get_emax_max ());
+
+  const mpfr_prec_t prec = 2 * (p + std::abs (e)) + 128;
+  mpfr_t alpha, beta, t, a, r;
+  mpfr_inits2 (prec, alpha, beta, t, a, r, (mpfr_ptr) 0);
+
+  setConstant (alpha, kind);
+  mpfr_mul_2si (alpha, alpha, -uexp, MPFR_RNDN);
+  mpfr_ui_div (beta, 1, alpha, MPFR_RNDN);
+
+  // |m - k * alpha| for the closest k, from m / alpha = k + eps.
+  auto distance = [&] (std::uint64_t m) {
+    mpfr_mul_ui (t, beta, m, MPFR_RNDN);
+    mpfr_rint (a, t, MPFR_RNDN);
+    mpfr_sub (t, t, a, MPFR_RNDN);
+    mpfr_abs (t, t, MPFR_RNDN);
+    mpfr_mul (t, t, alpha, MPFR_RNDN);
+    return mpfr_get_d (t, MPFR_RNDN);
+  };
+
+  std::unordered_set<std::uint64_t> seen;
+  auto consider = [&] (std::uint64_t h) {
+    if (h == 0)
+      return;
+    std::uint64_t j = std::max<std::uint64_t> ((mmin + h - 1) / h, 1);
+    for (std::uint64_t n = 0; n < kMultiples && j <= mmax / h; n++, j++)
+      if (seen.insert (j * h).second)
+	out.add (std::ldexp (static_cast<F> (j * h), uexp),
+		 distance (j * h));
+  };
+
+  // The continued fraction of alpha, with h[n] = a[n] * h[n-1] + h[n-2].
+  // The partial quotients are saturated, since a quotient larger than the
+  // mantissa range ends the expansion anyway.
+  std::uint64_t h2 = 0, h1 = 1;
+  mpfr_set (t, alpha, MPFR_RNDN);
+  for (int n = 0; n < 4 * p && h2 <= mmax; n++)
+    {
+      mpfr_floor (a, t);
+      mpfr_sub (r, t, a, MPFR_RNDN);
+      const std::uint64_t an = mpfr_cmp_ui_2exp (a, 1, 62) >= 0
+				   ? UINT64_C (1) << 62
+				   : mpfr_get_ui (a, MPFR_RNDZ);
+
+      // The semiconvergents h[n-2] + j * h[n-1] for j in [a[n]/2, a[n]]
+      // below the mantissa limit, largest (and closest) first; j = a[n]
+      // is the convergent.  h[0] is 0 when alpha is below 1.
+      const std::uint64_t jmax
+	  = h1 == 0 ? an : std::min (an, (mmax - h2) / h1);
+      const std::uint64_t jmin = std::max<std::uint64_t> ((an + 1) / 2, 1);
+      for (std::uint64_t j = jmax, i = 0; j >= jmin && i < kSemiconvergents;
+	   j--, i++)
+	consider (h2 + j * h1);
+
+      if (jmax < an || mpfr_zero_p (r))
+	break;
+      const std::uint64_t h = h2 + an * h1;
+      h2 = h1;
+      h1 = h;
+      mpfr_ui_div (t, 1, r, MPFR_RNDN);
+    }
+
+  mpfr_clears (alpha, beta, t, a, r, (mpfr_ptr) 0);
+  mpfr_set_emin (emin);
+  mpfr_set_emax (emax);
+}
+
+// About COUNT inputs in [START, END] close to the multiples of the KIND
+// constant.  The inputs are spread over the binades of the range (the best
+// ones of each binade), since the argument reduction usually depends on the
+// input magnitude, and returned closest first.
+template <typename F>
+std::vector<Candidate<F> >
+multiples (Description::Hotspot kind, F start, F end, std::uint64_t count)
+{
+  // The binades of the positive side [LO, HI], negated when NEGATE is set.
+  struct Binade
+  {
+    int e;
+    F lo;
+    F hi;
+    bool negate;
+  };
+  std::vector<Binade> binades;
+  auto side = [&] (F lo, F hi, bool negate) {
+    hi = std::min (hi, std::numeric_limits<F>::max ());
+    // There is no multiple below the constant, and ln2 is the smallest.
+    lo = std::max (lo, F (0.5));
+    if (lo > hi)
+      return;
+    for (int e = std::ilogb (lo); e <= std::ilogb (hi); e++)
+      binades.push_back (Binade{ e, lo, hi, negate });
+  };
+  if (end > F (0))
+    side (std::max (start, F (0)), end, false);
+  if (start < F (0))
+    side (std::max (-end, F (0)), -start, true);
+  if (binades.empty ())
+    return {};
+
+  const std::uint64_t perBinade = (count + binades.size () - 1)
+				  / binades.size ();
+  Closest<F> closest (count);
+#pragma omp parallel for schedule(dynamic)
+  for (std::size_t i = 0; i < binades.size (); i++)
+    {
+      const Binade &b = binades[i];
+      Closest<F> local (perBinade);
+      binadeMultiples (kind, b.e, b.lo, b.hi, local);
+#pragma omp critical
+      for (const auto &c : local.sorted ())
+	closest.add (b.negate ? -c.x : c.x, c.distance);
+    }
+
+  return closest.sorted ();
+}
+
+} // namespace hotspots
+
+#endif
@@ -0,0 +1,177 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _LIBMTEST_H
+#define _LIBMTEST_H
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fenv.h>
+
+#include "strhelper.h"
+
+//
+// libmtest: reader of the glibc math/auto-libm-test-out-<function> files,
+//           the correctly rounded results of the glibc curated inputs for
+//           all the rounding modes, generated by gen-auto-libm-tests with
+//           MPFR.  Each result line is:
+//
+//             = <function> <rounding> <format> <inputs> : <outputs> : <flags>
+//
+//           with the rounding mode one of downward, tonearest, towardzero
+//           and upward, the floating point values in hexadecimal (or
+//           plus_infty and minus_infty) and the integers in decimal.  The
+//           other lines (the test input descriptions) are ignored, as are
+//           the flags (the exceptions and errno expectations).
+//
+
+namespace libmtest
+{
+
+struct Line
+{
+  std::string function;
+  int rounding;
+  std::string format;
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+};
+
+inline std::optional<int>
+roundingFromName (std::string_view name)
+{
+  if (name == "tonearest")
+    return FE_TONEAREST;
+  if (name == "upward")
+    return FE_UPWARD;
+  if (name == "downward")
+    return FE_DOWNWARD;
+  if (name == "towardzero")
+    return FE_TOWARDZERO;
+  return std::nullopt;
+}
+
+inline std::vector<std::string>
+splitFields (const std::string &s)
+{
+  std::vector<std::string> ret;
+  for (auto &f : strhelper::splitWithRanges (s, " "))
+    if (!f.empty ())
+      ret.push_back (f);
+  return ret;
+}
+
+// Read the result lines of FILENAME for the formats in FORMATS.
+inline std::expected<std::vector<Line>, std::string>
+read (const std::string &fileName, const std::vector<std::string> &formats)
+{
+  std::ifstream in (fileName);
+  if (!in)
+    return std::unexpected (
+	std::format ("{}: {}", fileName, std::strerror (errno)));
+
+  std::vector<Line> ret;
+  std::string line;
+  for (unsigned lineno = 1; std::getline (in, line); lineno++)
+    {
+      if (!line.starts_with ("= "))
+	continue;
+
+      auto parts = strhelper::splitWithRanges (line.substr (2), ":");
+      if (parts.size () < 2)
+	return std::unexpected (
+	    std::format ("{}:{}: invalid result line", fileName, lineno));
+      auto head = splitFields (parts[0]);
+      if (head.size () < 4)
+	return std::unexpected (
+	    std::format ("{}:{}: invalid result line", fileName, lineno));
+      if (std::find (formats.begin (), formats.end (), head[2])
+	  == formats.end ())
+	continue;
+
+      auto rounding = roundingFromName (head[1]);
+      if (!rounding)
+	return std::unexpected (std::format (
+	    "{}:{}: invalid rounding mode {}", fileName, lineno, head[1]));
+
+      ret.push_back (Line{ head[0], *rounding, head[2],
+			   std::vector<std::string> (head.begin () + 3,
+						     head.end ()),
+			   splitFields (parts[1]) });
+    }
+  return ret;
+}
+
+// The test files of PATH: either PATH itself or the auto-libm-test-out-*
+// files in it, if it is a directory (the glibc math directory).
+inline std::vector<std::string>
+testFiles (const std::string &path)
+{
+  std::vector<std::string> ret;
+  std::error_code ec;
+  if (!std::filesystem::is_directory (path, ec))
+    ret.push_back (path);
+  else
+    for (const auto &e : std::filesystem::directory_iterator (path, ec))
+      if (e.path ().filename ().string ().starts_with ("auto-libm-test-out-"))
+	ret.push_back (e.path ().string ());
+  std::sort (ret.begin (), ret.end ());
+  return ret;
+}
+
+// Parse a value of the test files.  The floating point values are exact in
+// their format, so the underflow range errors of the subnormal ones are
+// ignored.
+template <typename T>
+inline std::optional<T>
+parseValue (const std::string &s)
+{
+  if constexpr (std::is_integral_v<T>)
+    {
+      T v;
+      auto r = std::from_chars (s.data (), s.data () + s.size (), v);
+      if (r.ec != std::errc () || r.ptr != s.data () + s.size ())
+	return std::nullopt;
+      return v;
+    }
+  else
+    {
+      if (s == "plus_infty")
+	return std::numeric_limits<T>::infinity ();
+      if (s == "minus_infty")
+	return -std::numeric_limits<T>::infinity ();
+      if (s == "qnan_value")
+	return std::numeric_limits<T>::quiet_NaN ();
+
+      char *end;
+      T v;
+      if constexpr (std::is_same_v<T, float>)
+	v = std::strtof (s.c_str (), &end);
+      else
+	v = std::strtod (s.c_str (), &end);
+      if (s.empty () || *end != '\0')
+	return std::nullopt;
+      return v;
+    }
+}
+
+} // namespace libmtest
+
+#endif
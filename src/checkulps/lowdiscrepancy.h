@@ -0,0 +1,182 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _LOWDISCREPANCY_H
+#define _LOWDISCREPANCY_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+#include "distribution.h"
+#include "wyhash64.h"
+
+//
+// Scrambled low-discrepancy sequences used for the description samples.
+// The points are computed directly from their index (there is no sequential
+// state), so any subset of indexes (a thread chunk or a --shard) generates
+// exactly the same points as a full run with the same seed.
+//
+// The points are returned as 64-bit fixed point numbers in [0, 1), which
+// are then mapped to the argument ranges by the sample distribution (see
+// distribution.h).
+//
+
+namespace lowdiscrepancy
+{
+
+static constexpr std::uint64_t
+bitReverse (std::uint64_t x)
+{
+  std::uint64_t r = 0;
+  for (unsigned i = 0; i < 64; i++, x >>= 1)
+    r = (r << 1) | (x & 1);
+  return r;
+}
+
+// Direction numbers of the second Sobol dimension (primitive polynomial
+// x + 1, initial direction number m1 = 1).
+static constexpr std::array<std::uint64_t, 64>
+sobolDirectionNumbers ()
+{
+  std::array<std::uint64_t, 64> v{};
+  v[0] = UINT64_C (1) << 63;
+  for (unsigned j = 1; j < 64; j++)
+    v[j] = v[j - 1] ^ (v[j - 1] >> 1);
+  return v;
+}
+
+//
+// Sobol: the first two dimensions of the Sobol sequence (the van der Corput
+//        sequence and the one from the primitive polynomial x + 1), in gray
+//        code order, scrambled with a random digital shift.
+//
+
+class Sobol
+{
+  static constexpr std::array<std::uint64_t, 64> kDir1
+      = sobolDirectionNumbers ();
+
+  std::uint64_t shift[2];
+
+public:
+  explicit Sobol (std::uint64_t seed)
+  {
+    wyhash64 gen (seed);
+    shift[0] = gen ();
+    shift[1] = gen ();
+  }
+
+  std::pair<std::uint64_t, std::uint64_t>
+  operator() (std::uint64_t index) const
+  {
+    const std::uint64_t gray = index ^ (index >> 1);
+
+    std::uint64_t x1 = 0;
+    for (std::uint64_t g = gray; g != 0; g &= g - 1)
+      x1 ^= kDir1[std::countr_zero (g)];
+
+    return { bitReverse (gray) ^ shift[0], x1 ^ shift[1] };
+  }
+};
+
+//
+// Random: pseudo-random points, used for the random samples with a
+//         non-uniform distribution.  wyhash64 is counter based, so the
+//         point of an index is computed by seeding it at the index offset
+//         of a single stream.
+//
+
+class Random
+{
+  // The wyhash64 state increment.
+  static constexpr std::uint64_t kIncrement = 0x60bee2bee120fc15ull;
+
+  std::uint64_t seed;
+
+public:
+  explicit Random (std::uint64_t s) : seed (s) {}
+
+  std::pair<std::uint64_t, std::uint64_t>
+  operator() (std::uint64_t index) const
+  {
+    wyhash64 gen (seed + 2 * index * kIncrement);
+    const std::uint64_t x = gen ();
+    return { x, gen () };
+  }
+};
+
+//
+// Halton: radical inverses in bases 2 and 3, scrambled with a random
+//         permutation of the digits at each position.
+//
+
+class Halton
+{
+  // Number of base 3 digits of a 64-bit index.
+  static constexpr unsigned kDigits3 = 41;
+
+  std::array<std::uint8_t, kDigits3 * 3> perm3;
+  std::uint64_t shift2;
+
+public:
+  explicit Halton (std::uint64_t seed)
+  {
+    wyhash64 gen (seed);
+    shift2 = gen ();
+    for (unsigned d = 0; d < kDigits3; d++)
+      {
+	std::uint8_t *p = &perm3[d * 3];
+	std::iota (p, p + 3, 0);
+	// Fisher-Yates.
+	for (unsigned i = 2; i > 0; i--)
+	  std::swap (p[i], p[gen () % (i + 1)]);
+      }
+  }
+
+  std::pair<std::uint64_t, std::uint64_t>
+  operator() (std::uint64_t index) const
+  {
+    // In base 2 a digit permutation is a XOR of the reversed index bits.
+    const std::uint64_t r2 = bitReverse (index);
+
+    // Accumulate the base 3 digits from the least significant one, so each
+    // step is a division by 3 of the fixed point value.
+    std::uint64_t digits[kDigits3];
+    for (unsigned d = 0; d < kDigits3; d++, index /= 3)
+      digits[d] = perm3[d * 3 + index % 3];
+
+    double r3 = 0.0;
+    for (unsigned d = kDigits3; d-- > 0;)
+      r3 = (r3 + digits[d]) / 3.0;
+
+    return { r2 ^ shift2, toFixed (r3) };
+  }
+
+private:
+  static std::uint64_t
+  toFixed (double u)
+  {
+    u = std::min (u, 0x1.fffffffffffffp-1);
+    return static_cast<std::uint64_t> (u * 0x1p64);
+  }
+};
+
+inline long long int
+mapInteger (std::uint64_t u, long long int start, long long int end)
+{
+  const std::uint64_t n = static_cast<std::uint64_t> (end) - start + 1;
+  const std::uint64_t off = n == 0 ? u : distribution::mulHigh (u, n);
+  return static_cast<long long int> (start + off);
+}
+
+} // namespace lowdiscrepancy
+
+#endif
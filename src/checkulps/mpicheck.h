@@ -0,0 +1,361 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _MPICHECK_H
+#define _MPICHECK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef CHECKULPS_MPI
+#  include <mpi.h>
+#endif
+
+#include "iohelper.h"
+#include "snapshot.h"
+
+//
+// mpicheck: dynamic scheduling of the sample checks over MPI ranks, enabled
+//           with the CHECKULPS_MPI build option and mpirun.  Rank 0 only
+//           schedules: it hands out the blocks of each sample index range
+//           to the worker ranks as they ask for more work, so the ranks on
+//           fast nodes (or with the cheaper inputs) are never idle while the
+//           others finish a static share.  The workers check each block with
+//           the usual OpenMP engine and send their ULP histogram and worst
+//           results with every request; rank 0 merges them for the periodic
+//           progress report and, once the range is exhausted, for the final
+//           report.  Only rank 0 prints the reports.
+//
+//           All the ranks run the same sequence of checks, the index range
+//           of each being the one of a single process run (after --shard).
+//           The hotspot samples, checked as a list, are not split and
+//           every rank checks them.  Without MPI, or with a single rank, a
+//           check is one block with the whole range.
+//
+
+namespace mpicheck
+{
+
+inline int worldRank = 0;
+inline int worldSize = 1;
+
+// Samples per block handed to a worker, set by --mpi-block.
+inline std::uint64_t blockSize = UINT64_C (1) << 20;
+// Seconds between the progress reports of rank 0, set by --mpi-progress.
+inline double progressInterval = 60.0;
+
+inline bool
+distributed ()
+{
+  return worldSize > 1;
+}
+
+inline bool
+root ()
+{
+  return worldRank == 0;
+}
+
+inline void
+init (int *argc, char ***argv)
+{
+#ifdef CHECKULPS_MPI
+  // Only the main thread calls MPI, outside the OpenMP parallel regions.
+  int provided;
+  MPI_Init_thread (argc, argv, MPI_THREAD_FUNNELED, &provided);
+  MPI_Comm_rank (MPI_COMM_WORLD, &worldRank);
+  MPI_Comm_size (MPI_COMM_WORLD, &worldSize);
+  // The workers report through rank 0, the failures are still printed to
+  // stderr.
+  if (distributed () && !root ())
+    if (std::freopen ("/dev/null", "w", stdout) == nullptr)
+      iohelper::error ("failed to redirect stdout of rank {}", worldRank);
+#endif
+}
+
+inline void
+finalize ()
+{
+#ifdef CHECKULPS_MPI
+  MPI_Finalize ();
+#endif
+}
+
+// Set V on all the ranks to its value on rank 0.
+inline void
+broadcast (std::uint64_t &v)
+{
+#ifdef CHECKULPS_MPI
+  if (distributed ())
+    MPI_Bcast (&v, 1, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+#endif
+}
+
+inline void
+printWorst (const snapshot::WorstResults &worst)
+{
+  if (!distributed ())
+    return;
+  for (const auto &[ulp, str] : worst.sorted ())
+    iohelper::printlnTimestamp ("    worst: {}", str);
+}
+
+#ifdef CHECKULPS_MPI
+
+static constexpr int kTagRequest = 1;
+static constexpr int kTagBlock = 2;
+
+//
+// The worker state sent with each request: the samples checked so far, the
+// ULP histogram and the worst results.
+//
+
+class Message
+{
+  std::vector<char> data;
+  std::size_t pos = 0;
+
+  template <typename T>
+  void
+  put (const T &v)
+  {
+    const char *p = reinterpret_cast<const char *> (&v);
+    data.insert (data.end (), p, p + sizeof (T));
+  }
+
+  template <typename T>
+  T
+  get ()
+  {
+    T v;
+    if (data.size () - pos < sizeof (T))
+      iohelper::error ("truncated MPI message");
+    std::memcpy (&v, data.data () + pos, sizeof (T));
+    pos += sizeof (T);
+    return v;
+  }
+
+public:
+  Message () = default;
+  explicit Message (std::vector<char> &&d) : data (std::move (d)) {}
+
+  const std::vector<char> &
+  bytes () const
+  {
+    return data;
+  }
+
+  template <typename F>
+  void
+  encode (std::uint64_t samples, const std::map<F, std::uint64_t> &ulps,
+	  const snapshot::WorstResults &worst)
+  {
+    put (samples);
+    put<std::uint64_t> (ulps.size ());
+    for (const auto &[ulp, n] : ulps)
+      {
+	put (ulp);
+	put (n);
+      }
+    const auto entries = worst.sorted ();
+    put<std::uint64_t> (entries.size ());
+    for (const auto &[ulp, str] : entries)
+      {
+	put (ulp);
+	put<std::uint64_t> (str.size ());
+	data.insert (data.end (), str.begin (), str.end ());
+      }
+  }
+
+  template <typename F>
+  void
+  decode (std::uint64_t &samples, std::map<F, std::uint64_t> &ulps,
+	  snapshot::WorstResults &worst)
+  {
+    samples = get<std::uint64_t> ();
+    ulps.clear ();
+    for (auto n = get<std::uint64_t> (); n > 0; n--)
+      {
+	const F ulp = get<F> ();
+	ulps[ulp] = get<std::uint64_t> ();
+      }
+    worst = snapshot::WorstResults ();
+    for (auto n = get<std::uint64_t> (); n > 0; n--)
+      {
+	const double ulp = get<double> ();
+	const auto size = get<std::uint64_t> ();
+	if (data.size () - pos < size)
+	  iohelper::error ("truncated MPI message");
+	worst.add (ulp, std::string (data.data () + pos, size));
+	pos += size;
+      }
+  }
+};
+
+#endif
+
+//
+// Blocks: the blocks of the index range [BEGIN, END) of one check (a sample
+//         and rounding mode) that this process should check:
+//
+//   while (auto block = blocks.next ())
+//     check [block->first, block->second) adding to ULPS and WORST
+//
+// On rank 0 next serves all the worker requests, and returns with ULPS and
+// WORST set to the merged results of all the ranks.
+//
+
+template <typename F> class Blocks
+{
+  typedef std::map<F, std::uint64_t> Histogram;
+
+  const std::string title;
+  const std::uint64_t begin;
+  const std::uint64_t end;
+  Histogram &ulps;
+  snapshot::WorstResults &worst;
+  std::uint64_t samples = 0;
+  std::optional<std::pair<std::uint64_t, std::uint64_t> > last;
+  bool done = false;
+
+#ifdef CHECKULPS_MPI
+  struct Worker
+  {
+    std::uint64_t samples = 0;
+    Histogram ulps;
+    snapshot::WorstResults worst;
+  };
+
+  void
+  progress (const std::vector<Worker> &workers) const
+  {
+    std::uint64_t checked = 0;
+    F maxUlp = 0;
+    for (const auto &w : workers)
+      {
+	checked += w.samples;
+	if (!w.ulps.empty ())
+	  maxUlp = std::max (maxUlp, w.ulps.rbegin ()->first);
+      }
+    iohelper::printlnTimestamp (
+	"Progress {}: {}/{} ({:.2f}%), max ULP {:g}", title, checked,
+	end - begin,
+	end > begin ? (double) checked / (double) (end - begin) * 100.0
+		    : 100.0,
+	maxUlp);
+    std::fflush (stdout);
+  }
+
+  void
+  serve ()
+  {
+    std::vector<Worker> workers (worldSize);
+    std::uint64_t next = begin;
+    int active = worldSize - 1;
+    auto reported = std::chrono::steady_clock::now ();
+
+    while (active > 0)
+      {
+	MPI_Status status;
+	MPI_Probe (MPI_ANY_SOURCE, kTagRequest, MPI_COMM_WORLD, &status);
+	int size;
+	MPI_Get_count (&status, MPI_BYTE, &size);
+	std::vector<char> data (size);
+	MPI_Recv (data.data (), size, MPI_BYTE, status.MPI_SOURCE,
+		  kTagRequest, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+	Worker &w = workers[status.MPI_SOURCE];
+	Message (std::move (data)).decode (w.samples, w.ulps, w.worst);
+
+	// An empty block tells the worker the range is done, its request
+	// carried its final state.
+	std::uint64_t block[2]
+	    = { next, next + std::min (blockSize, end - next) };
+	next = block[1];
+	if (block[0] == block[1])
+	  active--;
+	MPI_Send (block, 2, MPI_UINT64_T, status.MPI_SOURCE, kTagBlock,
+		  MPI_COMM_WORLD);
+
+	const auto now = std::chrono::steady_clock::now ();
+	if (active > 0
+	    && std::chrono::duration<double> (now - reported).count ()
+		   >= progressInterval)
+	  {
+	    progress (workers);
+	    reported = now;
+	  }
+      }
+
+    for (const auto &w : workers)
+      {
+	for (const auto &[ulp, n] : w.ulps)
+	  ulps[ulp] += n;
+	worst.merge (w.worst);
+      }
+  }
+
+  std::optional<std::pair<std::uint64_t, std::uint64_t> >
+  request ()
+  {
+    if (last)
+      samples += last->second - last->first;
+    Message m;
+    m.encode (samples, ulps, worst);
+    MPI_Send (m.bytes ().data (), m.bytes ().size (), MPI_BYTE, 0,
+	      kTagRequest, MPI_COMM_WORLD);
+    std::uint64_t block[2];
+    MPI_Recv (block, 2, MPI_UINT64_T, 0, kTagBlock, MPI_COMM_WORLD,
+	      MPI_STATUS_IGNORE);
+    if (block[0] == block[1])
+      return std::nullopt;
+    return std::make_pair (block[0], block[1]);
+  }
+#endif
+
+public:
+  Blocks (std::string t, std::uint64_t b, std::uint64_t e, Histogram &u,
+	  snapshot::WorstResults &w)
+      : title (std::move (t)), begin (b), end (e), ulps (u), worst (w)
+  {
+  }
+
+  std::optional<std::pair<std::uint64_t, std::uint64_t> >
+  next ()
+  {
+    if (done)
+      return std::nullopt;
+#ifdef CHECKULPS_MPI
+    if (distributed ())
+      {
+	if (root ())
+	  serve ();
+	else if ((last = request ()))
+	  return last;
+	// All the requests carry the same tag, so no rank starts the next
+	// check (and sends its first request) before rank 0 has received the
+	// final state of every worker for this one.
+	MPI_Barrier (MPI_COMM_WORLD);
+	done = true;
+	return std::nullopt;
+      }
+#endif
+    done = true;
+    return std::make_pair (begin, end);
+  }
+};
+
+} // namespace mpicheck
+
+#endif
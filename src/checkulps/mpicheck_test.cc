@@ -0,0 +1,89 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// mpicheck scheduler test, run with mpirun -np 4 (see CMakeLists.txt): a
+// sequence of checks of different sizes where the rank 1 is much slower
+// than the others, so the fast workers finish each check while rank 0 is
+// still serving it.  Rank 0 verifies the merged histogram and worst results
+// of every check against the ones of a single process run.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+#include "mpicheck.h"
+
+namespace
+{
+
+struct Result
+{
+  double ulp;
+};
+
+}
+
+template <> struct std::formatter<Result> : std::formatter<double>
+{
+  auto
+  format (const Result &r, std::format_context &ctx) const
+  {
+    return std::formatter<double>::format (r.ulp, ctx);
+  }
+};
+
+static constexpr int kChecks = 64;
+
+int
+main (int argc, char *argv[])
+{
+  mpicheck::init (&argc, &argv);
+  mpicheck::blockSize = 100;
+  mpicheck::progressInterval = 1e9;
+
+  int failures = 0;
+  for (int check = 0; check < kChecks; check++)
+    {
+      const std::uint64_t begin = check;
+      const std::uint64_t end = begin + 50 + (check * 37) % 500;
+
+      std::map<double, std::uint64_t> ulps;
+      snapshot::WorstResults worst;
+      mpicheck::Blocks<double> blocks ("test", begin, end, ulps, worst);
+      while (auto block = blocks.next ())
+	{
+	  if (mpicheck::worldRank == 1)
+	    std::this_thread::sleep_for (std::chrono::milliseconds (2));
+	  for (std::uint64_t i = block->first; i < block->second; i++)
+	    {
+	      ulps[i % 5] += 1;
+	      worst.add (Result{ static_cast<double> (i) });
+	    }
+	}
+
+      if (!mpicheck::root ())
+	continue;
+
+      std::map<double, std::uint64_t> expected;
+      snapshot::WorstResults expectedWorst;
+      for (std::uint64_t i = begin; i < end; i++)
+	{
+	  expected[i % 5] += 1;
+	  expectedWorst.add (Result{ static_cast<double> (i) });
+	}
+      if (ulps != expected || worst.sorted () != expectedWorst.sorted ())
+	{
+	  iohelper::printlnErrorTimestamp ("check {}: merged results mismatch",
+					   check);
+	  failures++;
+	}
+    }
+
+  mpicheck::finalize ();
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
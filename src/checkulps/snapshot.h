@@ -0,0 +1,305 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <signal.h>
+
+#include "cxxcompat.h"
+
+//
+// snapshot: partial results of the long running checks, on request.  The
+//           SIGUSR1 handler only bumps a request counter; each checking
+//           thread polls it at its block boundaries and, on a new request,
+//           publishes a copy of its private ULP histogram and worst results.
+//           Once all the threads of the team have published (or finished
+//           their share of the work), the merged histogram, the sample count
+//           and the worst results are written to the snapshot file, or to
+//           stderr.  The results of the blocks already merged by the check
+//           are committed to the snapshot, which adds them to the per-thread
+//           states.  The checking loops do not synchronize per sample.
+//
+
+namespace snapshot
+{
+
+inline std::atomic<unsigned> requests;
+static_assert (std::atomic<unsigned>::is_always_lock_free);
+
+// The snapshot file, stderr if empty.
+inline std::string outputFile;
+
+inline void
+handler (int)
+{
+  requests.fetch_add (1, std::memory_order_relaxed);
+}
+
+inline void
+install (const std::optional<std::string> &file)
+{
+  if (file)
+    outputFile = *file;
+
+  struct sigaction sa = {};
+  sa.sa_handler = handler;
+  sigemptyset (&sa.sa_mask);
+  sa.sa_flags = SA_RESTART;
+  sigaction (SIGUSR1, &sa, nullptr);
+}
+
+//
+// WorstResults: per-thread formatted results with the largest ULP error.
+//
+
+class WorstResults
+{
+  static constexpr std::size_t kMaxWorst = 8;
+
+  typedef std::pair<double, std::string> Entry;
+
+  static bool
+  compare (const Entry &a, const Entry &b)
+  {
+    return a.first > b.first;
+  }
+
+  // Min-heap on the ULP error, the front is the smallest worst case.
+  std::vector<Entry> worst;
+
+  void
+  push (double ulp, std::string str)
+  {
+    worst.emplace_back (ulp, std::move (str));
+    std::push_heap (worst.begin (), worst.end (), compare);
+    if (worst.size () > kMaxWorst)
+      {
+	std::pop_heap (worst.begin (), worst.end (), compare);
+	worst.pop_back ();
+      }
+  }
+
+public:
+  // Whether a result with error ULP would be kept; exact results are not.
+  bool
+  wants (double ulp) const
+  {
+    return ulp > 0.0
+	   && (worst.size () < kMaxWorst || ulp > worst.front ().first);
+  }
+
+  template <typename RET>
+  void
+  add (const RET &ret)
+  {
+    if (wants (ret.ulp))
+      push (ret.ulp, std::format ("{}", ret));
+  }
+
+  // Add a result formatted by another process.
+  void
+  add (double ulp, std::string str)
+  {
+    if (wants (ulp))
+      push (ulp, std::move (str));
+  }
+
+  void
+  merge (const WorstResults &other)
+  {
+    for (const auto &w : other.worst)
+      if (wants (w.first))
+	push (w.first, w.second);
+  }
+
+  // The results, largest error first.
+  std::vector<Entry>
+  sorted () const
+  {
+    std::vector<Entry> ret (worst);
+    std::sort (ret.begin (), ret.end (), compare);
+    return ret;
+  }
+};
+
+//
+// Snapshot: the published per-thread state of one check (a function and
+//           rounding mode).
+//
+
+template <typename F> class Snapshot
+{
+  typedef std::map<F, std::uint64_t> Histogram;
+
+  struct Slot
+  {
+    Histogram ulps;
+    WorstResults worst;
+    unsigned generation = 0;
+    bool done = false;
+  };
+
+  const std::string title;
+  const std::chrono::steady_clock::time_point start;
+  std::mutex lock;
+  std::vector<Slot> slots;
+  // The results of the blocks finished so far.
+  Histogram baseUlps;
+  WorstResults baseWorst;
+  unsigned written;
+
+  // Write the snapshot if all the threads have published for the last
+  // request.  Called with the lock held.
+  void
+  complete ()
+  {
+    const unsigned generation = requests.load (std::memory_order_relaxed);
+    if (generation == written)
+      return;
+    for (const auto &s : slots)
+      if (!s.done && s.generation != generation)
+	return;
+    written = generation;
+
+    Histogram ulps = baseUlps;
+    WorstResults worst = baseWorst;
+    std::uint64_t count = 0;
+    for (const auto &[ulp, n] : baseUlps)
+      count += n;
+    for (const auto &s : slots)
+      {
+	for (const auto &[ulp, n] : s.ulps)
+	  {
+	    ulps[ulp] += n;
+	    count += n;
+	  }
+	worst.merge (s.worst);
+      }
+
+    const auto now = std::chrono::system_clock::now ();
+    const std::chrono::duration<double> elapsed
+	= std::chrono::steady_clock::now () - start;
+    std::string out = std::format (
+	"[{:%Y-%m-%d %H:%M:%S}] Snapshot {}, count {}, elapsed {:.1f}s\n",
+	std::chrono::floor<std::chrono::seconds> (now), title, count,
+	elapsed.count ());
+    for (const auto &[ulp, n] : ulps)
+      out += std::format ("    {:g}: {:16} {:6.2f}%\n", ulp, n,
+			  (double) n / (double) count * 100.0);
+    for (const auto &[ulp, str] : worst.sorted ())
+      out += std::format ("    worst: {}\n", str);
+
+    if (outputFile.empty ())
+      {
+	std::cerr << out << std::flush;
+	return;
+      }
+    // Replace the file atomically, so it can be polled.
+    const std::string tmp = outputFile + ".tmp";
+    std::ofstream f (tmp, std::ios::trunc);
+    f << out;
+    f.close ();
+    if (!f || std::rename (tmp.c_str (), outputFile.c_str ()) != 0)
+      std::cerr << "warning: failed to write snapshot " << outputFile
+		<< '\n';
+  }
+
+  void
+  store (int thread, int threads, unsigned generation, bool done,
+	 Histogram &&ulps, const WorstResults &worst)
+  {
+    std::lock_guard<std::mutex> guard (lock);
+    if (slots.size () != static_cast<std::size_t> (threads))
+      slots.resize (threads);
+    Slot &s = slots[thread];
+    s.ulps = std::move (ulps);
+    s.worst = worst;
+    s.generation = generation;
+    s.done = done;
+    complete ();
+  }
+
+public:
+  explicit Snapshot (std::string t)
+      : title (std::move (t)), start (std::chrono::steady_clock::now ()),
+	written (requests.load (std::memory_order_relaxed))
+  {
+  }
+
+  // Set the results of the blocks finished so far, as merged by the check;
+  // the per-thread states they include are dropped.  Called outside the
+  // parallel region.
+  void
+  commit (const Histogram &ulps, const WorstResults &worst)
+  {
+    std::lock_guard<std::mutex> guard (lock);
+    baseUlps = ulps;
+    baseWorst = worst;
+    slots.clear ();
+    complete ();
+  }
+
+  //
+  // Thread: the handle of a checking thread, created in the parallel
+  //         region.
+  //
+
+  class Thread
+  {
+    Snapshot &snapshot;
+    const int thread;
+    const int threads;
+    unsigned seen;
+
+  public:
+    Thread (Snapshot &s, int t, int n)
+	: snapshot (s), thread (t), threads (n),
+	  seen (requests.load (std::memory_order_relaxed))
+    {
+    }
+
+    // Whether a snapshot was requested since the last publish.
+    bool
+    requested () const
+    {
+      return requests.load (std::memory_order_relaxed) != seen;
+    }
+
+    void
+    publish (Histogram ulps, const WorstResults &worst)
+    {
+      seen = requests.load (std::memory_order_relaxed);
+      snapshot.store (thread, threads, seen, false, std::move (ulps), worst);
+    }
+
+    // Publish the final state of the thread, which does not need to answer
+    // the later requests.
+    void
+    finish (Histogram ulps, const WorstResults &worst)
+    {
+      snapshot.store (thread, threads, seen, true, std::move (ulps), worst);
+    }
+  };
+};
+
+} // namespace snapshot
+
+#endif
@@ -0,0 +1,225 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _ULPSEARCH_H
+#define _ULPSEARCH_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "floatranges.h"
+
+//
+// Helpers for the checkulps error-maximizing search: the inputs are handled
+// as ordered integers (so neighbouring floating point numbers are
+// neighbouring integers) and the search keeps a small population of the
+// inputs with the largest ULP error found so far, which are perturbed to
+// climb towards the local maxima.
+//
+
+namespace ulpsearch
+{
+
+// Map a floating point number to an integer with the same ordering, where
+// the distance between two numbers is the number of representable values
+// between them (-0.0 and +0.0 both map to 0).
+template <typename F> struct Ordered
+{
+  typedef floatrange::Limits<F> Limits;
+  typedef decltype (Limits::to (F ())) UInt;
+
+  static constexpr UInt kSignBit = UInt (1)
+				   << (std::numeric_limits<UInt>::digits - 1);
+
+  static std::int64_t
+  to (F x)
+  {
+    UInt u = Limits::to (x);
+    if (u & kSignBit)
+      return -static_cast<std::int64_t> (u & ~kSignBit);
+    return static_cast<std::int64_t> (u);
+  }
+
+  static F
+  from (std::int64_t o)
+  {
+    if (o < 0)
+      return Limits::from (kSignBit | static_cast<UInt> (-o));
+    return Limits::from (static_cast<UInt> (o));
+  }
+};
+
+// Search space of a floating point argument in [START, END].  Random inputs
+// are drawn either uniformly on the values (as the random sampling does) or
+// uniformly on the representable numbers, so small binades are also
+// explored.
+template <typename F> class FloatRange
+{
+  std::uniform_real_distribution<F> dist;
+  std::int64_t lo;
+  std::int64_t hi;
+
+public:
+  typedef F ValueType;
+
+  FloatRange (F start, F end)
+      : dist (start, end), lo (Ordered<F>::to (start)),
+	hi (Ordered<F>::to (end))
+  {
+  }
+
+  template <typename GEN>
+  std::int64_t
+  random (GEN &gen) const
+  {
+    if (gen () & 1)
+      {
+	auto d = dist;
+	return std::clamp (Ordered<F>::to (d (gen)), lo, hi);
+      }
+    std::uniform_int_distribution<std::int64_t> bits (lo, hi);
+    return bits (gen);
+  }
+
+  // Move X by a random number of ulps, where the magnitude of the step is
+  // itself random (from a single ulp up to a large fraction of a binade).
+  template <typename GEN>
+  std::int64_t
+  perturb (GEN &gen, std::int64_t x) const
+  {
+    const unsigned k = gen () % std::numeric_limits<F>::digits;
+    const std::int64_t step
+	= 1 + static_cast<std::int64_t> (gen () & ((UINT64_C (1) << k) - 1));
+    const std::int64_t r = (gen () & 1) ? x + step : x - step;
+    return std::clamp (r, lo, hi);
+  }
+
+  static F
+  value (std::int64_t x)
+  {
+    return Ordered<F>::from (x);
+  }
+};
+
+// Search space of an integer argument in [START, END].
+class IntegerRange
+{
+  std::int64_t lo;
+  std::int64_t hi;
+
+public:
+  typedef long long int ValueType;
+
+  IntegerRange (long long int start, long long int end) : lo (start), hi (end)
+  {
+  }
+
+  template <typename GEN>
+  std::int64_t
+  random (GEN &gen) const
+  {
+    std::uniform_int_distribution<std::int64_t> dist (lo, hi);
+    return dist (gen);
+  }
+
+  template <typename GEN>
+  std::int64_t
+  perturb (GEN &gen, std::int64_t x) const
+  {
+    const std::int64_t step = 1 + static_cast<std::int64_t> (gen () % 8);
+    const std::int64_t r = (gen () & 1) ? x + step : x - step;
+    return std::clamp (r, lo, hi);
+  }
+
+  static long long int
+  value (std::int64_t x)
+  {
+    return x;
+  }
+};
+
+// Placeholder for the second argument of single argument functions.
+struct NoRange
+{
+  template <typename GEN>
+  std::int64_t
+  random (GEN &) const
+  {
+    return 0;
+  }
+
+  template <typename GEN>
+  std::int64_t
+  perturb (GEN &, std::int64_t x) const
+  {
+    return x;
+  }
+};
+
+struct Candidate
+{
+  std::int64_t x;
+  std::int64_t y;
+  double ulp;
+};
+
+//
+// Population: the N candidates with the largest ULP error, sorted in
+//             decreasing order.  Duplicated inputs are kept only once.
+//
+
+class Population
+{
+  std::size_t size;
+  std::vector<Candidate> best;
+
+public:
+  explicit Population (std::size_t n) : size (n) { best.reserve (n + 1); }
+
+  bool
+  add (const Candidate &c)
+  {
+    if (best.size () == size && c.ulp <= best.back ().ulp)
+      return false;
+    for (const auto &b : best)
+      if (b.x == c.x && b.y == c.y)
+	return false;
+
+    auto it = std::upper_bound (
+	best.begin (), best.end (), c,
+	[] (const Candidate &a, const Candidate &b) { return a.ulp > b.ulp; });
+    best.insert (it, c);
+    if (best.size () > size)
+      best.pop_back ();
+    return true;
+  }
+
+  void
+  merge (const Population &other)
+  {
+    for (const auto &c : other.best)
+      add (c);
+  }
+
+  const std::vector<Candidate> &
+  candidates () const
+  {
+    return best;
+  }
+
+  double
+  max () const
+  {
+    return best.empty () ? 0.0 : best.front ().ulp;
+  }
+};
+
+} // namespace ulpsearch
+
+#endif
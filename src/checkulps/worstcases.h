@@ -0,0 +1,102 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _WORSTCASES_H
+#define _WORSTCASES_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "libmtest.h"
+
+//
+// worstcases: reader of the CORE-MATH worst case files (<function>.wc), the
+//             hardest to round inputs of each function.  Each line holds one
+//             input, or two for the bivariate functions (separated by a comma
+//             or blanks), in hexadecimal or decimal; the text after a '#' is
+//             a comment.
+//
+
+namespace worstcases
+{
+
+static constexpr std::string_view kExtension = ".wc";
+
+// The worst case files of PATH: either PATH itself or the *.wc files below
+// it, if it is a directory (the CORE-MATH src directory, for instance).
+inline std::vector<std::string>
+files (const std::string &path)
+{
+  std::vector<std::string> ret;
+  std::error_code ec;
+  if (!std::filesystem::is_directory (path, ec))
+    ret.push_back (path);
+  else
+    for (const auto &e :
+	 std::filesystem::recursive_directory_iterator (path, ec))
+      if (e.is_regular_file () && e.path ().extension () == kExtension)
+	ret.push_back (e.path ().string ());
+  std::sort (ret.begin (), ret.end ());
+  return ret;
+}
+
+// The function of the worst case file, from its name (expf.wc for expf).
+inline std::string
+functionName (const std::string &file)
+{
+  return std::filesystem::path (file).stem ().string ();
+}
+
+// Read the inputs of FILENAME, with Y the type of the second argument, if
+// any (NARGS is 1 or 2).
+template <typename F, typename Y>
+inline std::expected<std::vector<std::pair<F, Y> >, std::string>
+read (const std::string &fileName, std::size_t nargs)
+{
+  std::ifstream in (fileName);
+  if (!in)
+    return std::unexpected (
+	std::format ("{}: {}", fileName, std::strerror (errno)));
+
+  std::vector<std::pair<F, Y> > ret;
+  std::string line;
+  for (unsigned lineno = 1; std::getline (in, line); lineno++)
+    {
+      if (auto comment = line.find ('#'); comment != std::string::npos)
+	line.erase (comment);
+      std::replace (line.begin (), line.end (), ',', ' ');
+      std::replace (line.begin (), line.end (), '\t', ' ');
+      auto fields = libmtest::splitFields (line);
+      if (fields.empty ())
+	continue;
+      if (fields.size () != nargs)
+	return std::unexpected (std::format (
+	    "{}:{}: expected {} input(s)", fileName, lineno, nargs));
+
+      auto x = libmtest::parseValue<F> (fields[0]);
+      auto y = nargs > 1 ? libmtest::parseValue<Y> (fields[1])
+			 : std::optional<Y> (Y ());
+      if (!x || !y)
+	return std::unexpected (
+	    std::format ("{}:{}: invalid input", fileName, lineno));
+      ret.emplace_back (*x, *y);
+    }
+  return ret;
+}
+
+} // namespace worstcases
+
+#endif
@@ -0,0 +1,358 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _ARGTRACE_H
+#define _ARGTRACE_H
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// argtrace: libm arguments captured from applications by the argcapture
+//           preload library, read by checkinputs, randfloatgen and checkulps
+//           list mode.
+//
+//           The file is a fixed header followed by blocks of records of a
+//           single function, in host byte order:
+//
+//             Header { char magic[8]; uint32_t version; uint32_t reserved; }
+//             Block  { char function[32]; uint32_t type; uint32_t count;
+//                      uint8_t records[count * recordSize (type)]; }
+//
+//           Each record is the raw argument bit patterns, packed (for
+//           instance a F32_LLI record is the 4 bytes of the float followed
+//           by the 8 bytes of the long long).
+//
+
+namespace argtrace
+{
+
+static constexpr char kMagic[8] = { 'C', 'M', 'A', 'R', 'G', 'T', 'R', 0 };
+static constexpr std::uint32_t kVersion = 1;
+
+enum ArgType : std::uint32_t
+{
+  F32 = 0,
+  F64 = 1,
+  F32_F32 = 2,
+  F64_F64 = 3,
+  F32_LLI = 4,
+  F64_LLI = 5,
+};
+
+struct Header
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t reserved;
+};
+
+struct BlockHeader
+{
+  char function[32];
+  std::uint32_t type;
+  std::uint32_t count;
+};
+
+// Size of the first and second (0 if there is none) arguments.
+constexpr std::pair<std::size_t, std::size_t>
+argSizes (std::uint32_t type)
+{
+  switch (type)
+    {
+    case F32:
+      return { 4, 0 };
+    case F64:
+      return { 8, 0 };
+    case F32_F32:
+      return { 4, 4 };
+    case F64_F64:
+      return { 8, 8 };
+    case F32_LLI:
+      return { 4, 8 };
+    case F64_LLI:
+      return { 8, 8 };
+    default:
+      return { 0, 0 };
+    }
+}
+
+constexpr std::size_t
+recordSize (std::uint32_t type)
+{
+  auto [a, b] = argSizes (type);
+  return a + b;
+}
+
+inline Header
+makeHeader ()
+{
+  Header h{};
+  std::memcpy (h.magic, kMagic, sizeof (h.magic));
+  h.version = kVersion;
+  return h;
+}
+
+// The argument bit patterns of a record.
+struct Args
+{
+  std::uint64_t x;
+  std::uint64_t y;
+
+  template <typename F>
+  F
+  first () const
+  {
+    if constexpr (sizeof (F) == sizeof (std::uint32_t))
+      return std::bit_cast<F> (static_cast<std::uint32_t> (x));
+    else
+      return std::bit_cast<F> (x);
+  }
+
+  template <typename F>
+  F
+  second () const
+  {
+    if constexpr (sizeof (F) == sizeof (std::uint32_t))
+      return std::bit_cast<F> (static_cast<std::uint32_t> (y));
+    else
+      return std::bit_cast<F> (y);
+  }
+};
+
+//
+// Reader: memory maps an argument trace and indexes its blocks.
+//
+
+class Reader
+{
+public:
+  struct Block
+  {
+    std::string_view function;
+    std::uint32_t type;
+    std::uint32_t count;
+    const std::uint8_t *records;
+
+    Args
+    operator[] (std::size_t i) const
+    {
+      auto [a, b] = argSizes (type);
+      const std::uint8_t *p = records + i * (a + b);
+      Args r{};
+      if (a == 4)
+	{
+	  std::uint32_t v;
+	  std::memcpy (&v, p, 4);
+	  r.x = v;
+	}
+      else
+	std::memcpy (&r.x, p, 8);
+      if (b == 4)
+	{
+	  std::uint32_t v;
+	  std::memcpy (&v, p + a, 4);
+	  r.y = v;
+	}
+      else if (b == 8)
+	std::memcpy (&r.y, p + a, 8);
+      return r;
+    }
+  };
+
+private:
+  const std::uint8_t *map = nullptr;
+  std::size_t mapSize = 0;
+  std::vector<Block> blockList;
+
+  Reader () = default;
+
+public:
+  static std::expected<Reader, std::string>
+  open (const std::string &fileName)
+  {
+    int fd = ::open (fileName.c_str (), O_RDONLY);
+    if (fd == -1)
+      return std::unexpected (
+	  std::format ("{}: {}", fileName, std::strerror (errno)));
+
+    struct stat st;
+    if (fstat (fd, &st) == -1)
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: {}", fileName, std::strerror (errno)));
+      }
+    if (static_cast<std::size_t> (st.st_size) < sizeof (Header))
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: truncated argument trace header", fileName));
+      }
+
+    void *m = mmap (nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close (fd);
+    if (m == MAP_FAILED)
+      return std::unexpected (
+	  std::format ("{}: mmap: {}", fileName, std::strerror (errno)));
+
+    Reader r;
+    r.map = static_cast<const std::uint8_t *> (m);
+    r.mapSize = st.st_size;
+
+    Header h;
+    std::memcpy (&h, r.map, sizeof (h));
+    if (std::memcmp (h.magic, kMagic, sizeof (kMagic)) != 0)
+      return std::unexpected (
+	  std::format ("{}: invalid argument trace", fileName));
+    if (h.version != kVersion)
+      return std::unexpected (std::format (
+	  "{}: unsupported argument trace version {}", fileName, h.version));
+
+    std::size_t off = sizeof (Header);
+    while (off + sizeof (BlockHeader) <= r.mapSize)
+      {
+	// The records are packed, so the blocks might not be aligned.
+	const char *function = reinterpret_cast<const char *> (r.map + off);
+	BlockHeader bh;
+	std::memcpy (&bh, r.map + off, sizeof (bh));
+	off += sizeof (BlockHeader);
+	const std::size_t size
+	    = static_cast<std::size_t> (bh.count) * recordSize (bh.type);
+	if (recordSize (bh.type) == 0 || off + size > r.mapSize)
+	  return std::unexpected (
+	      std::format ("{}: truncated argument trace block", fileName));
+	r.blockList.push_back (Block{
+	    std::string_view (function,
+			      strnlen (function, sizeof (bh.function))),
+	    bh.type, bh.count, r.map + off });
+	off += size;
+      }
+
+    return r;
+  }
+
+  Reader (Reader &&other) noexcept
+      : map (other.map), mapSize (other.mapSize),
+	blockList (std::move (other.blockList))
+  {
+    other.map = nullptr;
+  }
+
+  Reader (const Reader &) = delete;
+  Reader &operator= (const Reader &) = delete;
+
+  ~Reader ()
+  {
+    if (map != nullptr)
+      munmap (const_cast<std::uint8_t *> (map), mapSize);
+  }
+
+  const std::vector<Block> &
+  blocks () const
+  {
+    return blockList;
+  }
+
+  // Append all the arguments of FUNCTION to OUT and return its type, or -1
+  // if the trace has no record for it.
+  int
+  arguments (std::string_view function, std::vector<Args> &out) const
+  {
+    int type = -1;
+    for (const auto &b : blockList)
+      {
+	if (b.function != function)
+	  continue;
+	type = b.type;
+	for (std::uint32_t i = 0; i < b.count; i++)
+	  out.push_back (b[i]);
+      }
+    return type;
+  }
+};
+
+// The trace files of PATH: either PATH itself or the .argtrace files in it,
+// if it is a directory (as written by argcapture).
+inline std::vector<std::string>
+traceFiles (const std::string &path)
+{
+  std::vector<std::string> ret;
+  std::error_code ec;
+  if (!std::filesystem::is_directory (path, ec))
+    ret.push_back (path);
+  else
+    for (const auto &e : std::filesystem::directory_iterator (path, ec))
+      if (e.path ().extension () == ".argtrace")
+	ret.push_back (e.path ().string ());
+  std::sort (ret.begin (), ret.end ());
+  return ret;
+}
+
+// Read all the arguments of FUNCTION from the traces of PATH (see
+// traceFiles), and return its type.
+inline std::expected<std::uint32_t, std::string>
+readArguments (const std::string &path, std::string_view function,
+	       std::vector<Args> &args)
+{
+  int type = -1;
+  for (const auto &fileName : traceFiles (path))
+    {
+      auto reader = Reader::open (fileName);
+      if (!reader)
+	return std::unexpected (reader.error ());
+      int t = reader->arguments (function, args);
+      if (t != -1 && type != -1 && t != type)
+	return std::unexpected (std::format (
+	    "{}: inconsistent argument types for {}", fileName, function));
+      if (t != -1)
+	type = t;
+    }
+  if (type == -1)
+    return std::unexpected (
+	std::format ("{}: no arguments for {}", path, function));
+  return type;
+}
+
+// Read the first argument of FUNCTION from the traces of PATH, which should
+// be of type F.
+template <typename F>
+inline std::expected<std::vector<F>, std::string>
+readFirstArguments (const std::string &path, std::string_view function)
+{
+  std::vector<Args> args;
+  auto type = readArguments (path, function, args);
+  if (!type)
+    return std::unexpected (type.error ());
+  if (argSizes (type.value ()).first != sizeof (F))
+    return std::unexpected (
+	std::format ("{}: invalid argument type for {}", path, function));
+
+  std::vector<F> ret;
+  ret.reserve (args.size ());
+  for (const auto &a : args)
+    ret.push_back (a.first<F> ());
+  return ret;
+}
+
+} // namespace argtrace
+
+#endif
@@ -0,0 +1,543 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _DISTRIBUTION_H
+#define _DISTRIBUTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <numbers>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "floatranges.h"
+#include "strhelper.h"
+
+//
+// distribution: input distributions over an argument range [START, END],
+//               shared by randfloatgen and the checkulps samples.
+//
+//               Each distribution maps a 64-bit fixed point number U in
+//               [0, 1) to the range, so the same code serves pseudo-random
+//               draws and low-discrepancy sequences (see lowdiscrepancy.h).
+//               The distributions are:
+//
+//                 uniform          uniform on the values.
+//                 log-uniform      uniform on log |x|, from the smallest
+//                                  subnormal, with each sign weighted by
+//                                  its logarithmic extent.
+//                 bits             uniform on the representable numbers, so
+//                                  each binade is weighted by its number of
+//                                  floating point numbers.
+//                 binade           the same number of points on each power
+//                                  of two interval (including the ones of
+//                                  the subnormal range), uniform on the
+//                                  values inside it.
+//                 normal:MU:SIGMA  normal, truncated to the range.
+//                 lognormal:MU:SIGMA
+//                                  exp of normal(MU, SIGMA), truncated to
+//                                  the positive part of the range (or
+//                                  mirrored if the range is negative).
+//
+//               and mixtures of them, as W1*DIST1+W2*DIST2+... (a missing
+//               weight is 1).
+//
+
+namespace distribution
+{
+
+// High 64 bits of the 128-bit product A * B.
+static constexpr std::uint64_t
+mulHigh (std::uint64_t a, std::uint64_t b)
+{
+  const std::uint64_t alo = a & 0xffffffff, ahi = a >> 32;
+  const std::uint64_t blo = b & 0xffffffff, bhi = b >> 32;
+  const std::uint64_t ll = alo * blo;
+  const std::uint64_t lh = alo * bhi;
+  const std::uint64_t hl = ahi * blo;
+  const std::uint64_t hh = ahi * bhi;
+  const std::uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+  return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
+// U as a double in [0, 1).
+inline double
+toUnit (std::uint64_t u)
+{
+  return static_cast<double> (u >> 11) * 0x1p-53;
+}
+
+inline std::uint64_t
+fromUnit (double t)
+{
+  t = std::clamp (t, 0.0, 0x1.fffffffffffffp-1);
+  return static_cast<std::uint64_t> (t * 0x1p64);
+}
+
+// Sign-magnitude bit patterns as ordered integers, so the floating point
+// numbers in a range are a contiguous integer range.
+template <typename F>
+inline std::int64_t
+toOrdered (F x)
+{
+  typedef floatrange::Limits<F> Limits;
+  typedef decltype (Limits::to (F ())) UInt;
+  constexpr UInt kSignBit = UInt (1)
+			    << (std::numeric_limits<UInt>::digits - 1);
+  const UInt u = Limits::to (x);
+  if (u & kSignBit)
+    return -static_cast<std::int64_t> (u & ~kSignBit);
+  return static_cast<std::int64_t> (u);
+}
+
+template <typename F>
+inline F
+fromOrdered (std::int64_t o)
+{
+  typedef floatrange::Limits<F> Limits;
+  typedef decltype (Limits::to (F ())) UInt;
+  constexpr UInt kSignBit = UInt (1)
+			    << (std::numeric_limits<UInt>::digits - 1);
+  if (o < 0)
+    return Limits::from (kSignBit | static_cast<UInt> (-o));
+  return Limits::from (static_cast<UInt> (o));
+}
+
+// Map the fixed point U to [START, END] uniformly on the values.
+template <typename F>
+inline F
+mapUniform (std::uint64_t u, F start, F end)
+{
+  // For binary32 the interpolation is done in binary64, and the form below
+  // does not overflow for ranges like [-max, max].
+  typedef std::conditional_t<sizeof (F) < sizeof (double), double, F> T;
+  const T t = static_cast<T> (u >> 11) * static_cast<T> (0x1p-53);
+  const T r = static_cast<T> (start) * (1 - t) + static_cast<T> (end) * t;
+  return std::clamp (static_cast<F> (r), start, end);
+}
+
+// Map the fixed point U to [START, END] uniformly on the representable
+// numbers, so each binade gets a number of points proportional to its
+// number of floating point numbers instead of its length.
+template <typename F>
+inline F
+mapBits (std::uint64_t u, F start, F end)
+{
+  const std::int64_t lo = toOrdered (start);
+  const std::uint64_t n
+      = static_cast<std::uint64_t> (toOrdered (end)) - lo + 1;
+  // N wraps to 0 only when the range covers all the 2^64 patterns.
+  const std::uint64_t off = n == 0 ? u : mulHigh (u, n);
+  return fromOrdered<F> (static_cast<std::int64_t> (lo + off));
+}
+
+// Inverse of the standard normal CDF (P. J. Acklam's rational
+// approximation, with one step of Halley's method).
+inline double
+normalQuantile (double p)
+{
+  static constexpr double a[]
+      = { -3.969683028665376e+01, 2.209460984245205e+02,
+	  -2.759285104469687e+02, 1.383577518672690e+02,
+	  -3.066479806614716e+01, 2.506628277459239e+00 };
+  static constexpr double b[]
+      = { -5.447609879822406e+01, 1.615858368580409e+02,
+	  -1.556989798598866e+02, 6.680131188771972e+01,
+	  -1.328068155288572e+01 };
+  static constexpr double c[]
+      = { -7.784894002430293e-03, -3.223964580411365e-01,
+	  -2.400758277161838e+00, -2.549732539343734e+00,
+	  4.374664141464968e+00,  2.938163982698783e+00 };
+  static constexpr double d[]
+      = { 7.784695709041462e-03, 3.224671290700398e-01,
+	  2.445134137142996e+00, 3.754408661907416e+00 };
+  static constexpr double kLow = 0.02425;
+
+  if (p <= 0.0)
+    return -std::numeric_limits<double>::infinity ();
+  if (p >= 1.0)
+    return std::numeric_limits<double>::infinity ();
+
+  double x;
+  if (p < kLow || p > 1.0 - kLow)
+    {
+      const double q = std::sqrt (-2.0 * std::log (p < kLow ? p : 1.0 - p));
+      x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q
+	   + c[5])
+	  / ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+      if (p > 1.0 - kLow)
+	x = -x;
+    }
+  else
+    {
+      const double q = p - 0.5;
+      const double r = q * q;
+      x = (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r
+	   + a[5])
+	  * q
+	  / (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r
+	     + 1.0);
+    }
+
+  const double e = 0.5 * std::erfc (-x / std::sqrt (2.0)) - p;
+  const double u
+      = e * std::sqrt (2.0 * std::numbers::pi) * std::exp (x * x / 2.0);
+  return x - u / (1.0 + x * u / 2.0);
+}
+
+inline double
+normalCdf (double x)
+{
+  return 0.5 * std::erfc (-x / std::sqrt (2.0));
+}
+
+enum class Kind
+{
+  UNIFORM,
+  LOG_UNIFORM,
+  BITS,
+  BINADE,
+  NORMAL,
+  LOGNORMAL
+};
+
+struct Component
+{
+  Kind kind;
+  double weight;
+  double mu;
+  double sigma;
+};
+
+//
+// Spec: a parsed distribution (a single component for the plain ones).
+//
+
+struct Spec
+{
+  std::vector<Component> components = { { Kind::UNIFORM, 1.0, 0.0, 1.0 } };
+  std::string name = "uniform";
+
+  bool
+  isUniform () const
+  {
+    return components.size () == 1 && components[0].kind == Kind::UNIFORM;
+  }
+
+  static std::expected<Spec, std::string>
+  parse (std::string_view str)
+  {
+    Spec spec;
+    spec.name = strhelper::trim (std::string (str));
+    spec.components.clear ();
+
+    for (const auto &term : strhelper::splitWithRanges (spec.name, "+"))
+      {
+	std::string s (strhelper::trim (std::string (term)));
+	Component c{ Kind::UNIFORM, 1.0, 0.0, 1.0 };
+
+	if (auto star = s.find ('*'); star != std::string::npos)
+	  {
+	    auto w = floatrange::fromStr<double> (
+		std::string (strhelper::trim (s.substr (0, star))));
+	    if (!w || !(w.value () > 0.0) || !std::isfinite (w.value ()))
+	      return std::unexpected (
+		  std::format ("invalid distribution weight: {}", term));
+	    c.weight = w.value ();
+	    s = strhelper::trim (s.substr (star + 1));
+	  }
+
+	auto fields = strhelper::splitWithRanges (s, ":");
+	if (fields.empty ())
+	  return std::unexpected (
+	      std::format ("invalid distribution: {}", str));
+	const std::string_view kind = fields[0];
+	std::size_t nparams = 0;
+	if (kind == "uniform")
+	  c.kind = Kind::UNIFORM;
+	else if (kind == "log-uniform")
+	  c.kind = Kind::LOG_UNIFORM;
+	else if (kind == "bits")
+	  c.kind = Kind::BITS;
+	else if (kind == "binade")
+	  c.kind = Kind::BINADE;
+	else if (kind == "normal" || kind == "lognormal")
+	  {
+	    c.kind = kind == "normal" ? Kind::NORMAL : Kind::LOGNORMAL;
+	    nparams = 2;
+	  }
+	else
+	  return std::unexpected (
+	      std::format ("invalid distribution: {}", kind));
+
+	if (fields.size () != nparams + 1)
+	  return std::unexpected (std::format (
+	      "distribution {} expects {} parameters", kind, nparams));
+	if (nparams == 2)
+	  {
+	    auto mu = floatrange::fromStr<double> (std::string (fields[1]));
+	    auto sigma = floatrange::fromStr<double> (std::string (fields[2]));
+	    if (!mu || !sigma || !(sigma.value () > 0.0))
+	      return std::unexpected (
+		  std::format ("invalid {} parameters: {}", kind, s));
+	    c.mu = mu.value ();
+	    c.sigma = sigma.value ();
+	  }
+
+	spec.components.push_back (c);
+      }
+
+    return spec;
+  }
+};
+
+//
+// Distribution: a Spec bound to an argument range, with the per range
+//               constants precomputed.
+//
+
+template <typename F> class Distribution
+{
+  struct Part
+  {
+    Component c;
+    // Cumulative weight, as a 64-bit fixed point upper bound.
+    std::uint64_t upper;
+    // LOG_UNIFORM and BINADE: the negative and positive magnitude ranges,
+    // and the weight of the negative one in [0, 1].
+    F negLo, negHi, posLo, posHi;
+    double negLog[2], posLog[2];
+    int negExp[2], posExp[2];
+    double negWeight;
+    // NORMAL and LOGNORMAL: the CDF at the (transformed) range limits.
+    double cdfLo, cdfHi;
+    bool mirrored;
+  };
+
+  F start;
+  F end;
+  std::vector<Part> parts;
+
+  static constexpr F kTiny = std::numeric_limits<F>::denorm_min ();
+
+public:
+  Distribution (const Spec &spec, F s, F e) : start (s), end (e)
+  {
+    double total = 0.0;
+    for (const auto &c : spec.components)
+      total += c.weight;
+
+    double cum = 0.0;
+    for (const auto &c : spec.components)
+      {
+	cum += c.weight;
+	Part p = setup (c);
+	p.upper = cum >= total ? UINT64_MAX : fromUnit (cum / total);
+	parts.push_back (p);
+      }
+  }
+
+  F
+  operator() (std::uint64_t u) const
+  {
+    if (parts.size () == 1)
+      return map (parts[0], u);
+
+    std::size_t i = 0;
+    while (i + 1 < parts.size () && u >= parts[i].upper)
+      i++;
+    // Rescale U to [0, 1) inside the selected component.
+    const std::uint64_t lo = i == 0 ? 0 : parts[i - 1].upper;
+    const double t = static_cast<double> (u - lo)
+		     / static_cast<double> (parts[i].upper - lo);
+    return map (parts[i], fromUnit (t));
+  }
+
+  // Map the N fixed point numbers of U to OUT.  The common single
+  // component uniform case is a branch-free loop, so it is vectorized.
+  void
+  mapBlock (const std::uint64_t *__restrict u, F *__restrict out,
+	    std::size_t n) const
+  {
+    if (parts.size () == 1 && parts[0].c.kind == Kind::UNIFORM)
+      {
+	const F s = start, e = end;
+#pragma omp simd
+	for (std::size_t i = 0; i < n; i++)
+	  out[i] = mapUniform (u[i], s, e);
+	return;
+      }
+    for (std::size_t i = 0; i < n; i++)
+      out[i] = (*this) (u[i]);
+  }
+
+  // Fill OUT with N numbers drawn with the generator RNG.
+  template <typename RNG>
+  void
+  fill (RNG &rng, F *out, std::size_t n) const
+  {
+    static constexpr std::size_t kBlock = 256;
+    std::uint64_t u[kBlock];
+    for (std::size_t b = 0; b < n; b += kBlock)
+      {
+	const std::size_t m = std::min (kBlock, n - b);
+	for (std::size_t i = 0; i < m; i++)
+	  u[i] = rng ();
+	mapBlock (u, out + b, m);
+      }
+  }
+
+private:
+  // Logarithmic extent of the magnitudes [LO, HI], or 0 if empty.
+  static void
+  magnitudes (F lo, F hi, F &mlo, F &mhi, double log[2], int exp[2])
+  {
+    mlo = std::max (lo, kTiny);
+    mhi = hi;
+    if (mhi < mlo)
+      {
+	log[0] = log[1] = 0.0;
+	exp[0] = 0;
+	exp[1] = -1;
+	return;
+      }
+    log[0] = std::log (static_cast<double> (mlo));
+    log[1] = std::log (static_cast<double> (mhi));
+    exp[0] = std::ilogb (mlo);
+    exp[1] = std::ilogb (mhi);
+  }
+
+  Part
+  setup (const Component &c) const
+  {
+    Part p{};
+    p.c = c;
+
+    magnitudes (start < 0 ? std::max (-end, F (0)) : F (0),
+		start < 0 ? -start : F (0), p.negLo, p.negHi, p.negLog,
+		p.negExp);
+    magnitudes (std::max (start, F (0)), end, p.posLo, p.posHi, p.posLog,
+		p.posExp);
+
+    if (c.kind == Kind::LOG_UNIFORM)
+      {
+	const double neg = p.negLog[1] - p.negLog[0];
+	const double pos = p.posLog[1] - p.posLog[0];
+	p.negWeight = neg + pos > 0.0 ? neg / (neg + pos) : 0.0;
+      }
+    else if (c.kind == Kind::BINADE)
+      {
+	const double neg = p.negExp[1] - p.negExp[0] + 1;
+	const double pos = p.posExp[1] - p.posExp[0] + 1;
+	p.negWeight = neg + pos > 0.0 ? neg / (neg + pos) : 0.0;
+      }
+    else if (c.kind == Kind::NORMAL)
+      {
+	p.cdfLo = normalCdf ((start - c.mu) / c.sigma);
+	p.cdfHi = normalCdf ((end - c.mu) / c.sigma);
+      }
+    else if (c.kind == Kind::LOGNORMAL)
+      {
+	p.mirrored = end <= 0;
+	const double lo = p.mirrored ? p.negLog[0] : p.posLog[0];
+	const double hi = p.mirrored ? p.negLog[1] : p.posLog[1];
+	const bool empty = p.mirrored ? p.negExp[1] < p.negExp[0]
+				      : p.posExp[1] < p.posExp[0];
+	p.cdfLo = empty ? 0.0 : normalCdf ((lo - c.mu) / c.sigma);
+	p.cdfHi = empty ? 0.0 : normalCdf ((hi - c.mu) / c.sigma);
+	if (start <= 0 && !p.mirrored)
+	  p.cdfLo = 0.0;
+      }
+    return p;
+  }
+
+  // Pick the negative or the positive side with U, and return U rescaled
+  // to the side.
+  static bool
+  pickSide (const Part &p, std::uint64_t &u)
+  {
+    const double t = toUnit (u);
+    if (t < p.negWeight)
+      {
+	u = fromUnit (t / p.negWeight);
+	return true;
+      }
+    u = fromUnit ((t - p.negWeight) / (1.0 - p.negWeight));
+    return false;
+  }
+
+  F
+  clamp (double x) const
+  {
+    if (std::isnan (x))
+      return start;
+    return std::clamp (static_cast<F> (x), start, end);
+  }
+
+  F
+  map (const Part &p, std::uint64_t u) const
+  {
+    switch (p.c.kind)
+      {
+      case Kind::UNIFORM:
+	return mapUniform (u, start, end);
+      case Kind::BITS:
+	return mapBits (u, start, end);
+      case Kind::LOG_UNIFORM:
+	{
+	  if (p.negWeight == 0.0 && p.posLog[1] == p.posLog[0])
+	    return mapUniform (u, start, end);
+	  const bool neg = pickSide (p, u);
+	  const double *l = neg ? p.negLog : p.posLog;
+	  const double m = std::exp (l[0] + toUnit (u) * (l[1] - l[0]));
+	  return clamp (neg ? -m : m);
+	}
+      case Kind::BINADE:
+	{
+	  if (p.negExp[1] < p.negExp[0] && p.posExp[1] < p.posExp[0])
+	    return mapUniform (u, start, end);
+	  const bool neg = pickSide (p, u);
+	  const int *e = neg ? p.negExp : p.posExp;
+	  const std::uint64_t n = e[1] - e[0] + 1;
+	  // The high part of U * N selects the binade, the low part is the
+	  // position inside it.
+	  const int k = e[0] + static_cast<int> (mulHigh (u, n));
+	  const std::uint64_t v = u * n;
+	  const F lo
+	      = std::max (std::ldexp (F (1), k), neg ? p.negLo : p.posLo);
+	  const F hi = std::min (
+	      std::nextafter (std::ldexp (F (1), k + 1), F (0)),
+	      neg ? p.negHi : p.posHi);
+	  return neg ? -mapBits (v, lo, hi) : mapBits (v, lo, hi);
+	}
+      case Kind::NORMAL:
+      case Kind::LOGNORMAL:
+	{
+	  if (!(p.cdfHi > p.cdfLo))
+	    return mapUniform (u, start, end);
+	  const double q
+	      = p.c.mu
+		+ p.c.sigma
+		      * normalQuantile (p.cdfLo
+					+ toUnit (u) * (p.cdfHi - p.cdfLo));
+	  if (p.c.kind == Kind::NORMAL)
+	    return clamp (q);
+	  return clamp (p.mirrored ? -std::exp (q) : std::exp (q));
+	}
+      }
+    return start;
+  }
+};
+
+} // namespace distribution
+
+#endif
@@ -7,11 +7,16 @@
 #ifndef _FLOATRANGES_H
 #define _FLOATRANGES_H
 
+#include <cerrno>
 #include <cstdint>
+#include <cstdlib>
 #include <charconv>
 #include <expected>
 #include <format>
 #include <string>
+#ifdef __STDCPP_FLOAT128_T__
+#include <stdfloat>
+#endif
 
 #include "cxxcompat.h"
 
@@ -85,6 +90,34 @@ fromStr (const std::string &sv)
   return __fromStr<long double, std::stold> (rt);
 }
 
+#ifdef __STDCPP_FLOAT128_T__
+static inline std::float128_t
+__strtof128 (const std::string &s, std::size_t *pos)
+{
+  char *end;
+  errno = 0;
+  std::float128_t r = strtof128 (s.c_str (), &end);
+  if (end == s.c_str ())
+    throw std::invalid_argument (s);
+  if (errno == ERANGE)
+    throw std::out_of_range (s);
+  *pos = end - s.c_str ();
+  return r;
+}
+
+template <>
+inline std::expected<std::float128_t, std::string>
+fromStr (const std::string &sv)
+{
+  std::string rt = sv;
+  if (rt.ends_with ("f128") || rt.ends_with ("F128"))
+    rt.resize (rt.size () - 4);
+  if (rt.starts_with ("\\-"))
+    rt = "-" + rt.substr (2);
+  return __fromStr<std::float128_t, __strtof128> (rt);
+}
+#endif
+
 // Information class used to generate full ranges, mainly for testing
 // all binary32 normal and subnormal numbers.
 template <typename T> struct Limits
@@ -113,6 +146,17 @@ template <> struct Limits<float>
     return r.f;
   }
 
+  static constexpr uint32_t
+  to (float f)
+  {
+    union
+    {
+      float f;
+      uint32_t u;
+    } r = { .f = f };
+    return r.u;
+  }
+
   static constexpr const char name[] = "float";
 };
 
@@ -138,6 +182,17 @@ template <> struct Limits<double>
     return r.f;
   }
 
+  static constexpr uint64_t
+  to (double f)
+  {
+    union
+    {
+      double f;
+      uint64_t u;
+    } r = { .f = f };
+    return r.u;
+  }
+
   static constexpr const char name[] = "double";
 };
 
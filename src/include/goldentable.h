@@ -0,0 +1,337 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _GOLDENTABLE_H
+#define _GOLDENTABLE_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// goldentable: binary32 golden reference tables, the correctly rounded
+//              results of a function for one rounding mode over a range of
+//              input bit patterns.  They are generated by genref and read
+//              by checkulps --golden.
+//
+//              Each file is a header, padded to kDataOffset so the data is
+//              page aligned, followed by END - START result bit patterns
+//              (uint32_t, host byte order), where entry I is the result for
+//              the input bit pattern START + I:
+//
+//                Header { char magic[8]; uint32_t version;
+//                         uint32_t floatBits; int32_t rounding;
+//                         uint32_t reserved; uint64_t start; uint64_t end;
+//                         char function[32]; }
+//
+//              A table might be split in multiple files (one per genref
+//              shard), named <function>.<rounding>.<start>-<end>.golden.
+//
+//              A full binary32 table is 16 GiB, so the files are mapped
+//              with transparent huge pages and sequential readahead where
+//              available, and the readers prefetch their own work chunks
+//              (see TableSet::prefetch).
+//
+
+namespace goldentable
+{
+
+static constexpr char kMagic[8] = { 'C', 'M', 'G', 'O', 'L', 'D', 'E', 'N' };
+static constexpr std::uint32_t kVersion = 1;
+static constexpr std::size_t kDataOffset = 4096;
+
+struct Header
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t floatBits;
+  std::int32_t rounding;
+  std::uint32_t reserved;
+  std::uint64_t start;
+  std::uint64_t end;
+  char function[32];
+};
+
+inline Header
+makeHeader (const std::string &function, int rounding, std::uint64_t start,
+	    std::uint64_t end)
+{
+  Header h{};
+  std::memcpy (h.magic, kMagic, sizeof (h.magic));
+  h.version = kVersion;
+  h.floatBits = 32;
+  h.rounding = rounding;
+  h.start = start;
+  h.end = end;
+  std::strncpy (h.function, function.c_str (), sizeof (h.function) - 1);
+  return h;
+}
+
+inline std::string
+fileName (const std::string &function, const std::string &rounding,
+	  std::uint64_t start, std::uint64_t end)
+{
+  return std::format ("{}.{}.{:09x}-{:09x}.golden", function, rounding,
+		      start, end);
+}
+
+// Start the asynchronous read of the pages of [P, P + SIZE).
+inline void
+willNeed (const void *p, std::size_t size)
+{
+  const std::uintptr_t mask = sysconf (_SC_PAGESIZE) - 1;
+  const std::uintptr_t b = reinterpret_cast<std::uintptr_t> (p) & ~mask;
+  const std::uintptr_t e = reinterpret_cast<std::uintptr_t> (p) + size;
+  madvise (reinterpret_cast<void *> (b), e - b, MADV_WILLNEED);
+}
+
+inline std::expected<void, std::string>
+checkHeader (const Header &h, const std::string &path)
+{
+  if (std::memcmp (h.magic, kMagic, sizeof (kMagic)) != 0)
+    return std::unexpected (std::format ("{}: invalid golden table", path));
+  if (h.version != kVersion)
+    return std::unexpected (std::format (
+	"{}: unsupported golden table version {}", path, h.version));
+  if (h.floatBits != 32 || h.end <= h.start)
+    return std::unexpected (
+	std::format ("{}: invalid golden table range", path));
+  return {};
+}
+
+//
+// Table: a memory mapped golden table file.
+//
+
+class Table
+{
+  const std::uint8_t *map = nullptr;
+  std::size_t mapSize = 0;
+
+  Table () = default;
+
+public:
+  static std::expected<Table, std::string>
+  open (const std::string &path)
+  {
+    int fd = ::open (path.c_str (), O_RDONLY);
+    if (fd == -1)
+      return std::unexpected (
+	  std::format ("{}: {}", path, std::strerror (errno)));
+
+    Header h;
+    if (pread (fd, &h, sizeof (h), 0) != sizeof (h))
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: truncated golden table header", path));
+      }
+    if (auto r = checkHeader (h, path); !r)
+      {
+	::close (fd);
+	return std::unexpected (r.error ());
+      }
+
+    struct stat st;
+    const std::size_t size
+	= kDataOffset + (h.end - h.start) * sizeof (std::uint32_t);
+    if (fstat (fd, &st) == -1 || static_cast<std::size_t> (st.st_size) < size)
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: truncated golden table", path));
+      }
+
+    void *m = mmap (nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close (fd);
+    if (m == MAP_FAILED)
+      return std::unexpected (
+	  std::format ("{}: mmap: {}", path, std::strerror (errno)));
+
+    // Huge pages reduce the TLB misses of the table scan (for file mappings
+    // they depend on the kernel and file system support, so a failure is
+    // ignored).
+#ifdef MADV_HUGEPAGE
+    madvise (m, size, MADV_HUGEPAGE);
+#endif
+    madvise (m, size, MADV_SEQUENTIAL);
+
+    Table t;
+    t.map = static_cast<const std::uint8_t *> (m);
+    t.mapSize = size;
+    return t;
+  }
+
+  Table (Table &&other) noexcept : map (other.map), mapSize (other.mapSize)
+  {
+    other.map = nullptr;
+  }
+
+  Table &
+  operator= (Table &&other) noexcept
+  {
+    std::swap (map, other.map);
+    std::swap (mapSize, other.mapSize);
+    return *this;
+  }
+
+  Table (const Table &) = delete;
+  Table &operator= (const Table &) = delete;
+
+  ~Table ()
+  {
+    if (map != nullptr)
+      munmap (const_cast<std::uint8_t *> (map), mapSize);
+  }
+
+  const Header &
+  header () const
+  {
+    return *reinterpret_cast<const Header *> (map);
+  }
+
+  const std::uint32_t *
+  data () const
+  {
+    return reinterpret_cast<const std::uint32_t *> (map + kDataOffset);
+  }
+};
+
+// Names of the functions with a golden table in DIR.
+inline std::expected<std::vector<std::string>, std::string>
+functions (const std::string &dir)
+{
+  std::vector<std::string> ret;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator (dir, ec))
+    {
+      const std::string name = entry.path ().filename ().string ();
+      if (!name.ends_with (".golden"))
+	continue;
+      std::string function = name.substr (0, name.find ('.'));
+      if (std::find (ret.begin (), ret.end (), function) == ret.end ())
+	ret.push_back (function);
+    }
+  if (ec)
+    return std::unexpected (std::format ("{}: {}", dir, ec.message ()));
+  std::sort (ret.begin (), ret.end ());
+  return ret;
+}
+
+//
+// TableSet: all the table files of a function and rounding mode in a
+//           directory, used to look up the expected results of a block of
+//           inputs.  A table with a <table>.progress file is still being
+//           generated by genref (or it was interrupted), so its missing
+//           chunks are zero filled and it is rejected.
+//
+
+class TableSet
+{
+  std::vector<Table> tables;
+
+public:
+  static std::expected<TableSet, std::string>
+  open (const std::string &dir, const std::string &function,
+	const std::string &rounding, int mode)
+  {
+    TableSet set;
+    const std::string prefix = function + "." + rounding + ".";
+
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator (dir, ec))
+      {
+	const std::string name = entry.path ().filename ().string ();
+	if (!name.starts_with (prefix) || !name.ends_with (".golden"))
+	  continue;
+	const std::string path = entry.path ().string ();
+	if (std::filesystem::exists (path + ".progress"))
+	  return std::unexpected (std::format (
+	      "{}: incomplete golden table (see {}.progress)", path, path));
+	auto t = Table::open (path);
+	if (!t)
+	  return std::unexpected (t.error ());
+	const Header &h = t->header ();
+	const std::string tableFunction (
+	    h.function, strnlen (h.function, sizeof (h.function)));
+	if (tableFunction != function || h.rounding != mode)
+	  return std::unexpected (
+	      std::format ("{}: golden table of {} (rounding {}), expected "
+			   "{} (rounding {})",
+			   path, tableFunction, h.rounding, function, mode));
+	set.tables.push_back (std::move (t.value ()));
+      }
+    if (ec)
+      return std::unexpected (
+	  std::format ("{}: {}", dir, ec.message ()));
+
+    std::sort (set.tables.begin (), set.tables.end (),
+	       [] (const Table &a, const Table &b) {
+		 return a.header ().start < b.header ().start;
+	       });
+    return set;
+  }
+
+  bool
+  empty () const
+  {
+    return tables.empty ();
+  }
+
+  // Returns the expected results for the inputs [START, START + N), or
+  // nullptr if they are not all covered by a single table file.
+  const std::uint32_t *
+  find (std::uint64_t start, std::size_t n) const
+  {
+    const Table *t = lookup (start);
+    if (t == nullptr || start + n > t->header ().end)
+      return nullptr;
+    return t->data () + (start - t->header ().start);
+  }
+
+  // Start reading the expected results for the inputs [START, START + N),
+  // used by each thread for its next work chunk.
+  void
+  prefetch (std::uint64_t start, std::size_t n) const
+  {
+    const Table *t = lookup (start);
+    if (t == nullptr)
+      return;
+    n = std::min<std::uint64_t> (n, t->header ().end - start);
+    willNeed (t->data () + (start - t->header ().start),
+	      n * sizeof (std::uint32_t));
+  }
+
+private:
+  const Table *
+  lookup (std::uint64_t start) const
+  {
+    auto it = std::upper_bound (tables.begin (), tables.end (), start,
+				[] (std::uint64_t s, const Table &t) {
+				  return s < t.header ().start;
+				});
+    if (it == tables.begin () || start >= (it - 1)->header ().end)
+      return nullptr;
+    return &*(it - 1);
+  }
+};
+
+} // namespace goldentable
+
+#endif
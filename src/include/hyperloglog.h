@@ -0,0 +1,73 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _HYPERLOGLOG_H
+#define _HYPERLOGLOG_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+//
+// HyperLogLog: distinct count estimator in constant memory (Flajolet et al.,
+//              with the linear counting correction for small cardinalities).
+//              The items are 64-bit hashes, which should be well mixed (see
+//              mix).
+//
+
+template <unsigned P = 14> class HyperLogLog
+{
+  static_assert (P >= 4 && P <= 18);
+
+  static constexpr std::uint32_t kRegisters = 1u << P;
+
+  std::array<std::uint8_t, kRegisters> regs = {};
+
+public:
+  // splitmix64 finalizer, to hash bit patterns.
+  static constexpr std::uint64_t
+  mix (std::uint64_t x)
+  {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+  }
+
+  void
+  add (std::uint64_t hash)
+  {
+    const std::uint32_t idx = hash >> (64 - P);
+    // The rank of the remaining bits, with a sentinel bit so it is bounded.
+    const std::uint64_t w = (hash << P) | (std::uint64_t (1) << (P - 1));
+    const std::uint8_t rank = std::countl_zero (w) + 1;
+    regs[idx] = std::max (regs[idx], rank);
+  }
+
+  double
+  estimate () const
+  {
+    const double m = kRegisters;
+    const double alpha = 0.7213 / (1.0 + 1.079 / m);
+    double sum = 0.0;
+    std::uint32_t zeros = 0;
+    for (auto r : regs)
+      {
+	sum += std::ldexp (1.0, -static_cast<int> (r));
+	zeros += r == 0;
+      }
+    const double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros != 0)
+      return m * std::log (m / zeros);
+    return e;
+  }
+};
+
+#endif
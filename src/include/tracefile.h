@@ -0,0 +1,470 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _TRACEFILE_H
+#define _TRACEFILE_H
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// tracefile: raw evaluation traces written by checkulps --trace, with every
+//            (input, computed, expected) triple checked, and read by
+//            ulpanalyze.
+//
+//            The file is a fixed header followed by independent blocks, in
+//            host byte order:
+//
+//              Header { char magic[8]; uint32_t version;
+//                       uint32_t floatBits; uint32_t arg2;
+//                       uint32_t outputs; char function[32]; }
+//              Block  { uint32_t count; uint32_t size; int32_t rounding;
+//                       uint32_t reserved; uint8_t payload[size]; }
+//
+//            Each block holds COUNT records of a single rounding mode.  The
+//            record fields are the argument bit patterns (the second one is
+//            0 for single argument functions), and the computed/expected bit
+//            patterns for each output.  To compress the payload each input
+//            and computed value is XOR'ed with the same field of the
+//            previous record in the block, each expected value is XOR'ed
+//            with its computed value (so correctly rounded results are
+//            zero), and the results are stored as LEB128 varints.
+//
+//            Blocks can be decoded independently, so the reader maps the
+//            file and hands blocks to different threads.
+//
+
+namespace tracefile
+{
+
+static constexpr char kMagic[8] = { 'C', 'M', 'T', 'R', 'A', 'C', 'E', 0 };
+static constexpr std::uint32_t kVersion = 1;
+static constexpr std::size_t kBlockRecords = 4096;
+
+enum Arg2 : std::uint32_t
+{
+  ARG2_NONE = 0,
+  ARG2_FLOAT = 1,
+  ARG2_INTEGER = 2,
+};
+
+struct Header
+{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t floatBits;
+  std::uint32_t arg2;
+  std::uint32_t outputs;
+  char function[32];
+};
+
+struct BlockHeader
+{
+  std::uint32_t count;
+  std::uint32_t size;
+  std::int32_t rounding;
+  std::uint32_t reserved;
+};
+
+struct Record
+{
+  std::uint64_t x;
+  std::uint64_t y;
+  std::uint64_t computed[2];
+  std::uint64_t expected[2];
+};
+
+inline Header
+makeHeader (const std::string &function, std::uint32_t floatBits,
+	    std::uint32_t arg2, std::uint32_t outputs)
+{
+  Header h{};
+  std::memcpy (h.magic, kMagic, sizeof (h.magic));
+  h.version = kVersion;
+  h.floatBits = floatBits;
+  h.arg2 = arg2;
+  h.outputs = outputs;
+  std::strncpy (h.function, function.c_str (), sizeof (h.function) - 1);
+  return h;
+}
+
+namespace detail
+{
+
+inline void
+putVarint (std::vector<std::uint8_t> &out, std::uint64_t v)
+{
+  while (v >= 0x80)
+    {
+      out.push_back (static_cast<std::uint8_t> (v) | 0x80);
+      v >>= 7;
+    }
+  out.push_back (static_cast<std::uint8_t> (v));
+}
+
+inline bool
+getVarint (const std::uint8_t *&p, const std::uint8_t *end, std::uint64_t &v)
+{
+  v = 0;
+  for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+    {
+      std::uint8_t b = *p++;
+      v |= static_cast<std::uint64_t> (b & 0x7f) << shift;
+      if (!(b & 0x80))
+	return true;
+    }
+  return false;
+}
+
+} // namespace detail
+
+//
+// Writer: buffers the records of one thread and hands a full buffer (of
+//         kBlockRecords, or less when the rounding mode changes) to its own
+//         background thread, which compresses and writes the block while
+//         the records go to a second buffer.  The checking loops only pay
+//         for the copy, and only wait if the background thread is a whole
+//         block behind.  The write errors are reported by close.
+//
+
+class Writer
+{
+  struct State
+  {
+    std::string fileName;
+    std::FILE *file;
+    Header header;
+    std::mutex lock;
+    std::condition_variable cond;
+    // The buffer handed to the background thread, while FULL is set.
+    std::vector<Record> pending;
+    int pendingRounding = 0;
+    bool full = false;
+    bool closing = false;
+    // The first I/O error, set by the background thread.
+    std::string error;
+    std::vector<std::uint8_t> payload;
+
+    void
+    write (const std::vector<Record> &records, int rounding)
+    {
+      if (!error.empty ())
+	return;
+
+      payload.clear ();
+      Record prev{};
+      for (const auto &r : records)
+	{
+	  detail::putVarint (payload, r.x ^ prev.x);
+	  if (header.arg2 != ARG2_NONE)
+	    detail::putVarint (payload, r.y ^ prev.y);
+	  for (std::uint32_t i = 0; i < header.outputs; i++)
+	    {
+	      detail::putVarint (payload, r.computed[i] ^ prev.computed[i]);
+	      detail::putVarint (payload, r.expected[i] ^ r.computed[i]);
+	    }
+	  prev = r;
+	}
+
+      BlockHeader bh{ static_cast<std::uint32_t> (records.size ()),
+		      static_cast<std::uint32_t> (payload.size ()), rounding,
+		      0 };
+      if (std::fwrite (&bh, sizeof (bh), 1, file) != 1
+	  || std::fwrite (payload.data (), 1, payload.size (), file)
+		 != payload.size ())
+	error = std::format ("writing {}: {}", fileName,
+			     std::strerror (errno));
+    }
+
+    void
+    run ()
+    {
+      std::vector<Record> records;
+      records.reserve (kBlockRecords);
+      for (;;)
+	{
+	  int rounding;
+	  {
+	    std::unique_lock<std::mutex> l (lock);
+	    cond.wait (l, [this] { return full || closing; });
+	    if (!full)
+	      return;
+	    // Give back the buffer written in the previous iteration.
+	    records.swap (pending);
+	    rounding = pendingRounding;
+	    full = false;
+	  }
+	  cond.notify_all ();
+	  write (records, rounding);
+	  records.clear ();
+	}
+    }
+  };
+
+  std::unique_ptr<State> state;
+  std::thread thread;
+  int rounding = 0;
+  std::vector<Record> records;
+
+  explicit Writer (std::unique_ptr<State> s) : state (std::move (s))
+  {
+    records.reserve (kBlockRecords);
+    state->pending.reserve (kBlockRecords);
+    thread = std::thread (&State::run, state.get ());
+  }
+
+public:
+  static std::expected<Writer, std::string>
+  open (const std::string &fileName, const Header &header)
+  {
+    std::FILE *f = std::fopen (fileName.c_str (), "wb");
+    if (f == nullptr)
+      return std::unexpected (
+	  std::format ("{}: {}", fileName, std::strerror (errno)));
+    if (std::fwrite (&header, sizeof (header), 1, f) != 1)
+      {
+	std::fclose (f);
+	return std::unexpected (std::format ("writing {}", fileName));
+      }
+    auto s = std::make_unique<State> ();
+    s->fileName = fileName;
+    s->file = f;
+    s->header = header;
+    return Writer (std::move (s));
+  }
+
+  Writer (Writer &&other) noexcept
+      : state (std::move (other.state)), thread (std::move (other.thread)),
+	rounding (other.rounding), records (std::move (other.records))
+  {
+  }
+
+  Writer (const Writer &) = delete;
+  Writer &operator= (const Writer &) = delete;
+
+  ~Writer () { (void) close (); }
+
+  void
+  add (int rnd, const Record &r)
+  {
+    if (rnd != rounding && !records.empty ())
+      flush ();
+    rounding = rnd;
+    records.push_back (r);
+    if (records.size () == kBlockRecords)
+      flush ();
+  }
+
+  // Hand the buffered records to the background thread.
+  void
+  flush ()
+  {
+    if (records.empty ())
+      return;
+
+    {
+      std::unique_lock<std::mutex> l (state->lock);
+      state->cond.wait (l, [this] { return !state->full; });
+      records.swap (state->pending);
+      state->pendingRounding = rounding;
+      state->full = true;
+    }
+    state->cond.notify_all ();
+    records.clear ();
+  }
+
+  // Write the remaining records and close the file, returns the first
+  // error of the writes.
+  std::expected<void, std::string>
+  close ()
+  {
+    if (!state)
+      return {};
+    flush ();
+    {
+      std::lock_guard<std::mutex> l (state->lock);
+      state->closing = true;
+    }
+    state->cond.notify_all ();
+    thread.join ();
+
+    std::string err = std::move (state->error);
+    if (std::fclose (state->file) != 0 && err.empty ())
+      err = std::format ("closing {}: {}", state->fileName,
+			 std::strerror (errno));
+    state.reset ();
+    if (!err.empty ())
+      return std::unexpected (err);
+    return {};
+  }
+};
+
+//
+// Reader: memory maps a trace file and indexes its blocks.
+//
+
+class Reader
+{
+public:
+  struct Block
+  {
+    const std::uint8_t *payload;
+    std::uint32_t count;
+    std::uint32_t size;
+    int rounding;
+  };
+
+private:
+  const std::uint8_t *map = nullptr;
+  std::size_t mapSize = 0;
+  std::vector<Block> blockList;
+
+  Reader () = default;
+
+public:
+  static std::expected<Reader, std::string>
+  open (const std::string &fileName)
+  {
+    int fd = ::open (fileName.c_str (), O_RDONLY);
+    if (fd == -1)
+      return std::unexpected (
+	  std::format ("{}: {}", fileName, std::strerror (errno)));
+
+    struct stat st;
+    if (fstat (fd, &st) == -1)
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: {}", fileName, std::strerror (errno)));
+      }
+    if (static_cast<std::size_t> (st.st_size) < sizeof (Header))
+      {
+	::close (fd);
+	return std::unexpected (
+	    std::format ("{}: truncated trace header", fileName));
+      }
+
+    void *m = mmap (nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close (fd);
+    if (m == MAP_FAILED)
+      return std::unexpected (
+	  std::format ("{}: mmap: {}", fileName, std::strerror (errno)));
+    madvise (m, st.st_size, MADV_SEQUENTIAL);
+
+    Reader r;
+    r.map = static_cast<const std::uint8_t *> (m);
+    r.mapSize = st.st_size;
+
+    const Header &h = r.header ();
+    if (std::memcmp (h.magic, kMagic, sizeof (kMagic)) != 0)
+      return std::unexpected (
+	  std::format ("{}: invalid trace file", fileName));
+    if (h.version != kVersion)
+      return std::unexpected (std::format (
+	  "{}: unsupported trace version {}", fileName, h.version));
+
+    std::size_t off = sizeof (Header);
+    while (off + sizeof (BlockHeader) <= r.mapSize)
+      {
+	BlockHeader bh;
+	std::memcpy (&bh, r.map + off, sizeof (bh));
+	off += sizeof (bh);
+	if (off + bh.size > r.mapSize)
+	  return std::unexpected (
+	      std::format ("{}: truncated trace block", fileName));
+	r.blockList.push_back (
+	    Block{ r.map + off, bh.count, bh.size, bh.rounding });
+	off += bh.size;
+      }
+
+    return r;
+  }
+
+  Reader (Reader &&other) noexcept
+      : map (other.map), mapSize (other.mapSize),
+	blockList (std::move (other.blockList))
+  {
+    other.map = nullptr;
+  }
+
+  Reader (const Reader &) = delete;
+  Reader &operator= (const Reader &) = delete;
+
+  ~Reader ()
+  {
+    if (map != nullptr)
+      munmap (const_cast<std::uint8_t *> (map), mapSize);
+  }
+
+  const Header &
+  header () const
+  {
+    return *reinterpret_cast<const Header *> (map);
+  }
+
+  const std::vector<Block> &
+  blocks () const
+  {
+    return blockList;
+  }
+
+  // Decode block B into OUT, returns false if the payload is corrupted.
+  bool
+  decode (const Block &b, std::vector<Record> &out) const
+  {
+    const Header &h = header ();
+    const std::uint8_t *p = b.payload;
+    const std::uint8_t *end = b.payload + b.size;
+
+    out.resize (b.count);
+    Record prev{};
+    for (auto &r : out)
+      {
+	r = Record{};
+	std::uint64_t v;
+	if (!detail::getVarint (p, end, v))
+	  return false;
+	r.x = v ^ prev.x;
+	if (h.arg2 != ARG2_NONE)
+	  {
+	    if (!detail::getVarint (p, end, v))
+	      return false;
+	    r.y = v ^ prev.y;
+	  }
+	for (std::uint32_t i = 0; i < h.outputs && i < 2; i++)
+	  {
+	    if (!detail::getVarint (p, end, v))
+	      return false;
+	    r.computed[i] = v ^ prev.computed[i];
+	    if (!detail::getVarint (p, end, v))
+	      return false;
+	    r.expected[i] = v ^ r.computed[i];
+	  }
+	prev = r;
+      }
+    return true;
+  }
+};
+
+} // namespace tracefile
+
+#endif
@@ -0,0 +1,119 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _ULPCHECK_H
+#define _ULPCHECK_H
+
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+//
+// isSignaling: C11 macro that returns if a number is a signaling NaN.
+//
+
+template <std::floating_point T> bool isSignaling (T);
+
+template <>
+inline bool
+isSignaling<float> (float x)
+{
+  union
+  {
+    float f;
+    std::uint32_t u;
+  } n = { .f = x };
+  n.u ^= 0x00400000;
+  return (n.u & 0x7fffffff) > 0x7fc00000;
+}
+
+template <>
+inline bool
+isSignaling<double> (double x)
+{
+  union
+  {
+    double f;
+    std::uint64_t u;
+  } n = { .f = x };
+  n.u ^= UINT64_C (0x0008000000000000);
+  return (n.u & UINT64_C (0x7fffffffffffffff)) > UINT64_C (0x7ff8000000000000);
+}
+
+// Returns the size of an ulp for VALUE, or NaN if VALUE is not finite (so
+// ulpdiff is NaN or Inf as well).
+template <typename F>
+F
+ulp (F value)
+{
+  F ulp;
+
+  switch (std::fpclassify (value))
+    {
+    case FP_ZERO:
+      /* Fall through...  */
+    case FP_SUBNORMAL:
+      ulp = std::ldexp (1.0, std::numeric_limits<F>::min_exponent
+				 - std::numeric_limits<F>::digits);
+      break;
+
+    case FP_NORMAL:
+      ulp = std::ldexp (1.0, std::ilogb (value)
+				 - std::numeric_limits<F>::digits + 1);
+      break;
+
+    default:
+      ulp = std::numeric_limits<F>::quiet_NaN ();
+      break;
+    }
+  return ulp;
+}
+
+/* Returns the number of ulps that GIVEN is away from EXPECTED.  */
+template <typename F>
+F
+ulpdiff (F given, F expected)
+{
+  return std::fabs (given - expected) / ulp (expected);
+}
+
+// The ULP error reported by checkulps: NaN/Inf differences are not
+// accounted as errors, they are handled by checkFullValue.
+template <typename F>
+F
+ulpError (F computed, F expected)
+{
+  F ulp = ulpdiff (computed, expected);
+  if (std::isnan (ulp) || std::isinf (ulp))
+    return 0.0;
+  return ulp;
+}
+
+// Returns whether COMPUTED is a valid result for EXPECTED, where ULP is the
+// value returned by ulpError: signaling NaNs are always invalid, NaNs and
+// infinities should match (including the infinity sign), and finite results
+// should be at most MAX ulps away.
+template <typename F>
+bool
+checkFullValue (F computed, F expected, F ulp, F max)
+{
+  if (isSignaling (computed) || isSignaling (expected))
+    return false;
+  else if (std::isnan (computed) && std::isnan (expected))
+    return true;
+  else if (std::isinf (computed) && std::isinf (expected))
+    /* Test for sign of infinities.  */
+    return std::signbit (computed) == std::signbit (expected);
+  else if (std::isinf (computed) || std::isnan (computed)
+	   || std::isinf (expected) || std::isnan (expected))
+    return false;
+
+  return ulp <= max;
+}
+
+#endif
@@ -0,0 +1,171 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _ULPKERNEL_H
+#define _ULPKERNEL_H
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+//
+// Block compare and histogram kernel: the batched equivalent of ulpError,
+// checkFullValue and the ULP histogram update (see ulpcheck.h).
+//
+// The comparison works on the bit patterns with no data dependent branches,
+// so the loop is vectorized by the compiler for the enabled ISA (AVX2,
+// AVX-512, NEON, ...) through '#pragma omp simd', and it is also the scalar
+// fallback.  The ULP error is computed with the same floating point
+// operations as ulpdiff (the division by the power of two ulp is replaced
+// by an exact scaling), so the results are bit-identical to the scalar
+// path, including the rounding mode effects.
+//
+
+namespace ulpkernel
+{
+
+template <typename F> struct Traits;
+
+template <> struct Traits<float>
+{
+  typedef std::uint32_t UInt;
+  typedef std::int32_t Int;
+};
+
+template <> struct Traits<double>
+{
+  typedef std::uint64_t UInt;
+  typedef std::int64_t Int;
+};
+
+//
+// compareBlock: for each of the N results set ULPS[i] to ulpError
+//               (COMPUTED[i], EXPECTED[i]) and VALID[i] to checkFullValue
+//               (COMPUTED[i], EXPECTED[i], ULPS[i], MAX).
+//
+
+template <typename F>
+inline void
+compareBlock (const F *__restrict computed, const F *__restrict expected,
+	      std::size_t n, F max, F *__restrict ulps,
+	      std::uint8_t *__restrict valid)
+{
+  typedef typename Traits<F>::UInt UInt;
+  typedef typename Traits<F>::Int Int;
+
+  constexpr int kMantBits = std::numeric_limits<F>::digits - 1;
+  constexpr int kBias = std::numeric_limits<F>::max_exponent - 1;
+  constexpr UInt kSign = UInt (1) << (sizeof (UInt) * 8 - 1);
+  constexpr UInt kExpMask = ~kSign & ~((UInt (1) << kMantBits) - 1);
+  constexpr UInt kQuiet = UInt (1) << (kMantBits - 1);
+
+#pragma omp simd
+  for (std::size_t i = 0; i < n; i++)
+    {
+      const UInt c = std::bit_cast<UInt> (computed[i]);
+      const UInt e = std::bit_cast<UInt> (expected[i]);
+      const UInt ca = c & ~kSign;
+      const UInt ea = e & ~kSign;
+
+      const bool cnan = ca > kExpMask;
+      const bool enan = ea > kExpMask;
+      const bool cinf = ca == kExpMask;
+      const bool einf = ea == kExpMask;
+      const bool csnan = cnan & !(c & kQuiet);
+      const bool esnan = enan & !(e & kQuiet);
+
+      // ulp (expected) is 2^(max (E, 1) - kBias - kMantBits) for the biased
+      // exponent E, so the error is |c - e| * 2^S.  S is split in two
+      // exponents to keep each scale factor a normal number.
+      Int be = static_cast<Int> (ea >> kMantBits);
+      be = be == 0 ? 1 : be;
+      const Int s = kMantBits + kBias - be;
+      const Int s1 = s / 2;
+      const Int s2 = s - s1;
+      const F p1 = std::bit_cast<F> (static_cast<UInt> (s1 + kBias)
+				     << kMantBits);
+      const F p2 = std::bit_cast<F> (static_cast<UInt> (s2 + kBias)
+				     << kMantBits);
+
+      const F diff = std::fabs (computed[i] - expected[i]);
+      F u = diff * p1 * p2;
+      // As ulpError, NaN/Inf errors (including overflows) are not
+      // accounted.  An infinite or NaN expected value always results in a
+      // NaN or infinite error.
+      const UInt ub = std::bit_cast<UInt> (u) & ~kSign;
+      u = (ub >= kExpMask) | einf | enan ? F (0) : u;
+      ulps[i] = u;
+
+      const bool cspecial = cnan | cinf;
+      const bool especial = enan | einf;
+      const bool signaling = csnan | esnan;
+      const bool ok = (cnan & enan)
+		      | (cinf & einf & ((c & kSign) == (e & kSign)))
+		      | (!cspecial & !especial & (u <= max));
+      valid[i] = signaling ? false : ok;
+    }
+}
+
+//
+// LaneHistogram: ULP histogram accumulator for compareBlock results.  The
+//                usual errors (multiples of 0.5 below kBuckets / 2) are
+//                counted in kLanes interleaved small histograms, so
+//                consecutive updates of the same bucket do not depend on
+//                each other; other values go to an ordered map as the
+//                scalar UlpAccumulator.
+//
+
+template <typename F> class LaneHistogram
+{
+  static constexpr unsigned kLanes = 8;
+  static constexpr unsigned kBuckets = 16;
+
+  std::uint64_t counts[kLanes][kBuckets] = {};
+  std::map<F, std::uint64_t> spill;
+
+public:
+  void
+  add (const F *ulps, std::size_t n)
+  {
+    for (std::size_t i = 0; i < n; i++)
+      {
+	const F t = ulps[i] * 2;
+	if (t < F (kBuckets))
+	  {
+	    const unsigned b = static_cast<unsigned> (t);
+	    if (F (b) == t)
+	      {
+		counts[i % kLanes][b]++;
+		continue;
+	      }
+	  }
+	spill[ulps[i]]++;
+      }
+  }
+
+  template <typename ACC>
+  void
+  mergeInto (ACC &acc) const
+  {
+    for (unsigned b = 0; b < kBuckets; b++)
+      {
+	std::uint64_t sum = 0;
+	for (unsigned l = 0; l < kLanes; l++)
+	  sum += counts[l][b];
+	if (sum != 0)
+	  acc[F (b) / 2] += sum;
+      }
+    for (const auto &[ulp, count] : spill)
+      acc[ulp] += count;
+  }
+};
+
+} // namespace ulpkernel
+
+#endif
@@ -0,0 +1,384 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _WORKLOADMODEL_H
+#define _WORKLOADMODEL_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <istream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// workloadmodel: compact model of the argument distribution of a function,
+//                fitted from captured arguments (see argtrace.h) or a
+//                benchtest input and used by randfloatgen to synthesize
+//                workloads of any size with the same distribution.
+//
+//                Each argument is split in a class and a mantissa bucket:
+//                floating point arguments by sign and biased exponent, and
+//                the kMantissaBits bits after it, with the zeros and the
+//                infinities in classes of their own (flagged with
+//                kExactClass) that are reproduced exactly; integer
+//                arguments by sign and bit length, and the kMantissaBits bits
+//                after the leading one.  The model holds the joint counts of
+//                the argument classes (so the correlation between the
+//                magnitudes of two arguments is kept) and, for each class of
+//                each argument, the histogram of its mantissa buckets.  The
+//                remaining bits are drawn uniformly.
+//
+//                The model is saved as a small text file:
+//
+//                  # comment
+//                  kind x|y binary32|binary64|int64
+//                  cell <class x> <class y> <count>
+//                  hist x|y <class> <count 0> ... <count kBuckets-1>
+//
+//                with the classes in hexadecimal and class y 0 for single
+//                argument functions.
+//
+
+namespace workloadmodel
+{
+
+static constexpr unsigned kMantissaBits = 4;
+static constexpr unsigned kBuckets = 1 << kMantissaBits;
+
+enum class ArgKind
+{
+  Binary32,
+  Binary64,
+  Int64,
+};
+
+inline std::string_view
+kindName (ArgKind kind)
+{
+  switch (kind)
+    {
+    case ArgKind::Binary32:
+      return "binary32";
+    case ArgKind::Binary64:
+      return "binary64";
+    case ArgKind::Int64:
+      return "int64";
+    }
+  return "";
+}
+
+inline std::optional<ArgKind>
+kindFromName (std::string_view name)
+{
+  for (auto k : { ArgKind::Binary32, ArgKind::Binary64, ArgKind::Int64 })
+    if (kindName (k) == name)
+      return k;
+  return std::nullopt;
+}
+
+// Number of explicit mantissa bits of the floating point kinds.
+constexpr unsigned
+mantissaBits (ArgKind kind)
+{
+  return kind == ArgKind::Binary32 ? 23 : 52;
+}
+
+// Flag of the floating point classes of the zeros and infinities (a zero
+// mantissa with the minimum or maximum biased exponent), above the sign and
+// exponent bits of binary64.
+static constexpr std::uint64_t kExactClass = UINT64_C (1) << 12;
+
+struct Split
+{
+  std::uint64_t cls;
+  unsigned bucket;
+};
+
+// Split the bit pattern BITS of an argument of KIND in class and bucket.
+inline Split
+split (ArgKind kind, std::uint64_t bits)
+{
+  if (kind != ArgKind::Int64)
+    {
+      const unsigned m = mantissaBits (kind);
+      const std::uint64_t expMask = (UINT64_C (1) << (m == 23 ? 8 : 11)) - 1;
+      const std::uint64_t exp = (bits >> m) & expMask;
+      if ((bits & ((UINT64_C (1) << m) - 1)) == 0
+	  && (exp == 0 || exp == expMask))
+	return { bits >> m | kExactClass, 0 };
+      const unsigned bucket = (bits >> (m - kMantissaBits)) & (kBuckets - 1);
+      return { bits >> m, bucket };
+    }
+
+  const std::int64_t v = static_cast<std::int64_t> (bits);
+  const std::uint64_t sign = v < 0;
+  const std::uint64_t mag = sign ? -bits : bits;
+  const unsigned len = std::bit_width (mag);
+  // The bits after the leading one, all of them for small values.
+  unsigned bucket;
+  if (len <= kMantissaBits)
+    bucket = len == 0 ? 0 : mag & ((UINT64_C (1) << (len - 1)) - 1);
+  else
+    bucket = (mag >> (len - 1 - kMantissaBits)) & (kBuckets - 1);
+  return { sign << 7 | len, bucket };
+}
+
+// The inverse of split, with the bits below the bucket from RNG.
+template <typename RNG>
+inline std::uint64_t
+join (ArgKind kind, std::uint64_t cls, unsigned bucket, RNG &rng)
+{
+  if (kind != ArgKind::Int64)
+    {
+      const unsigned m = mantissaBits (kind);
+      if (cls & kExactClass)
+	return (cls & ~kExactClass) << m;
+      // The subnormal and NaN classes never had a zero mantissa, which
+      // would turn them into a zero or an infinity.
+      const unsigned low = m - kMantissaBits;
+      std::uint64_t mant = std::uint64_t (bucket) << low
+			   | (rng () & ((UINT64_C (1) << low) - 1));
+      return cls << m | (mant == 0 ? 1 : mant);
+    }
+
+  const bool sign = cls >> 7;
+  const unsigned len = cls & 0x7f;
+  std::uint64_t mag = 0;
+  if (len > kMantissaBits)
+    {
+      const unsigned low = len - 1 - kMantissaBits;
+      mag = UINT64_C (1) << (len - 1) | std::uint64_t (bucket) << low
+	    | (rng () & ((UINT64_C (1) << low) - 1));
+    }
+  else if (len != 0)
+    mag = UINT64_C (1) << (len - 1) | bucket;
+  return sign ? -mag : mag;
+}
+
+typedef std::array<std::uint64_t, kBuckets> Histogram;
+
+class Model
+{
+public:
+  ArgKind kindX;
+  std::optional<ArgKind> kindY;
+
+  Model (ArgKind x, std::optional<ArgKind> y) : kindX (x), kindY (y) {}
+
+  void
+  add (std::uint64_t x, std::uint64_t y = 0)
+  {
+    const Split sx = split (kindX, x);
+    const Split sy = kindY ? split (*kindY, y) : Split{ 0, 0 };
+    cells[{ sx.cls, sy.cls }]++;
+    histX[sx.cls][sx.bucket]++;
+    if (kindY)
+      histY[sy.cls][sy.bucket]++;
+  }
+
+  std::uint64_t
+  samples () const
+  {
+    std::uint64_t n = 0;
+    for (const auto &[c, count] : cells)
+      n += count;
+    return n;
+  }
+
+  std::size_t
+  classes () const
+  {
+    return cells.size ();
+  }
+
+  std::string
+  serialize () const
+  {
+    std::string s = std::format ("# workload model, {} samples\n",
+				 samples ());
+    s += std::format ("kind x {}\n", kindName (kindX));
+    if (kindY)
+      s += std::format ("kind y {}\n", kindName (*kindY));
+    for (const auto &[c, count] : cells)
+      s += std::format ("cell {:x} {:x} {}\n", c.first, c.second, count);
+    auto hist = [&s] (char arg, const std::map<std::uint64_t, Histogram> &h) {
+      for (const auto &[cls, counts] : h)
+	{
+	  s += std::format ("hist {} {:x}", arg, cls);
+	  for (auto c : counts)
+	    s += std::format (" {}", c);
+	  s += '\n';
+	}
+    };
+    hist ('x', histX);
+    hist ('y', histY);
+    return s;
+  }
+
+  static std::expected<Model, std::string>
+  parse (std::istream &in)
+  {
+    std::optional<ArgKind> x, y;
+    std::map<std::pair<std::uint64_t, std::uint64_t>, std::uint64_t> cells;
+    std::map<std::uint64_t, Histogram> histX, histY;
+
+    std::string line;
+    for (unsigned lineno = 1; std::getline (in, line); lineno++)
+      {
+	std::istringstream ls (line);
+	std::string tag;
+	if (!(ls >> tag) || tag.starts_with ('#'))
+	  continue;
+
+	bool ok = false;
+	std::string arg, name;
+	if (tag == "kind" && (ls >> arg >> name))
+	  {
+	    auto k = kindFromName (name);
+	    ok = k.has_value () && (arg == "x" || arg == "y");
+	    (arg == "x" ? x : y) = k;
+	  }
+	else if (tag == "cell")
+	  {
+	    std::uint64_t cx, cy, count;
+	    ok = static_cast<bool> (ls >> std::hex >> cx >> cy >> std::dec
+				    >> count);
+	    if (ok)
+	      cells[{ cx, cy }] += count;
+	  }
+	else if (tag == "hist" && (ls >> arg))
+	  {
+	    std::uint64_t cls;
+	    Histogram h;
+	    ok = static_cast<bool> (ls >> std::hex >> cls >> std::dec)
+		 && (arg == "x" || arg == "y");
+	    for (auto &c : h)
+	      ok = ok && (ls >> c);
+	    if (ok)
+	      (arg == "x" ? histX : histY)[cls] = h;
+	  }
+	if (!ok)
+	  return std::unexpected (
+	      std::format ("invalid workload model line {}: {}", lineno,
+			   line));
+      }
+
+    if (!x)
+      return std::unexpected (std::string ("workload model without kind x"));
+    std::uint64_t total = 0;
+    for (const auto &[c, count] : cells)
+      total += count;
+    if (total == 0)
+      return std::unexpected (std::string ("empty workload model"));
+    // The sampler draws from the cumulative counts.
+    for (const auto *h : { &histX, &histY })
+      for (const auto &[cls, counts] : *h)
+	if (std::all_of (counts.begin (), counts.end (),
+			 [] (std::uint64_t c) { return c == 0; }))
+	  return std::unexpected (std::format (
+	      "workload model with an empty histogram for class {:x}", cls));
+    for (const auto &[c, count] : cells)
+      if (!histX.contains (c.first) || (y && !histY.contains (c.second)))
+	return std::unexpected (
+	    std::format ("workload model without histogram for cell {:x} {:x}",
+			 c.first, c.second));
+
+    Model m (*x, y);
+    m.cells = std::move (cells);
+    m.histX = std::move (histX);
+    m.histY = std::move (histY);
+    return m;
+  }
+
+private:
+  std::map<std::pair<std::uint64_t, std::uint64_t>, std::uint64_t> cells;
+  std::map<std::uint64_t, Histogram> histX;
+  std::map<std::uint64_t, Histogram> histY;
+
+  friend class Sampler;
+};
+
+//
+// Sampler: draws argument bit patterns from a Model, with the class cells
+//          and the mantissa buckets selected from their cumulative counts.
+//
+
+class Sampler
+{
+  struct Cell
+  {
+    std::uint64_t x;
+    std::uint64_t y;
+    const Histogram *histX;
+    const Histogram *histY;
+  };
+
+  const Model &model;
+  std::vector<Cell> cells;
+  std::vector<std::uint64_t> cumulative;
+  std::map<std::uint64_t, Histogram> cumX;
+  std::map<std::uint64_t, Histogram> cumY;
+
+  static std::map<std::uint64_t, Histogram>
+  accumulate (const std::map<std::uint64_t, Histogram> &h)
+  {
+    std::map<std::uint64_t, Histogram> ret;
+    for (const auto &[cls, counts] : h)
+      {
+	Histogram &c = ret[cls];
+	std::uint64_t sum = 0;
+	for (unsigned b = 0; b < kBuckets; b++)
+	  c[b] = sum += counts[b];
+      }
+    return ret;
+  }
+
+  template <typename RNG>
+  static std::size_t
+  pick (const std::uint64_t *cum, std::size_t n, RNG &rng)
+  {
+    const std::uint64_t r = rng () % cum[n - 1];
+    return std::upper_bound (cum, cum + n, r) - cum;
+  }
+
+public:
+  explicit Sampler (const Model &m)
+      : model (m), cumX (accumulate (m.histX)), cumY (accumulate (m.histY))
+  {
+    std::uint64_t sum = 0;
+    for (const auto &[c, count] : m.cells)
+      {
+	cells.push_back (Cell{ c.first, c.second, &cumX.at (c.first),
+			       m.kindY ? &cumY.at (c.second) : nullptr });
+	cumulative.push_back (sum += count);
+      }
+  }
+
+  template <typename RNG>
+  std::pair<std::uint64_t, std::uint64_t>
+  operator() (RNG &rng) const
+  {
+    const Cell &c = cells[pick (cumulative.data (), cumulative.size (), rng)];
+    const std::uint64_t x
+	= join (model.kindX, c.x, pick (c.histX->data (), kBuckets, rng), rng);
+    if (!model.kindY)
+      return { x, 0 };
+    return { x, join (*model.kindY, c.y,
+		      pick (c.histY->data (), kBuckets, rng), rng) };
+  }
+};
+
+} // namespace workloadmodel
+
+#endif
@@ -0,0 +1,198 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _ELFSYMBOLS_H
+#define _ELFSYMBOLS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <elf.h>
+
+//
+// elfsymbols: the sized function and data object symbols of an ELF64
+//             shared object, from its static symbol table (.symtab) if it
+//             was not stripped, and from the dynamic one (.dynsym)
+//             otherwise.  The static table also lists the local symbols,
+//             such as the ifunc variants and the lookup tables of the libm
+//             implementations.
+//
+
+namespace elfsymbols
+{
+
+struct Symbol
+{
+  std::string name;
+  std::uint64_t value;
+  std::uint64_t size;
+  unsigned char type;
+};
+
+class Image
+{
+  std::map<std::string, Symbol> functions;
+  // Sorted by address.
+  std::vector<Symbol> code;
+  std::vector<Symbol> objects;
+  bool staticTable = false;
+
+  template <typename T>
+  static bool
+  readAt (const std::vector<char> &data, std::uint64_t off, T &out)
+  {
+    if (off > data.size () || data.size () - off < sizeof (T))
+      return false;
+    std::memcpy (&out, data.data () + off, sizeof (T));
+    return true;
+  }
+
+  bool
+  loadTable (const std::vector<char> &data, const Elf64_Shdr &symtab,
+	     const Elf64_Shdr &strtab)
+  {
+    if (symtab.sh_entsize != sizeof (Elf64_Sym))
+      return false;
+    for (std::uint64_t i = 1; i < symtab.sh_size / sizeof (Elf64_Sym); i++)
+      {
+	Elf64_Sym sym;
+	if (!readAt (data, symtab.sh_offset + i * sizeof (Elf64_Sym), sym))
+	  return false;
+	const unsigned char type = ELF64_ST_TYPE (sym.st_info);
+	if (sym.st_shndx == SHN_UNDEF || sym.st_size == 0
+	    || sym.st_name >= strtab.sh_size
+	    || strtab.sh_offset + strtab.sh_size > data.size ())
+	  continue;
+
+	const char *str = data.data () + strtab.sh_offset + sym.st_name;
+	Symbol s{ std::string (str, strnlen (str, strtab.sh_size
+						      - sym.st_name)),
+		  sym.st_value, sym.st_size, type };
+	if (type == STT_FUNC || type == STT_GNU_IFUNC)
+	  {
+	    functions.emplace (s.name, s);
+	    code.push_back (std::move (s));
+	  }
+	else if (type == STT_OBJECT)
+	  objects.push_back (std::move (s));
+      }
+    return true;
+  }
+
+  static const Symbol *
+  containing (const std::vector<Symbol> &symbols, std::uint64_t addr)
+  {
+    auto it = std::upper_bound (symbols.begin (), symbols.end (), addr,
+				[] (std::uint64_t a, const Symbol &s) {
+				  return a < s.value;
+				});
+    if (it == symbols.begin ())
+      return nullptr;
+    --it;
+    return addr < it->value + it->size ? &*it : nullptr;
+  }
+
+public:
+  static std::expected<Image, std::string>
+  open (const std::string &fileName)
+  {
+    std::ifstream in (fileName, std::ios::binary);
+    if (!in)
+      return std::unexpected (std::format ("{}: can not open", fileName));
+    const std::vector<char> data ((std::istreambuf_iterator<char> (in)),
+				  std::istreambuf_iterator<char> ());
+
+    Elf64_Ehdr ehdr;
+    if (!readAt (data, 0, ehdr)
+	|| std::memcmp (ehdr.e_ident, ELFMAG, SELFMAG) != 0)
+      return std::unexpected (std::format ("{}: not an ELF file", fileName));
+    if (ehdr.e_ident[EI_CLASS] != ELFCLASS64
+	|| ehdr.e_shentsize != sizeof (Elf64_Shdr))
+      return std::unexpected (
+	  std::format ("{}: only ELF64 is supported", fileName));
+
+    std::vector<Elf64_Shdr> sections (ehdr.e_shnum);
+    for (unsigned i = 0; i < ehdr.e_shnum; i++)
+      if (!readAt (data, ehdr.e_shoff + i * sizeof (Elf64_Shdr),
+		   sections[i]))
+	return std::unexpected (
+	    std::format ("{}: invalid section header", fileName));
+
+    Image image;
+    for (auto type : { SHT_SYMTAB, SHT_DYNSYM })
+      {
+	for (const auto &s : sections)
+	  if (s.sh_type == static_cast<Elf64_Word> (type)
+	      && s.sh_link < sections.size ()
+	      && !image.loadTable (data, s, sections[s.sh_link]))
+	    return std::unexpected (
+		std::format ("{}: invalid symbol table", fileName));
+	if (!image.functions.empty ())
+	  {
+	    image.staticTable = type == SHT_SYMTAB;
+	    break;
+	  }
+      }
+
+    for (auto *v : { &image.code, &image.objects })
+      std::sort (v->begin (), v->end (),
+		 [] (const Symbol &a, const Symbol &b) {
+		   return a.value < b.value;
+		 });
+    return image;
+  }
+
+  // Whether the symbols come from the static symbol table.
+  bool
+  hasStaticTable () const
+  {
+    return staticTable;
+  }
+
+  const Symbol *
+  function (const std::string &name) const
+  {
+    auto it = functions.find (name);
+    return it == functions.end () ? nullptr : &it->second;
+  }
+
+  // The functions whose name starts with PREFIX (the ifunc variants).
+  std::vector<const Symbol *>
+  functionsWithPrefix (const std::string &prefix) const
+  {
+    std::vector<const Symbol *> ret;
+    for (auto it = functions.lower_bound (prefix);
+	 it != functions.end () && it->first.starts_with (prefix); it++)
+      ret.push_back (&it->second);
+    return ret;
+  }
+
+  // The function that contains ADDR, if any.
+  const Symbol *
+  functionAt (std::uint64_t addr) const
+  {
+    return containing (code, addr);
+  }
+
+  // The data object that contains ADDR, if any.
+  const Symbol *
+  objectAt (std::uint64_t addr) const
+  {
+    return containing (objects, addr);
+  }
+};
+
+} // namespace elfsymbols
+
+#endif
@@ -0,0 +1,438 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// Static performance report of the libm functions, without running them:
+// the code size of each function and the size of the data tables it
+// references, from the ELF symbol tables and the objdump disassembly, and
+// the llvm-mca estimated reciprocal throughput and latency of its fast path
+// (the straight line code from the entry up to the first return, with the
+// branches removed).  With two libm builds the report compares them and
+// flags the functions whose code size, table size or throughput estimate
+// grows by more than the threshold:
+//
+//   libmreport /usr/lib/libm.so.6 build/math/libm.so
+//
+// The table sizes and the ifunc variants require the static symbol table,
+// so a non stripped libm build should be used.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include <omp.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "elfsymbols.h"
+#include "iohelper.h"
+#include "strhelper.h"
+
+using namespace iohelper;
+
+static const std::vector<std::string> kFunctions = {
+#define LIBM_FUNC_F(name) #name "f", #name,
+#define LIBM_FUNC_F_F(name) LIBM_FUNC_F (name)
+#define LIBM_FUNC_F_LLI(name) LIBM_FUNC_F (name)
+#define LIBM_FUNC_F_FP_FP(name) LIBM_FUNC_F (name)
+#include "libmfuncs.def"
+#undef LIBM_FUNC_F
+#undef LIBM_FUNC_F_F
+#undef LIBM_FUNC_F_LLI
+#undef LIBM_FUNC_F_FP_FP
+};
+
+struct Tools
+{
+  std::string objdump;
+  std::string llvmMca;
+  std::string mcpu;
+  // The ifunc variant analyzed (the __<function>_<variant> symbol).
+  std::string variant;
+  bool mca;
+};
+
+static std::string
+shellQuote (const std::string &s)
+{
+  std::string ret = "'";
+  for (char c : s)
+    if (c == '\'')
+      ret += "'\\''";
+    else
+      ret += c;
+  return ret + "'";
+}
+
+static std::expected<std::string, std::string>
+runCommand (const std::string &cmd)
+{
+  FILE *p = popen (cmd.c_str (), "r");
+  if (p == nullptr)
+    return std::unexpected (std::format ("failed to run: {}", cmd));
+  std::string out;
+  char buf[4096];
+  for (std::size_t n; (n = std::fread (buf, 1, sizeof (buf), p)) > 0;)
+    out.append (buf, n);
+  const int status = pclose (p);
+  if (status == -1 || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    return std::unexpected (std::format ("command failed: {}", cmd));
+  return out;
+}
+
+//
+// Report: the static figures of one function in one libm.
+//
+
+struct Report
+{
+  bool found = false;
+  // The symbol analyzed, an ifunc variant or the function itself.
+  std::string symbol;
+  std::uint64_t code = 0;
+  // The size of the referenced data objects, and the number of referenced
+  // addresses with no data object symbol (the .rodata constants).
+  std::uint64_t tables = 0;
+  std::uint64_t constants = 0;
+  std::size_t instructions = 0;
+  std::optional<double> rthroughput;
+  std::optional<double> latency;
+  std::string note;
+};
+
+// The symbol to analyze for FUNCTION: the requested ifunc variant, if the
+// function is an ifunc and the variant is in the static symbol table.
+static const elfsymbols::Symbol *
+resolveFunction (const elfsymbols::Image &image, const std::string &function,
+		 const std::string &variant, std::string &note)
+{
+  const elfsymbols::Symbol *sym = image.function (function);
+  if (sym == nullptr || sym->type != STT_GNU_IFUNC)
+    return sym;
+
+  const std::string prefix = "__" + function + "_";
+  auto variants = image.functionsWithPrefix (prefix);
+  for (const auto *v : variants)
+    if (v->name == prefix + variant)
+      return v;
+  // No variant requested or found: the first one, if any.
+  if (!variants.empty ())
+    {
+      note = std::format ("variant {} not found", variant);
+      return variants.front ();
+    }
+  note = "ifunc resolver";
+  return sym;
+}
+
+static const std::regex kAddressRe ("([0-9a-f]+) <[^>]+>");
+static const std::regex kCommentRe ("\\s+(#\\s|//).*$");
+
+// Whether the instruction INSN is a branch or a call (x86_64 and aarch64).
+static bool
+isBranch (const std::string &insn)
+{
+  const std::string mnemonic = insn.substr (0, insn.find_first_of (" \t"));
+  return mnemonic.starts_with ("j") || mnemonic.starts_with ("call")
+	 || mnemonic == "b" || mnemonic == "bl" || mnemonic.starts_with ("b.")
+	 || mnemonic.starts_with ("cb") || mnemonic.starts_with ("tb");
+}
+
+static std::optional<double>
+mcaValue (const std::string &out, const std::string &key)
+{
+  auto pos = out.find (key);
+  if (pos == std::string::npos)
+    return std::nullopt;
+  return std::strtod (out.c_str () + pos + key.size (), nullptr);
+}
+
+// Run llvm-mca on the fast path INSNS: the block reciprocal throughput and
+// the total cycles of a single iteration (the latency estimate).
+static void
+mcaEstimate (const std::vector<std::string> &insns, const Tools &tools,
+	     Report &report)
+{
+  char path[] = "/tmp/libmreport.XXXXXX";
+  const int fd = mkstemp (path);
+  if (fd == -1)
+    {
+      report.note = "can not create the llvm-mca input";
+      return;
+    }
+  close (fd);
+  {
+    std::ofstream f (path);
+    for (const auto &insn : insns)
+      f << insn << '\n';
+  }
+
+  const std::string cmd = std::format (
+      "{} -mcpu={} {} 2>/dev/null", shellQuote (tools.llvmMca),
+      shellQuote (tools.mcpu), shellQuote (path));
+  auto thr = runCommand (cmd + " -iterations=100");
+  auto lat = runCommand (cmd + " -iterations=1");
+  std::filesystem::remove (path);
+  if (!thr || !lat)
+    {
+      report.note = "llvm-mca failed";
+      return;
+    }
+  report.rthroughput = mcaValue (*thr, "Block RThroughput:");
+  report.latency = mcaValue (*lat, "Total Cycles:");
+}
+
+static Report
+analyze (const std::string &lib, const elfsymbols::Image &image,
+	 const std::string &function, const Tools &tools)
+{
+  Report report;
+  const elfsymbols::Symbol *sym
+      = resolveFunction (image, function, tools.variant, report.note);
+  if (sym == nullptr)
+    return report;
+  report.found = true;
+  report.symbol = sym->name;
+  report.code = sym->size;
+
+  auto out = runCommand (std::format (
+      "{} -d --no-show-raw-insn --start-address={:#x} --stop-address={:#x} "
+      "{}",
+      shellQuote (tools.objdump), sym->value, sym->value + sym->size,
+      shellQuote (lib)));
+  if (!out)
+    {
+      report.note = out.error ();
+      return report;
+    }
+
+  std::set<std::uint64_t> objects, constants;
+  std::vector<std::string> fastPath;
+  bool returned = false;
+  for (const auto &line : strhelper::splitWithRanges (*out, "\n"))
+    {
+      // "  addr:\tinstruction [# comment]"
+      auto tab = line.find (":\t");
+      if (tab == std::string::npos)
+	continue;
+      std::string insn = line.substr (tab + 2);
+
+      for (std::sregex_iterator it (insn.begin (), insn.end (), kAddressRe);
+	   it != std::sregex_iterator (); ++it)
+	{
+	  const std::uint64_t addr = std::stoull ((*it)[1], nullptr, 16);
+	  if (addr >= sym->value && addr < sym->value + sym->size)
+	    continue;
+	  if (const auto *obj = image.objectAt (addr))
+	    objects.insert (obj->value);
+	  else if (!isBranch (insn) && image.functionAt (addr) == nullptr)
+	    constants.insert (addr);
+	}
+
+      if (returned)
+	continue;
+      insn = std::regex_replace (insn, kCommentRe, "");
+      if (insn.starts_with ("ret"))
+	returned = true;
+      // The direct branches and calls (with a symbolic target) are not
+      // accepted by llvm-mca, and are not part of the fast path cost.
+      else if (insn.find ('<') == std::string::npos)
+	fastPath.push_back (insn);
+    }
+
+  for (auto addr : objects)
+    report.tables += image.objectAt (addr)->size;
+  report.constants = constants.size ();
+  report.instructions = fastPath.size ();
+
+  if (tools.mca && !fastPath.empty ())
+    mcaEstimate (fastPath, tools, report);
+  return report;
+}
+
+static std::string
+optionalStr (const std::optional<double> &v)
+{
+  return v ? std::format ("{:.2f}", *v) : "-";
+}
+
+// Whether NEW grew by more than THRESHOLD over BASE.
+static bool
+regressed (double base, double now, double threshold)
+{
+  return base > 0.0 ? now > base * threshold : false;
+}
+
+static void
+printSingle (const std::vector<std::string> &functions,
+	     const std::vector<Report> &reports)
+{
+  std::println ("{:<14} {:>8} {:>8} {:>6} {:>6} {:>9} {:>8}  {}",
+		"function", "code", "tables", "consts", "insns", "rthrough",
+		"latency", "symbol");
+  for (std::size_t i = 0; i < functions.size (); i++)
+    {
+      const Report &r = reports[i];
+      if (!r.found)
+	continue;
+      std::println ("{:<14} {:>8} {:>8} {:>6} {:>6} {:>9} {:>8}  {}{}",
+		    functions[i], r.code, r.tables, r.constants,
+		    r.instructions, optionalStr (r.rthroughput),
+		    optionalStr (r.latency), r.symbol,
+		    r.note.empty () ? "" : " (" + r.note + ")");
+    }
+}
+
+// Print the comparison of BASE and NOW, returns the number of flagged
+// functions.
+static std::size_t
+printCompare (const std::vector<std::string> &functions,
+	      const std::vector<Report> &base, const std::vector<Report> &now,
+	      double threshold)
+{
+  std::println ("{:<14} {:>17} {:>17} {:>13} {:>13}  {}", "function",
+		"code", "tables", "rthrough", "latency", "flags");
+  std::size_t flagged = 0;
+  for (std::size_t i = 0; i < functions.size (); i++)
+    {
+      const Report &b = base[i];
+      const Report &n = now[i];
+      if (!b.found && !n.found)
+	continue;
+
+      std::vector<std::string> flags;
+      if (!b.found || !n.found)
+	flags.push_back (b.found ? "removed" : "added");
+      else
+	{
+	  if (regressed (b.code, n.code, threshold))
+	    flags.push_back ("code");
+	  if (regressed (b.tables, n.tables, threshold))
+	    flags.push_back ("tables");
+	  if (b.rthroughput && n.rthroughput
+	      && regressed (*b.rthroughput, *n.rthroughput, threshold))
+	    flags.push_back ("throughput");
+	  if (b.latency && n.latency
+	      && regressed (*b.latency, *n.latency, threshold))
+	    flags.push_back ("latency");
+	}
+      if (!flags.empty () && b.found && n.found)
+	flagged++;
+
+      std::string flagStr;
+      for (const auto &f : flags)
+	flagStr += (flagStr.empty () ? "!" : ",") + f;
+      std::println (
+	  "{:<14} {:>8}/{:<8} {:>8}/{:<8} {:>6}/{:<6} {:>6}/{:<6}  {}",
+	  functions[i], b.code, n.code, b.tables, n.tables,
+	  optionalStr (b.rthroughput), optionalStr (n.rthroughput),
+	  optionalStr (b.latency), optionalStr (n.latency), flagStr);
+    }
+  return flagged;
+}
+
+int
+main (int argc, char *argv[])
+{
+  argparse::ArgumentParser options ("libmreport");
+
+  options.add_argument ("--symbol", "-s")
+      .help ("comma separated functions to report (default all the "
+	     "functions with a reference implementation)");
+
+  options.add_argument ("--variant")
+      .help ("ifunc variant to analyze, the __<function>_<variant> symbol")
+#if defined(__x86_64__)
+      .default_value ("fma");
+#elif defined(__aarch64__)
+      .default_value ("sve");
+#else
+      .default_value ("");
+#endif
+
+  options.add_argument ("--mcpu")
+      .help ("llvm-mca target CPU")
+      .default_value ("native");
+
+  options.add_argument ("--llvm-mca")
+      .help ("llvm-mca program")
+      .default_value ("llvm-mca");
+
+  options.add_argument ("--objdump")
+      .help ("objdump program")
+      .default_value ("objdump");
+
+  options.add_argument ("--no-mca")
+      .help ("do not run llvm-mca (only the code and table sizes)")
+      .flag ();
+
+  options.add_argument ("--threshold", "-t")
+      .help ("growth ratio flagged in the comparison")
+      .default_value (1.5)
+      .scan<'g', double> ();
+
+  options.add_argument ("libm")
+      .help ("libm shared object, and a second one to compare with")
+      .nargs (1, 2);
+
+  try
+    {
+      options.parse_args (argc, argv);
+    }
+  catch (const std::runtime_error &err)
+    {
+      error (std::string (err.what ()));
+    }
+
+  const Tools tools{ options.get<std::string> ("--objdump"),
+		     options.get<std::string> ("--llvm-mca"),
+		     options.get<std::string> ("--mcpu"),
+		     options.get<std::string> ("--variant"),
+		     !options.get<bool> ("--no-mca") };
+
+  std::vector<std::string> functions = kFunctions;
+  if (auto symbols = options.present ("-s"))
+    functions = strhelper::splitWithRanges (*symbols, ",");
+
+  const auto libs = options.get<std::vector<std::string> > ("libm");
+  std::vector<elfsymbols::Image> images;
+  for (const auto &lib : libs)
+    {
+      auto image = elfsymbols::Image::open (lib);
+      if (!image)
+	error ("{}", image.error ());
+      if (!image->hasStaticTable ())
+	printlnTimestamp ("{}: no static symbol table, the table sizes and "
+			  "ifunc variants are not available",
+			  lib);
+      images.push_back (std::move (image.value ()));
+    }
+
+  std::vector<std::vector<Report> > reports (
+      libs.size (), std::vector<Report> (functions.size ()));
+#pragma omp parallel for collapse(2) schedule(dynamic)
+  for (std::size_t l = 0; l < libs.size (); l++)
+    for (std::size_t f = 0; f < functions.size (); f++)
+      reports[l][f] = analyze (libs[l], images[l], functions[f], tools);
+
+  if (libs.size () == 1)
+    {
+      printSingle (functions, reports[0]);
+      return 0;
+    }
+
+  const std::size_t flagged = printCompare (functions, reports[0], reports[1],
+					    options.get<double> ("-t"));
+  std::println ("flagged {} function(s)", flagged);
+  return flagged == 0 ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _BENCHFUNCS_H
+#define _BENCHFUNCS_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "argtrace.h"
+#include "distribution.h"
+#include "wyhash64.h"
+
+//
+// benchfuncs: the libm functions of libmfuncs.def resolved with dlsym from
+//             the libm being measured, each one with a thunk that calls it
+//             with the arguments of an argtrace::Args record (the argument
+//             bit patterns), so different function types can be called
+//             from the same loop.
+//
+
+namespace benchfuncs
+{
+
+enum class Type
+{
+  F32,
+  F64,
+  F32_F32,
+  F64_F64,
+  F32_LLI,
+  F64_LLI,
+  F32_FP_FP,
+  F64_FP_FP,
+};
+
+inline bool
+isBinary32 (Type type)
+{
+  return type == Type::F32 || type == Type::F32_F32 || type == Type::F32_LLI
+	 || type == Type::F32_FP_FP;
+}
+
+// The argument trace type of TYPE (sincos records only have the input).
+inline argtrace::ArgType
+traceType (Type type)
+{
+  switch (type)
+    {
+    case Type::F32:
+    case Type::F32_FP_FP:
+      return argtrace::F32;
+    case Type::F64:
+    case Type::F64_FP_FP:
+      return argtrace::F64;
+    case Type::F32_F32:
+      return argtrace::F32_F32;
+    case Type::F64_F64:
+      return argtrace::F64_F64;
+    case Type::F32_LLI:
+      return argtrace::F32_LLI;
+    case Type::F64_LLI:
+      return argtrace::F64_LLI;
+    }
+  std::unreachable ();
+}
+
+typedef double (*Thunk) (void *, const argtrace::Args &);
+
+template <typename F>
+static double
+callF (void *fn, const argtrace::Args &a)
+{
+  return reinterpret_cast<F (*) (F)> (fn) (a.first<F> ());
+}
+
+template <typename F>
+static double
+callFF (void *fn, const argtrace::Args &a)
+{
+  return reinterpret_cast<F (*) (F, F)> (fn) (a.first<F> (), a.second<F> ());
+}
+
+template <typename F>
+static double
+callFLLI (void *fn, const argtrace::Args &a)
+{
+  return reinterpret_cast<F (*) (F, long long int)> (fn) (
+      a.first<F> (), static_cast<long long int> (a.y));
+}
+
+template <typename F>
+static double
+callFpFp (void *fn, const argtrace::Args &a)
+{
+  F r0, r1;
+  reinterpret_cast<void (*) (F, F *, F *)> (fn) (a.first<F> (), &r0, &r1);
+  return r0 + r1;
+}
+
+inline Thunk
+thunk (Type type)
+{
+  switch (type)
+    {
+    case Type::F32:
+      return callF<float>;
+    case Type::F64:
+      return callF<double>;
+    case Type::F32_F32:
+      return callFF<float>;
+    case Type::F64_F64:
+      return callFF<double>;
+    case Type::F32_LLI:
+      return callFLLI<float>;
+    case Type::F64_LLI:
+      return callFLLI<double>;
+    case Type::F32_FP_FP:
+      return callFpFp<float>;
+    case Type::F64_FP_FP:
+      return callFpFp<double>;
+    }
+  std::unreachable ();
+}
+
+struct Function
+{
+  std::string name;
+  Type type;
+  void *fn;
+  Thunk call;
+};
+
+struct Entry
+{
+  const char *name;
+  Type type;
+};
+
+static const Entry kFunctions[] = {
+#define LIBM_FUNC_F(name) { #name "f", Type::F32 }, { #name, Type::F64 },
+#define LIBM_FUNC_F_F(name)                                                   \
+  { #name "f", Type::F32_F32 }, { #name, Type::F64_F64 },
+#define LIBM_FUNC_F_LLI(name)                                                 \
+  { #name "f", Type::F32_LLI }, { #name, Type::F64_LLI },
+#define LIBM_FUNC_F_FP_FP(name)                                               \
+  { #name "f", Type::F32_FP_FP }, { #name, Type::F64_FP_FP },
+#include "libmfuncs.def"
+#undef LIBM_FUNC_F
+#undef LIBM_FUNC_F_F
+#undef LIBM_FUNC_F_LLI
+#undef LIBM_FUNC_F_FP_FP
+};
+
+// Resolve NAME in the libm HANDLE (from dlopen).
+inline std::expected<Function, std::string>
+load (void *handle, const std::string &name)
+{
+  auto it = std::find_if (std::begin (kFunctions), std::end (kFunctions),
+			  [&] (const Entry &e) { return name == e.name; });
+  if (it == std::end (kFunctions))
+    return std::unexpected (std::format ("unsupported function: {}", name));
+  void *fn = dlsym (handle, name.c_str ());
+  if (fn == nullptr)
+    return std::unexpected (
+	std::format ("libm does not provide {}", name));
+  return Function{ name, it->type, fn, thunk (it->type) };
+}
+
+// COUNT random argument records for FUNC, the floating point arguments drawn
+// from DIST in [START, END] and the integer ones uniformly in
+// [-INTRANGE, INTRANGE].
+inline std::vector<argtrace::Args>
+randomInputs (const Function &func, const distribution::Spec &dist,
+	      double start, double end, long long int intRange,
+	      std::size_t count, wyhash64 &rng)
+{
+  std::vector<argtrace::Args> ret (count, argtrace::Args{ 0, 0 });
+  auto fill = [&]<typename F> (bool second) {
+    std::vector<F> v (count);
+    distribution::Distribution<F> (dist, start, end)
+	.fill (rng, v.data (), v.size ());
+    for (std::size_t i = 0; i < count; i++)
+      {
+	std::uint64_t bits;
+	if constexpr (sizeof (F) == sizeof (std::uint32_t))
+	  bits = std::bit_cast<std::uint32_t> (v[i]);
+	else
+	  bits = std::bit_cast<std::uint64_t> (v[i]);
+	(second ? ret[i].y : ret[i].x) = bits;
+      }
+  };
+
+  if (isBinary32 (func.type))
+    fill.template operator()<float> (false);
+  else
+    fill.template operator()<double> (false);
+
+  switch (func.type)
+    {
+    case Type::F32_F32:
+      fill.template operator()<float> (true);
+      break;
+    case Type::F64_F64:
+      fill.template operator()<double> (true);
+      break;
+    case Type::F32_LLI:
+    case Type::F64_LLI:
+      {
+	std::uniform_int_distribution<long long int> d (-intRange, intRange);
+	for (auto &r : ret)
+	  r.y = static_cast<std::uint64_t> (d (rng));
+      }
+      break;
+    default:
+      break;
+    }
+  return ret;
+}
+
+// The arguments of FUNC captured by argcapture in the traces of PATH.
+inline std::expected<std::vector<argtrace::Args>, std::string>
+traceInputs (const Function &func, const std::string &path)
+{
+  std::vector<argtrace::Args> ret;
+  auto type = argtrace::readArguments (path, func.name, ret);
+  if (!type)
+    return std::unexpected (type.error ());
+  if (type.value () != traceType (func.type))
+    return std::unexpected (
+	std::format ("{}: invalid argument type for {}", path, func.name));
+  return ret;
+}
+
+} // namespace benchfuncs
+
+#endif
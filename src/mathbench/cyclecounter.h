@@ -0,0 +1,86 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _CYCLECOUNTER_H
+#define _CYCLECOUNTER_H
+
+#include <cstdint>
+#include <string_view>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+//
+// CycleCounter: the core cycles spent by the calling thread in user space,
+//               from the perf events hardware counter.  When it is not
+//               available (no PMU access, see perf_event_paranoid) the x86
+//               time stamp counter is used, which counts reference cycles at
+//               a fixed frequency, and on other architectures no cycle count
+//               is reported.
+//
+
+class CycleCounter
+{
+  int fd = -1;
+
+public:
+  CycleCounter ()
+  {
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof (attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  ~CycleCounter ()
+  {
+    if (fd != -1)
+      close (fd);
+  }
+
+  CycleCounter (const CycleCounter &) = delete;
+  CycleCounter &operator= (const CycleCounter &) = delete;
+
+  bool
+  available () const
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    return true;
+#else
+    return fd != -1;
+#endif
+  }
+
+  std::string_view
+  source () const
+  {
+    if (fd != -1)
+      return "core cycles";
+    return available () ? "TSC reference cycles" : "no cycle counter";
+  }
+
+  std::uint64_t
+  read () const
+  {
+    std::uint64_t v;
+    if (fd != -1 && ::read (fd, &v, sizeof (v)) == sizeof (v))
+      return v;
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc ();
+#else
+    return 0;
+#endif
+  }
+};
+
+#endif
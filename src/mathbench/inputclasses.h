@@ -0,0 +1,200 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _INPUTCLASSES_H
+#define _INPUTCLASSES_H
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "argtrace.h"
+#include "benchfuncs.h"
+#include "distribution.h"
+#include "floatranges.h"
+#include "wyhash64.h"
+
+//
+// inputclasses: the function arguments partitioned by the path they are
+//               expected to take, classified by the arguments and by the
+//               result of the call.  Subnormal operands trigger microcode
+//               assists on many cores, and the huge arguments and the results
+//               close to overflow or underflow usually take the slow paths
+//               of the implementations (large argument reduction, scaling of
+//               the result), so each class is timed on its own.
+//
+
+namespace inputclasses
+{
+
+enum class Class
+{
+  NORMAL,
+  SUBNORMAL_INPUT,  // A subnormal argument.
+  SUBNORMAL_OUTPUT, // A subnormal result from normal arguments.
+  SPECIAL,	    // A zero, infinity or NaN argument, or a NaN result.
+  HUGE_ARGUMENT,    // An argument that is an integer, |x| >= 2^precision.
+  NEAR_THRESHOLD,   // A result that overflows or is within 2^precision of
+		    // the overflow or underflow thresholds.
+};
+
+constexpr std::size_t kClasses = 6;
+
+static const char *const kNames[kClasses] = {
+  "normal", "subnormal-in", "subnormal-out", "zero/inf/nan", "huge",
+  "threshold",
+};
+
+typedef std::array<std::vector<argtrace::Args>, kClasses> Partition;
+
+inline bool
+twoFloats (benchfuncs::Type type)
+{
+  return type == benchfuncs::Type::F32_F32
+	 || type == benchfuncs::Type::F64_F64;
+}
+
+template <typename F>
+Class
+classify (const benchfuncs::Function &func, const argtrace::Args &a)
+{
+  const F args[] = { a.first<F> (), a.second<F> () };
+  const std::size_t nargs = twoFloats (func.type) ? 2 : 1;
+  const F huge = std::ldexp (F (1), std::numeric_limits<F>::digits);
+
+  bool isHuge = false;
+  for (std::size_t i = 0; i < nargs; i++)
+    if (args[i] == F (0) || !std::isfinite (args[i]))
+      return Class::SPECIAL;
+  for (std::size_t i = 0; i < nargs; i++)
+    {
+      if (std::fpclassify (args[i]) == FP_SUBNORMAL)
+	return Class::SUBNORMAL_INPUT;
+      isHuge |= std::fabs (args[i]) >= huge;
+    }
+
+  const F r = static_cast<F> (func.call (func.fn, a));
+  if (std::isnan (r))
+    return Class::SPECIAL;
+  if (std::fpclassify (r) == FP_SUBNORMAL)
+    return Class::SUBNORMAL_OUTPUT;
+  if (std::isinf (r) || std::fabs (r) >= std::numeric_limits<F>::max () / huge
+      || (r != F (0)
+	  && std::fabs (r) < std::numeric_limits<F>::min () * huge))
+    return Class::NEAR_THRESHOLD;
+  return isHuge ? Class::HUGE_ARGUMENT : Class::NORMAL;
+}
+
+// Replace BASE (drawn from the user distribution) with a value from one of
+// the classes generators, each with the same probability: BASE itself, any
+// encoding, a subnormal, a special value, a huge number or a number of
+// moderate magnitude (where most overflow and underflow thresholds are).
+template <typename F>
+F
+randomArgument (wyhash64 &rng, F base)
+{
+  using Limits = floatrange::Limits<F>;
+  typedef decltype (Limits::to (F ())) U;
+  constexpr U sign = Limits::NegSubnormalMin - Limits::PlusSubnormalMin;
+
+  auto random = [&] (int emin, int emax) {
+    std::uniform_int_distribution<int> e (emin, emax);
+    std::uniform_real_distribution<F> m (F (1), F (2));
+    const F v = std::ldexp (m (rng), e (rng));
+    return rng () & 1 ? -v : v;
+  };
+
+  switch (std::uniform_int_distribution<unsigned> (0, 5) (rng))
+    {
+    case 0:
+      return base;
+    case 1:
+      return Limits::from (static_cast<U> (rng ()));
+    case 2:
+      {
+	std::uniform_int_distribution<U> d (Limits::PlusSubnormalMin,
+					    Limits::PlusSubnormalMax);
+	return Limits::from (d (rng) | (rng () & 1 ? sign : 0));
+      }
+    case 3:
+      {
+	static const F specials[] = { F (0), -F (0),
+				      std::numeric_limits<F>::infinity (),
+				      -std::numeric_limits<F>::infinity (),
+				      std::numeric_limits<F>::quiet_NaN () };
+	return specials[std::uniform_int_distribution<std::size_t> (
+	    0, std::size (specials) - 1) (rng)];
+      }
+    case 4:
+      return random (std::numeric_limits<F>::digits,
+		     std::numeric_limits<F>::max_exponent - 1);
+    default:
+      return random (-16, 16);
+    }
+}
+
+// Add A to its class, up to COUNT inputs per class.
+template <typename F>
+void
+add (Partition &p, const benchfuncs::Function &func, const argtrace::Args &a,
+     std::size_t count)
+{
+  auto &v = p[static_cast<std::size_t> (classify<F> (func, a))];
+  if (v.size () < count)
+    v.push_back (a);
+}
+
+// Up to COUNT of INPUTS of each class (for the captured arguments).
+template <typename F>
+Partition
+partition (const benchfuncs::Function &func,
+	   const std::vector<argtrace::Args> &inputs, std::size_t count)
+{
+  Partition p;
+  for (const auto &a : inputs)
+    add<F> (p, func, a, count);
+  return p;
+}
+
+// COUNT random inputs of each class, drawn until every class is filled or
+// COUNT * 1024 candidates were tried (some classes might not exist for the
+// function, or be hard to hit).  The non floating point arguments are
+// random in [-INTRANGE, INTRANGE].
+template <typename F>
+Partition
+generate (const benchfuncs::Function &func, const distribution::Spec &dist,
+	  double start, double end, long long int intRange, std::size_t count,
+	  wyhash64 &rng)
+{
+  constexpr std::size_t kChunk = 4096;
+  Partition p;
+  auto full = [&] {
+    for (const auto &v : p)
+      if (v.size () < count)
+	return false;
+    return true;
+  };
+
+  for (std::size_t tried = 0; tried < count * 1024 && !full ();
+       tried += kChunk)
+    for (auto a : benchfuncs::randomInputs (func, dist, start, end, intRange,
+					    kChunk, rng))
+      {
+	a.x = floatrange::Limits<F>::to (randomArgument (rng, a.first<F> ()));
+	if (twoFloats (func.type))
+	  a.y = floatrange::Limits<F>::to (
+	      randomArgument (rng, a.second<F> ()));
+	add<F> (p, func, a, count);
+      }
+  return p;
+}
+
+} // namespace inputclasses
+
+#endif
@@ -0,0 +1,623 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// Throughput benchmarks of the libm functions, loaded with dlopen so any
+// libm build can be measured (see benchfuncs.h):
+//
+//   --mix exp,log:2,pow  interleaves the calls of the functions (with the
+//                        optional weights) in one loop, as the numeric
+//                        kernels do, and compares the mix time per call
+//                        with the one predicted from the isolated runs of
+//                        each function.  An efficiency below 1 is the cost
+//                        of the interference (the functions evicting each
+//                        other code, tables and branch predictor state).
+//                        Each function cycles over 256 of its inputs, so
+//                        the arguments stay in the L1 cache.
+//
+//   --vector sin,powf    runs the scalar functions and their libmvec
+//                        variants (see vecfuncs.h) over the same input
+//                        buffer, and reports the elements per cycle, the
+//                        speedup over scalar and how far the vector results
+//                        are from the scalar ones (max ULP difference and
+//                        the fraction of different results).
+//
+//   --classes exp,sin    times the functions on each class of inputs
+//                        (normal, subnormal argument or result, zero/inf/
+//                        NaN, huge arguments and results near the overflow
+//                        or underflow thresholds, see inputclasses.h), as
+//                        the latency of dependent calls and the throughput
+//                        of independent ones, with the slowdown of each
+//                        class relative to the normal inputs.
+//
+// The inputs are either the arguments captured by argcapture (--argtrace)
+// or random numbers in --range, drawn from --distribution.  Each timing is
+// the best of --repeat runs, single threaded.
+
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include "benchfuncs.h"
+#include "cyclecounter.h"
+#include "floatranges.h"
+#include "inputclasses.h"
+#include "iohelper.h"
+#include "strhelper.h"
+#include "ulpcheck.h"
+#include "vecfuncs.h"
+#include "wyhash64.h"
+
+using namespace iohelper;
+
+typedef std::chrono::steady_clock ClockType;
+
+// Keeps the results of the timed calls alive.
+static volatile double sink;
+
+// Always zero, the compiler can not tell: masks the result that each call
+// of a latency chain adds to the next argument.
+static volatile std::uint64_t chainMask = 0;
+
+static CycleCounter cycleCounter;
+
+template <typename T>
+static std::optional<T>
+parseUnsigned (const std::string &str)
+{
+  T v;
+  auto [ptr, ec] = std::from_chars (str.data (), str.data () + str.size (), v);
+  if (ec != std::errc{} || ptr != str.data () + str.size ())
+    return std::nullopt;
+  return v;
+}
+
+static std::pair<double, double>
+parseRange (const std::string &str)
+{
+  auto fields = strhelper::splitWithRanges (str, ",");
+  if (fields.size () == 2)
+    {
+      auto start = floatrange::fromStr<double> (fields[0]);
+      auto end = floatrange::fromStr<double> (fields[1]);
+      if (start && end && *start <= *end)
+	return { *start, *end };
+    }
+  error ("invalid range: {}", str);
+}
+
+//
+// Inputs: the function arguments and the way they are generated.
+//
+
+struct InputOptions
+{
+  std::optional<std::string> argtrace;
+  distribution::Spec dist;
+  double start;
+  double end;
+  long long int intRange;
+  std::size_t count;
+};
+
+static std::vector<argtrace::Args>
+functionInputs (const benchfuncs::Function &func, const InputOptions &opts,
+		wyhash64 &rng)
+{
+  if (opts.argtrace)
+    {
+      auto r = benchfuncs::traceInputs (func, *opts.argtrace);
+      if (!r)
+	error ("{}", r.error ());
+      return r.value ();
+    }
+  return benchfuncs::randomInputs (func, opts.dist, opts.start, opts.end,
+				   opts.intRange, opts.count, rng);
+}
+
+// The best time and cycles per element of REPEAT runs of RUN, which
+// evaluates ELEMENTS elements.
+struct Timing
+{
+  double ns;
+  double cycles;
+};
+
+template <typename RUN>
+static Timing
+timeRun (const RUN &run, std::size_t elements, unsigned repeat)
+{
+  Timing best{ std::numeric_limits<double>::infinity (),
+	       std::numeric_limits<double>::infinity () };
+  for (unsigned r = 0; r < repeat; r++)
+    {
+      auto start = ClockType::now ();
+      const std::uint64_t c0 = cycleCounter.read ();
+      run ();
+      const std::uint64_t c1 = cycleCounter.read ();
+      auto end = ClockType::now ();
+      const std::chrono::duration<double, std::nano> elapsed = end - start;
+      best.ns = std::min (best.ns, elapsed.count () / elements);
+      best.cycles = std::min (best.cycles, double (c1 - c0) / elements);
+    }
+  return best;
+}
+
+//
+// Mix: the functions called from the same loop.  The loop follows a short
+// periodic schedule of the function indices, and each function cycles over
+// a small ring of its inputs, so the schedule and the arguments stay in the
+// L1 cache and the loop only measures the calls and their interference.
+//
+
+// Inputs in the ring of each function, a power of 2.
+static constexpr std::size_t kRingInputs = 256;
+// Length of the random schedules.
+static constexpr std::size_t kRandomSchedule = 4096;
+
+struct MixEntry
+{
+  benchfuncs::Function func;
+  unsigned weight;
+  std::size_t inputs;
+  // kRingInputs of the inputs, evenly spaced (or repeated if there are
+  // fewer).
+  std::vector<argtrace::Args> ring;
+  std::size_t next = 0;
+};
+
+enum class Pattern
+{
+  ROUNDROBIN,  // The weighted sequence of the functions, repeated.
+  RANDOM,      // Each call picks a function with probability by weight.
+  BLOCKED,     // Runs of N calls of each function.
+};
+
+static std::pair<Pattern, std::size_t>
+patternFromOption (const std::string &str)
+{
+  if (str == "roundrobin")
+    return { Pattern::ROUNDROBIN, 1 };
+  if (str == "random")
+    return { Pattern::RANDOM, 1 };
+  if (str.starts_with ("blocked:"))
+    {
+      auto n = parseUnsigned<std::size_t> (str.substr (8));
+      if (n && *n > 0)
+	return { Pattern::BLOCKED, *n };
+    }
+  error ("invalid pattern: {} (roundrobin, random or blocked:N)", str);
+}
+
+static std::vector<MixEntry>
+parseMix (void *handle, const std::string &str, const InputOptions &opts,
+	  wyhash64 &rng)
+{
+  std::vector<MixEntry> mix;
+  for (const auto &item : strhelper::splitWithRanges (str, ","))
+    {
+      auto fields = strhelper::splitWithRanges (item, ":");
+      unsigned weight = 1;
+      if (fields.size () == 2)
+	{
+	  auto w = parseUnsigned<unsigned> (fields[1]);
+	  if (!w || *w == 0)
+	    error ("invalid mix weight: {}", item);
+	  weight = *w;
+	}
+      else if (fields.size () != 1)
+	error ("invalid mix entry: {}", item);
+
+      auto func = benchfuncs::load (handle, fields[0]);
+      if (!func)
+	error ("{}", func.error ());
+      auto inputs = functionInputs (func.value (), opts, rng);
+      if (inputs.empty ())
+	error ("no inputs for {}", fields[0]);
+      std::vector<argtrace::Args> ring (kRingInputs);
+      for (std::size_t i = 0; i < kRingInputs; i++)
+	ring[i] = inputs[inputs.size () <= kRingInputs
+			     ? i % inputs.size ()
+			     : i * inputs.size () / kRingInputs];
+      mix.push_back (
+	  MixEntry{ func.value (), weight, inputs.size (), std::move (ring) });
+    }
+  return mix;
+}
+
+// The function indices of one period of the schedule.
+static std::vector<std::uint16_t>
+mixSchedule (const std::vector<MixEntry> &mix, Pattern pattern,
+	     std::size_t block, wyhash64 &rng)
+{
+  std::vector<std::uint16_t> sequence;
+  for (std::size_t i = 0; i < mix.size (); i++)
+    sequence.insert (sequence.end (), mix[i].weight * block, i);
+  if (pattern != Pattern::RANDOM)
+    return sequence;
+
+  std::vector<std::uint16_t> schedule (kRandomSchedule);
+  std::uniform_int_distribution<std::size_t> d (0, sequence.size () - 1);
+  for (auto &i : schedule)
+    i = sequence[d (rng)];
+  return schedule;
+}
+
+// Best time per call of COUNT calls of the functions of MIX in the order of
+// SCHEDULE, repeated, in nanoseconds.
+static double
+timeCalls (std::vector<MixEntry> &mix,
+	   const std::vector<std::uint16_t> &schedule, std::size_t count,
+	   unsigned repeat)
+{
+  return timeRun (
+	     [&] {
+	       double acc = 0.0;
+	       std::size_t s = 0;
+	       for (std::size_t i = 0; i < count; i++)
+		 {
+		   MixEntry &m = mix[schedule[s]];
+		   acc += m.func.call (
+		       m.func.fn, m.ring[m.next++ & (kRingInputs - 1)]);
+		   s = s + 1 == schedule.size () ? 0 : s + 1;
+		 }
+	       sink = acc;
+	     },
+	     count, repeat)
+      .ns;
+}
+
+static void
+handleMix (void *handle, const std::string &mixStr,
+	   const std::string &patternStr, const InputOptions &opts,
+	   std::size_t calls, unsigned repeat, wyhash64 &rng)
+{
+  auto [pattern, block] = patternFromOption (patternStr);
+  auto mix = parseMix (handle, mixStr, opts, rng);
+
+  std::println ("{:<12} {:>6} {:>8} {:>12} {:>10}", "function", "weight",
+		"inputs", "ns/call", "Mcalls/s");
+
+  // The isolated runs, with the same call loop.
+  double predicted = 0.0;
+  unsigned weights = 0;
+  for (std::size_t i = 0; i < mix.size (); i++)
+    {
+      const auto &m = mix[i];
+      const double ns = timeCalls (
+	  mix, std::vector<std::uint16_t> (1, i), calls, repeat);
+      predicted += m.weight * ns;
+      weights += m.weight;
+      std::println ("{:<12} {:>6} {:>8} {:>12.3f} {:>10.2f}", m.func.name,
+		    m.weight, m.inputs, ns, 1e3 / ns);
+    }
+  predicted /= weights;
+
+  const double ns
+      = timeCalls (mix, mixSchedule (mix, pattern, block, rng), calls, repeat);
+  std::println ("{:<12} {:>6} {:>8} {:>12.3f} {:>10.2f}", "mix", weights,
+		"", ns, 1e3 / ns);
+  std::println ("pattern {}, predicted {:.3f} ns/call, efficiency {:.3f}",
+		patternStr, predicted, predicted / ns);
+}
+
+//
+// Vector: the libmvec variants against the scalar function.
+//
+
+// Elements per cycle, if there is a cycle counter.
+static std::string
+perCycle (const Timing &t)
+{
+  return cycleCounter.available () ? std::format ("{:.3f}", 1.0 / t.cycles)
+				    : "-";
+}
+
+template <typename F>
+static void
+vectorFunction (const benchfuncs::Function &func, void *mvec,
+		const std::vector<argtrace::Args> &inputs,
+		std::size_t elements, unsigned repeat)
+{
+  // The buffers hold a multiple of the widest vector, the inputs are
+  // repeated if needed.
+  constexpr std::size_t kMaxLanes = 64 / sizeof (F);
+  const std::size_t n
+      = (inputs.size () + kMaxLanes - 1) / kMaxLanes * kMaxLanes;
+  std::vector<F> x (n), y (n), scalar (n), vector (n);
+  for (std::size_t i = 0; i < n; i++)
+    {
+      x[i] = inputs[i % inputs.size ()].first<F> ();
+      y[i] = inputs[i % inputs.size ()].second<F> ();
+    }
+  const std::size_t passes = std::max<std::size_t> (elements / n, 1);
+
+  auto measure = [&] (vecfuncs::BufferLoop loop, void *fn, F *out) {
+    return timeRun (
+	[&] {
+	  for (std::size_t p = 0; p < passes; p++)
+	    loop (fn, x.data (), y.data (), out, n);
+	},
+	passes * n, repeat);
+  };
+
+  const Timing base = measure (vecfuncs::scalarLoop (func), func.fn,
+			       scalar.data ());
+  std::println ("{:<22} {:>5} {:>10} {:>9.3f} {:>8} {:>9} {:>8}", func.name,
+		1, perCycle (base), base.ns, "1.00", "-", "-");
+
+  for (const auto &v : vecfuncs::variants (func, mvec))
+    {
+      const Timing t = measure (v.loop, v.fn, vector.data ());
+
+      double maxUlp = 0.0;
+      std::size_t differ = 0;
+      for (std::size_t i = 0; i < n; i++)
+	{
+	  if (std::memcmp (&vector[i], &scalar[i], sizeof (F)) == 0
+	      || (std::isnan (vector[i]) && std::isnan (scalar[i])))
+	    continue;
+	  differ++;
+	  maxUlp = std::max (maxUlp, static_cast<double> (ulpError (
+					 vector[i], scalar[i])));
+	}
+      std::println ("{:<22} {:>5} {:>10} {:>9.3f} {:>8.2f} {:>9.1f} {:>7.2f}%",
+		    v.name, v.lanes, perCycle (t), t.ns, base.ns / t.ns,
+		    maxUlp, 100.0 * differ / n);
+    }
+}
+
+static void
+handleVector (void *handle, const std::string &libmvec,
+	      const std::string &functions, const InputOptions &opts,
+	      std::size_t elements, unsigned repeat, wyhash64 &rng)
+{
+  void *mvec = dlopen (libmvec.c_str (), RTLD_NOW | RTLD_LOCAL);
+  if (mvec == nullptr)
+    error ("{}", dlerror ());
+
+  std::println ("cycles: {}", cycleCounter.source ());
+  std::println ("{:<22} {:>5} {:>10} {:>9} {:>8} {:>9} {:>8}", "function",
+		"lanes", "elem/cycle", "ns/elem", "speedup", "ulp diff",
+		"differ");
+  for (const auto &name : strhelper::splitWithRanges (functions, ","))
+    {
+      auto func = benchfuncs::load (handle, name);
+      if (!func)
+	error ("{}", func.error ());
+      if (vecfuncs::scalarLoop (func.value ()) == nullptr)
+	{
+	  printlnTimestamp ("skipping {}: no vector variants for its type",
+			    name);
+	  continue;
+	}
+      auto inputs = functionInputs (func.value (), opts, rng);
+      if (inputs.empty ())
+	error ("no inputs for {}", name);
+
+      if (benchfuncs::isBinary32 (func->type))
+	vectorFunction<float> (func.value (), mvec, inputs, elements, repeat);
+      else
+	vectorFunction<double> (func.value (), mvec, inputs, elements,
+				repeat);
+    }
+}
+
+//
+// Classes: the functions timed on each class of inputs.
+//
+
+// The cycles per element, if there is a cycle counter.
+static std::string
+cycles (const Timing &t)
+{
+  return cycleCounter.available () ? std::format ("{:.1f}", t.cycles) : "-";
+}
+
+// Time CALLS calls of FUNC over INPUTS.  With CHAIN the argument of each
+// call depends on the result of the previous one (the latency), otherwise
+// the calls are independent (the throughput).  The results are combined as
+// bits, so subnormal results do not add floating point assists to the loop.
+template <bool CHAIN>
+static Timing
+timeFunction (const benchfuncs::Function &func,
+	      const std::vector<argtrace::Args> &inputs, std::size_t calls,
+	      unsigned repeat)
+{
+  const std::uint64_t mask = chainMask;
+  return timeRun (
+      [&] {
+	std::uint64_t acc = 0;
+	std::size_t j = 0;
+	for (std::size_t i = 0; i < calls; i++)
+	  {
+	    argtrace::Args a = inputs[j];
+	    if constexpr (CHAIN)
+	      a.x ^= acc & mask;
+	    acc ^= std::bit_cast<std::uint64_t> (func.call (func.fn, a));
+	    j = j + 1 == inputs.size () ? 0 : j + 1;
+	  }
+	sink = static_cast<double> (acc);
+      },
+      calls, repeat);
+}
+
+template <typename F>
+static void
+classesFunction (const benchfuncs::Function &func, const InputOptions &opts,
+		 std::size_t calls, unsigned repeat, wyhash64 &rng)
+{
+  inputclasses::Partition classes;
+  if (opts.argtrace)
+    classes = inputclasses::partition<F> (
+	func, functionInputs (func, opts, rng), opts.count);
+  else
+    classes = inputclasses::generate<F> (func, opts.dist, opts.start,
+					 opts.end, opts.intRange, opts.count,
+					 rng);
+
+  std::optional<double> normal;
+  for (std::size_t c = 0; c < inputclasses::kClasses; c++)
+    {
+      const auto &inputs = classes[c];
+      if (inputs.empty ())
+	{
+	  std::println ("{:<12} {:<13} {:>6}", func.name,
+			inputclasses::kNames[c], 0);
+	  continue;
+	}
+      const Timing lat = timeFunction<true> (func, inputs, calls, repeat);
+      const Timing thr = timeFunction<false> (func, inputs, calls, repeat);
+      if (c == static_cast<std::size_t> (inputclasses::Class::NORMAL))
+	normal = thr.ns;
+      std::println ("{:<12} {:<13} {:>6} {:>9.3f} {:>7} {:>9.3f} {:>7} "
+		    "{:>9.2f} {:>8}",
+		    func.name, inputclasses::kNames[c], inputs.size (), lat.ns,
+		    cycles (lat), thr.ns, cycles (thr), 1e3 / thr.ns,
+		    normal ? std::format ("{:.2f}", thr.ns / *normal) : "-");
+    }
+}
+
+static void
+handleClasses (void *handle, const std::string &functions,
+	       const InputOptions &opts, std::size_t calls, unsigned repeat,
+	       wyhash64 &rng)
+{
+  std::println ("cycles: {}", cycleCounter.source ());
+  std::println ("{:<12} {:<13} {:>6} {:>9} {:>7} {:>9} {:>7} {:>9} {:>8}",
+		"function", "class", "inputs", "lat ns", "cycles", "ns/call",
+		"cycles", "Mcalls/s", "slowdown");
+  for (const auto &name : strhelper::splitWithRanges (functions, ","))
+    {
+      auto func = benchfuncs::load (handle, name);
+      if (!func)
+	error ("{}", func.error ());
+      if (benchfuncs::isBinary32 (func->type))
+	classesFunction<float> (func.value (), opts, calls, repeat, rng);
+      else
+	classesFunction<double> (func.value (), opts, calls, repeat, rng);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  argparse::ArgumentParser options ("mathbench");
+
+  options.add_argument ("--libm")
+      .help ("libm shared object to benchmark")
+      .default_value ("libm.so.6");
+
+  options.add_argument ("--mix")
+      .help ("comma separated functions called in the same loop, with an "
+	     "optional weight (exp,log:2,pow)");
+
+  options.add_argument ("--pattern")
+      .help ("mix call pattern: roundrobin, random or blocked:N")
+      .default_value ("roundrobin");
+
+  options.add_argument ("--vector")
+      .help ("comma separated functions to compare with their libmvec "
+	     "variants");
+
+  options.add_argument ("--libmvec")
+      .help ("libmvec shared object")
+      .default_value ("libmvec.so.1");
+
+  options.add_argument ("--classes")
+      .help ("comma separated functions to time on each class of inputs");
+
+  options.add_argument ("--argtrace")
+      .help ("use the function arguments captured by argcapture (a trace "
+	     "file or directory)");
+
+  // Positive by default, so log and pow take their main path.
+  options.add_argument ("--range")
+      .help ("random inputs range (start,end)")
+      .default_value ("0.125,16");
+
+  options.add_argument ("--int-range")
+      .help ("random integer arguments range, [-N, N]")
+      .default_value (16ll)
+      .scan<'i', long long int> ();
+
+  options.add_argument ("--distribution")
+      .help ("random inputs distribution (see randfloatgen)")
+      .default_value ("uniform");
+
+  options.add_argument ("--inputs")
+      .help ("random inputs per function (or per class, for --classes)")
+      .default_value (std::size_t (4096))
+      .scan<'u', std::size_t> ();
+
+  options.add_argument ("--calls")
+      .help ("calls (or vector elements) per timed run")
+      .default_value (std::size_t (1) << 22)
+      .scan<'u', std::size_t> ();
+
+  options.add_argument ("--repeat")
+      .help ("timed runs, the best one is reported")
+      .default_value (5u)
+      .scan<'u', unsigned> ();
+
+  options.add_argument ("--seed")
+      .help ("random seed")
+      .default_value (std::uint64_t (0x5eed))
+      .scan<'u', std::uint64_t> ();
+
+  try
+    {
+      options.parse_args (argc, argv);
+    }
+  catch (const std::runtime_error &err)
+    {
+      error (std::string (err.what ()));
+    }
+
+  const std::string libm = options.get<std::string> ("--libm");
+  void *handle = dlopen (libm.c_str (), RTLD_NOW | RTLD_LOCAL);
+  if (handle == nullptr)
+    error ("{}", dlerror ());
+
+  InputOptions inputs;
+  inputs.argtrace = options.present ("--argtrace");
+  auto dist = distribution::Spec::parse (
+      options.get<std::string> ("--distribution"));
+  if (!dist)
+    error ("{}", dist.error ());
+  inputs.dist = dist.value ();
+  std::tie (inputs.start, inputs.end)
+      = parseRange (options.get<std::string> ("--range"));
+  inputs.intRange = options.get<long long int> ("--int-range");
+  inputs.count = options.get<std::size_t> ("--inputs");
+
+  const std::size_t calls = options.get<std::size_t> ("--calls");
+  const unsigned repeat = options.get<unsigned> ("--repeat");
+  if (calls == 0 || repeat == 0)
+    error ("--calls and --repeat should be positive");
+  wyhash64 rng (options.get<std::uint64_t> ("--seed"));
+
+  if (auto mix = options.present ("--mix"))
+    handleMix (handle, *mix, options.get<std::string> ("--pattern"), inputs,
+	       calls, repeat, rng);
+  else if (auto functions = options.present ("--vector"))
+    handleVector (handle, options.get<std::string> ("--libmvec"), *functions,
+		  inputs, calls, repeat, rng);
+  else if (auto functions = options.present ("--classes"))
+    handleClasses (handle, *functions, inputs, calls, repeat, rng);
+  else
+    error ("no --mix, --vector or --classes provided");
+
+  return 0;
+}
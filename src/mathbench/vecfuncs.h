@@ -0,0 +1,197 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+#ifndef _VECFUNCS_H
+#define _VECFUNCS_H
+
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "benchfuncs.h"
+
+//
+// vecfuncs: the libmvec variants of the scalar functions, named after the
+//           vector function ABI (_ZGV<isa>N<lanes><v per argument>_<name>),
+//           and the loops that evaluate a whole buffer with the scalar or
+//           vector function.  The vector loops are built for the ISA of each
+//           variant, so the vector arguments are passed in the registers the
+//           ABI expects; only the unmasked variants of the single and two
+//           argument floating point functions are handled.
+//
+
+namespace vecfuncs
+{
+
+// Evaluate FN on the N elements of X (and Y) into OUT, N being a multiple of
+// the vector lanes.
+typedef void (*BufferLoop) (void *fn, const void *x, const void *y, void *out,
+			    std::size_t n);
+
+template <typename F>
+static void
+scalarF (void *fn, const void *x, const void *, void *out, std::size_t n)
+{
+  auto f = reinterpret_cast<F (*) (F)> (fn);
+  const F *px = static_cast<const F *> (x);
+  F *po = static_cast<F *> (out);
+  for (std::size_t i = 0; i < n; i++)
+    po[i] = f (px[i]);
+}
+
+template <typename F>
+static void
+scalarFF (void *fn, const void *x, const void *y, void *out, std::size_t n)
+{
+  auto f = reinterpret_cast<F (*) (F, F)> (fn);
+  const F *px = static_cast<const F *> (x);
+  const F *py = static_cast<const F *> (y);
+  F *po = static_cast<F *> (out);
+  for (std::size_t i = 0; i < n; i++)
+    po[i] = f (px[i], py[i]);
+}
+
+// The vector loops of an ISA with BYTES wide vectors, built for the target
+// FEATURES.
+#define VECFUNCS_LOOPS(isa, bytes, features)                                  \
+  template <typename F>                                                       \
+  __attribute__ ((target (features))) static void vectorF_##isa (             \
+      void *fn, const void *x, const void *, void *out, std::size_t n)        \
+  {                                                                           \
+    typedef F V __attribute__ ((vector_size (bytes)));                        \
+    auto f = reinterpret_cast<V (*) (V)> (fn);                                \
+    const char *px = static_cast<const char *> (x);                           \
+    char *po = static_cast<char *> (out);                                     \
+    for (std::size_t i = 0; i < n * sizeof (F); i += bytes)                   \
+      {                                                                       \
+	V vx, r;                                                              \
+	std::memcpy (&vx, px + i, bytes);                                     \
+	r = f (vx);                                                           \
+	std::memcpy (po + i, &r, bytes);                                      \
+      }                                                                       \
+  }                                                                           \
+  template <typename F>                                                       \
+  __attribute__ ((target (features))) static void vectorFF_##isa (            \
+      void *fn, const void *x, const void *y, void *out, std::size_t n)       \
+  {                                                                           \
+    typedef F V __attribute__ ((vector_size (bytes)));                        \
+    auto f = reinterpret_cast<V (*) (V, V)> (fn);                             \
+    const char *px = static_cast<const char *> (x);                           \
+    const char *py = static_cast<const char *> (y);                           \
+    char *po = static_cast<char *> (out);                                     \
+    for (std::size_t i = 0; i < n * sizeof (F); i += bytes)                   \
+      {                                                                       \
+	V vx, vy, r;                                                          \
+	std::memcpy (&vx, px + i, bytes);                                     \
+	std::memcpy (&vy, py + i, bytes);                                     \
+	r = f (vx, vy);                                                       \
+	std::memcpy (po + i, &r, bytes);                                      \
+      }                                                                       \
+  }
+
+#if defined(__x86_64__)
+VECFUNCS_LOOPS (b, 16, "sse2")
+VECFUNCS_LOOPS (c, 32, "avx")
+VECFUNCS_LOOPS (d, 32, "avx2")
+VECFUNCS_LOOPS (e, 64, "avx512f")
+#elif defined(__aarch64__)
+VECFUNCS_LOOPS (n, 16, "+simd")
+#endif
+
+#undef VECFUNCS_LOOPS
+
+struct Isa
+{
+  char letter;
+  unsigned bytes;
+  // Whether the CPU can run the variants.
+  bool (*supported) ();
+  BufferLoop loopF[2];
+  BufferLoop loopFF[2];
+};
+
+#define VECFUNCS_ISA(isa, bytes, check)                                       \
+  { #isa[0],                                                                  \
+    bytes,                                                                    \
+    check,                                                                    \
+    { vectorF_##isa<float>, vectorF_##isa<double> },                          \
+    { vectorFF_##isa<float>, vectorFF_##isa<double> } }
+
+static const Isa kIsas[] = {
+#if defined(__x86_64__)
+  VECFUNCS_ISA (b, 16, [] { return true; }),
+  VECFUNCS_ISA (c, 32, [] { return bool (__builtin_cpu_supports ("avx")); }),
+  VECFUNCS_ISA (d, 32, [] { return bool (__builtin_cpu_supports ("avx2")); }),
+  VECFUNCS_ISA (e, 64,
+		[] { return bool (__builtin_cpu_supports ("avx512f")); }),
+#elif defined(__aarch64__)
+  VECFUNCS_ISA (n, 16, [] { return true; }),
+#endif
+};
+
+#undef VECFUNCS_ISA
+
+struct Variant
+{
+  std::string name;
+  unsigned lanes;
+  void *fn;
+  BufferLoop loop;
+};
+
+// The buffer loop of the scalar function FUNC.
+inline BufferLoop
+scalarLoop (const benchfuncs::Function &func)
+{
+  switch (func.type)
+    {
+    case benchfuncs::Type::F32:
+      return scalarF<float>;
+    case benchfuncs::Type::F64:
+      return scalarF<double>;
+    case benchfuncs::Type::F32_F32:
+      return scalarFF<float>;
+    case benchfuncs::Type::F64_F64:
+      return scalarFF<double>;
+    default:
+      return nullptr;
+    }
+}
+
+// The vector variants of FUNC in the libmvec HANDLE the CPU supports, in
+// the ISA order (narrowest first).
+inline std::vector<Variant>
+variants (const benchfuncs::Function &func, void *handle)
+{
+  if (scalarLoop (func) == nullptr)
+    return {};
+  const bool binary32 = benchfuncs::isBinary32 (func.type);
+  const bool twoArgs = func.type == benchfuncs::Type::F32_F32
+		       || func.type == benchfuncs::Type::F64_F64;
+  const unsigned size = binary32 ? sizeof (float) : sizeof (double);
+
+  std::vector<Variant> ret;
+  for (const auto &isa : kIsas)
+    {
+      const unsigned lanes = isa.bytes / size;
+      std::string name = std::format ("_ZGV{}N{}{}_{}", isa.letter, lanes,
+				      twoArgs ? "vv" : "v", func.name);
+      void *fn = dlsym (handle, name.c_str ());
+      if (fn == nullptr || !isa.supported ())
+	continue;
+      ret.push_back (Variant{ std::move (name), lanes, fn,
+			      (twoArgs ? isa.loopFF : isa.loopF)[!binary32] });
+    }
+  return ret;
+}
+
+} // namespace vecfuncs
+
+#endif
@@ -5,19 +5,30 @@
 //
 
 #include <algorithm>
+#include <charconv>
 #include <climits>
+#include <cstring>
+#include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
+#include <numbers>
 #include <random>
 #include <ranges>
 #include <string_view>
 #include <vector>
+#ifdef __STDCPP_FLOAT128_T__
+#include <stdfloat>
+#endif
 
 #include <argparse/argparse.hpp>
 
+#include "argtrace.h"
+#include "distribution.h"
 #include "floatranges.h"
 #include "iohelper.h"
 #include "strhelper.h"
+#include "workloadmodel.h"
 #include "wyhash64.h"
 
 using namespace iohelper;
@@ -32,133 +43,354 @@ init_random_state (void)
   return rng_t ((rng_t::state_type) rd () << 32 | rd ());
 }
 
+static std::string
+distribution_suffix (const distribution::Spec &dist)
+{
+  return dist.isUniform () ? "" : std::format (" ({})", dist.name);
+}
+
+// COUNT random numbers in [FSTART, FEND] drawn from DIST.
 template <typename F>
-static void
-gen_f (const std::optional<std::string> &nameopt,
-       const std::optional<std::string> &argsopt,
-       F fstart, F fend, int count,
-       bool append)
-{
-  std::string name;
-  if (nameopt.has_value ())
-    name = *nameopt;
+static std::vector<F>
+gen_values (rng_t &rng, const distribution::Spec &dist, F fstart, F fend,
+	    int count)
+{
+  std::vector<F> values (count);
+  distribution::Distribution<F> (dist, fstart, fend)
+      .fill (rng, values.data (), values.size ());
+  return values;
+}
+
+template <typename T>
+static std::string
+format_arg (T v)
+{
+  // The inputs are pasted in C initializers, so the extended types need
+  // their literal suffix to keep the full precision.
+  constexpr std::string_view suffix = std::is_same_v<T, long double> ? "L"
+#ifdef __STDCPP_FLOAT128_T__
+				      : std::is_same_v<T, std::float128_t>
+					  ? "f128"
+#endif
+					  : "";
+  if constexpr (std::is_floating_point_v<T>)
+    return std::format ("{}0x{:a}{}", v < T (0) ? "-" : "", std::fabs (v),
+			suffix);
   else
-    name = "random";
+    return std::format ("{}", v);
+}
 
+// Emit the arguments captured by argcapture for FUNCTION (see argtrace.h).
+template <typename X, typename Y>
+static void
+gen_argtrace_args (const std::string &name,
+		   const std::optional<std::string> &argsopt,
+		   const std::string &function,
+		   const std::vector<argtrace::Args> &args, bool has_y,
+		   bool append)
+{
   if (!append)
     {
-      std::string args;
       if (argsopt.has_value ())
 	std::println ("## args: {}", *argsopt);
+      else if (!has_y)
+	std::println ("## args: {}", floatrange::Limits<X>::name);
+      else if constexpr (std::is_floating_point_v<Y>)
+	std::println ("## args: {0}:{0}", floatrange::Limits<X>::name);
       else
-	{
-	  std::println ("## args: {}", floatrange::Limits<F>::name);
-	  std::println ("## ret: {}", floatrange::Limits<F>::name);
-	}
+	std::println ("## args: {}:long long int",
+		      floatrange::Limits<X>::name);
+      std::println ("## ret: {}", floatrange::Limits<X>::name);
       std::println ("## includes: math.h");
     }
 
   std::println ("## name: workload-{}", name);
-  std::println ("# Random inputs in [{:.2f},{:.2f}]", fstart, fend);
+  std::println ("# Captured {} arguments", function);
+
+  for (const auto &a : args)
+    if (has_y)
+      std::println ("{}, {}", format_arg (a.first<X> ()),
+		    format_arg (a.second<Y> ()));
+    else
+      std::println ("{}", format_arg (a.first<X> ()));
+}
 
-  rng_t rng = init_random_state ();
-  std::uniform_real_distribution<F> d (fstart, fend);
-  for (int i = 0; i < count; i++)
+static void
+gen_argtrace (const std::optional<std::string> &nameopt,
+	      const std::optional<std::string> &argsopt,
+	      const std::string &path, const std::string &function,
+	      bool append)
+{
+  const std::string name = nameopt.value_or (function);
+
+  std::vector<argtrace::Args> args;
+  auto type = argtrace::readArguments (path, function, args);
+  if (!type)
+    error ("{}", type.error ());
+
+  switch (type.value ())
     {
-      F f = d (rng);
-      bool isnegative = f < 0.0;
-      std::println ("{}0x{:a}", isnegative ? "-" : "", std::fabs (f));
+    case argtrace::F32:
+    case argtrace::F32_F32:
+      gen_argtrace_args<float, float> (name, argsopt, function, args,
+				       type.value () == argtrace::F32_F32,
+				       append);
+      break;
+    case argtrace::F64:
+    case argtrace::F64_F64:
+      gen_argtrace_args<double, double> (name, argsopt, function, args,
+					 type.value () == argtrace::F64_F64,
+					 append);
+      break;
+    case argtrace::F32_LLI:
+      gen_argtrace_args<float, long long int> (name, argsopt, function,
+					       args, true, append);
+      break;
+    case argtrace::F64_LLI:
+      gen_argtrace_args<double, long long int> (name, argsopt, function,
+						args, true, append);
+      break;
     }
 }
 
-template <typename F>
-static void
-gen_f_f (const std::optional<std::string> &nameopt,
-	 const std::optional<std::string> &argsopt,
-	 F fstart0, F fend0, F fstart1, F fend1, int count,
-	 bool append)
-{
-  std::string name;
-  if (nameopt.has_value ())
-    name = *nameopt;
-  else
-    name = "random";
+//
+// Workload synthesis: fit a workloadmodel::Model to captured or benchtest
+// arguments and draw new inputs from it.
+//
 
-  if (!append)
+using workloadmodel::ArgKind;
+
+// Whether PATH is an argument trace (or a directory of them) rather than a
+// benchtest input.
+static bool
+is_argtrace (const std::string &path)
+{
+  if (std::filesystem::is_directory (path))
+    return true;
+  std::ifstream file (path, std::ios::binary);
+  char magic[sizeof (argtrace::kMagic)] = {};
+  file.read (magic, sizeof (magic));
+  return std::memcmp (magic, argtrace::kMagic, sizeof (magic)) == 0;
+}
+
+static workloadmodel::Model
+fit_argtrace (const std::string &path, const std::string &function)
+{
+  std::vector<argtrace::Args> args;
+  auto type = argtrace::readArguments (path, function, args);
+  if (!type)
+    error ("{}", type.error ());
+
+  auto [size_x, size_y] = argtrace::argSizes (type.value ());
+  const ArgKind kind_x = size_x == 4 ? ArgKind::Binary32 : ArgKind::Binary64;
+  std::optional<ArgKind> kind_y;
+  if (type.value () == argtrace::F32_LLI
+      || type.value () == argtrace::F64_LLI)
+    kind_y = ArgKind::Int64;
+  else if (size_y != 0)
+    kind_y = kind_x;
+
+  workloadmodel::Model model (kind_x, kind_y);
+  for (const auto &a : args)
+    model.add (a.x, a.y);
+  return model;
+}
+
+static std::optional<ArgKind>
+benchtest_kind (std::string_view type)
+{
+  if (type == "float")
+    return ArgKind::Binary32;
+  else if (type == "double")
+    return ArgKind::Binary64;
+  else if (type == "int" || type == "long" || type == "long int"
+	   || type == "long long" || type == "long long int")
+    return ArgKind::Int64;
+  return std::nullopt;
+}
+
+static std::string_view
+benchtest_type (ArgKind kind)
+{
+  switch (kind)
     {
-      std::string args;
-      if (argsopt.has_value ())
-	args = *argsopt;
+    case ArgKind::Binary32:
+      return "float";
+    case ArgKind::Binary64:
+      return "double";
+    case ArgKind::Int64:
+      return "long long int";
+    }
+  return "";
+}
+
+static std::expected<std::uint64_t, std::string>
+parse_arg (ArgKind kind, const std::string &str)
+{
+  switch (kind)
+    {
+    case ArgKind::Binary32:
+      if (auto n = floatrange::fromStr<float> (str); n.has_value ())
+	return std::bit_cast<std::uint32_t> (n.value ());
+      else
+	return std::unexpected (n.error ());
+    case ArgKind::Binary64:
+      if (auto n = floatrange::fromStr<double> (str); n.has_value ())
+	return std::bit_cast<std::uint64_t> (n.value ());
       else
-	args = std::format ("## args {0}:{0}", floatrange::Limits<F>::name);
+	return std::unexpected (n.error ());
+    case ArgKind::Int64:
+      {
+	long long int v;
+	auto [p, ec] = std::from_chars (str.data (), str.data () + str.size (),
+					v);
+	if (ec != std::errc () || p != str.data () + str.size ())
+	  return std::unexpected (
+	      std::format ("invalid integer conversion: {}", str));
+	return static_cast<std::uint64_t> (v);
+      }
+    }
+  return std::unexpected (std::string ("invalid argument kind"));
+}
 
-      std::println ("## ret: {}", floatrange::Limits<F>::name);
-      std::println ("## includes: math.h");
+// Fit the model to a benchtest input, with the argument types from its
+// '## args' directive or, if there is none, all of type DEFAULT_KIND.
+static workloadmodel::Model
+fit_benchtest (const std::string &path, ArgKind default_kind)
+{
+  std::ifstream file (path);
+  if (!file.is_open ())
+    error ("opening file {}", path);
+
+  std::vector<ArgKind> kinds;
+  std::optional<workloadmodel::Model> model;
+
+  std::string line;
+  for (int line_number = 1; std::getline (file, line); line_number++)
+    {
+      if (line.starts_with ("##"))
+	{
+	  auto fields = strhelper::splitWithRanges (line.substr (2), ":");
+	  if (fields.size () < 2 || strhelper::trim (fields[0]) != "args")
+	    continue;
+	  if (model)
+	    error ("line {}: args directive after the inputs", line_number);
+	  kinds.clear ();
+	  for (std::size_t i = 1; i < fields.size (); i++)
+	    {
+	      auto kind = benchtest_kind (strhelper::trim (fields[i]));
+	      if (!kind)
+		error ("line {}: unsupported argument type {}", line_number,
+		       fields[i]);
+	      kinds.push_back (*kind);
+	    }
+	  continue;
+	}
+
+      // Skip blank lines and comments.
+      strhelper::trim (line);
+      if (line.empty () || line.starts_with ("#"))
+	continue;
+
+      auto numbers = strhelper::splitWithRanges (line, ",");
+      if (!model)
+	{
+	  if (kinds.empty ())
+	    kinds.assign (numbers.size (), default_kind);
+	  if (kinds.size () > 2)
+	    error ("{}: only one and two argument inputs are supported",
+		   path);
+	  model.emplace (kinds[0], kinds.size () == 2
+				       ? std::optional (kinds[1])
+				       : std::nullopt);
+	}
+      if (numbers.size () != kinds.size ())
+	error ("line {}: expected {} numbers: {}", line_number, kinds.size (),
+	       line);
+
+      std::uint64_t bits[2] = {};
+      for (std::size_t i = 0; i < kinds.size (); i++)
+	{
+	  auto n = parse_arg (kinds[i],
+			      std::string (strhelper::trim (
+				  std::string (numbers[i]))));
+	  if (!n)
+	    error ("line {} invalid number {}: {}", line_number, numbers[i],
+		   n.error ());
+	  bits[i] = n.value ();
+	}
+      model->add (bits[0], bits[1]);
     }
-  std::println ("## name: workload-{}", name);
-  std::println (
-      "# Random inputs with in in [{:.2f},{:.2f}] and y in [{:.2f},{:.2f}]",
-      fstart0, fend0, fstart1, fend1);
 
-  rng_t rng = init_random_state ();
-  std::uniform_real_distribution<F> d0 (fstart0, fend0);
-  std::uniform_real_distribution<F> d1 (fstart1, fend1);
-  for (int i = 0; i < count; i++)
+  if (!model)
+    error ("{}: no inputs", path);
+  return std::move (*model);
+}
+
+static workloadmodel::Model
+load_model (const std::string &path)
+{
+  std::ifstream file (path);
+  if (!file.is_open ())
+    error ("opening file {}", path);
+  auto model = workloadmodel::Model::parse (file);
+  if (!model)
+    error ("{}: {}", path, model.error ());
+  return std::move (model.value ());
+}
+
+static std::string
+format_bits (ArgKind kind, std::uint64_t bits)
+{
+  switch (kind)
     {
-      F f0 = d0 (rng);
-      F f1 = d1 (rng);
-      bool isnegative0 = f0 < 0.0;
-      bool isnegative1 = f1 < 0.0;
-      std::println ("{}0x{:a}, {}0x{:a}", isnegative0 ? "-" : "",
-		    std::fabs (f0), isnegative1 ? "-" : "", std::fabs (f1));
+    case ArgKind::Binary32:
+      return format_arg (
+	  std::bit_cast<float> (static_cast<std::uint32_t> (bits)));
+    case ArgKind::Binary64:
+      return format_arg (std::bit_cast<double> (bits));
+    case ArgKind::Int64:
+      return format_arg (static_cast<long long int> (bits));
     }
+  return "";
 }
 
-template <typename F>
 static void
-gen_f_f_f (const std::optional<std::string> &nameopt,
-	   const std::optional<std::string> &argsopt, F fstart0, F fend0,
-	   F fstart1, F fend1, F fstart2, F fend2, int count,
-	   bool append)
-{
-  std::string name;
-  if (nameopt.has_value ())
-    name = *nameopt;
-  else
-    name = "random";
+gen_model (const workloadmodel::Model &model,
+	   const std::optional<std::string> &nameopt,
+	   const std::optional<std::string> &argsopt,
+	   const std::string &source, int count, bool append)
+{
+  const std::string name = nameopt.value_or ("synthetic");
 
   if (!append)
     {
-      std::string args;
       if (argsopt.has_value ())
 	std::println ("## args: {}", *argsopt);
+      else if (model.kindY)
+	std::println ("## args: {}:{}", benchtest_type (model.kindX),
+		      benchtest_type (*model.kindY));
       else
-	std::println ("## args: {0}:{0}:{0}", floatrange::Limits<F>::name);
-
-      std::println ("## ret: {}", floatrange::Limits<F>::name);
+	std::println ("## args: {}", benchtest_type (model.kindX));
+      std::println ("## ret: {}", benchtest_type (model.kindX));
       std::println ("## includes: math.h");
     }
+
   std::println ("## name: workload-{}", name);
-  std::println (
-      "# Random inputs with in in [{:.2f},{:.2f}], y in [{:.2f},{:.2f}], "
-      "and z in [{:.2f},{:.2f}]",
-      fstart0, fend0, fstart1, fend1, fstart2, fend2);
+  std::println ("# Synthetic inputs from a model of {} samples in {} "
+		"classes ({})",
+		model.samples (), model.classes (), source);
 
   rng_t rng = init_random_state ();
-  std::uniform_real_distribution<F> d0 (fstart0, fend0);
-  std::uniform_real_distribution<F> d1 (fstart1, fend1);
-  std::uniform_real_distribution<F> d2 (fstart2, fend2);
+  workloadmodel::Sampler sampler (model);
   for (int i = 0; i < count; i++)
     {
-      F f0 = d0 (rng);
-      F f1 = d1 (rng);
-      F f2 = d2 (rng);
-      bool isnegative0 = f0 < 0.0;
-      bool isnegative1 = f1 < 0.0;
-      bool isnegative2 = f2 < 0.0;
-      std::println ("{}0x{:a}, {}0x{:a}, {}0x{:a}", isnegative0 ? "-" : "",
-		    std::fabs (f0), isnegative1 ? "-" : "", std::fabs (f1),
-		    isnegative2 ? "-" : "", std::fabs (f2));
+      auto [x, y] = sampler (rng);
+      if (model.kindY)
+	std::println ("{}, {}", format_bits (model.kindX, x),
+		      format_bits (*model.kindY, y));
+      else
+	std::println ("{}", format_bits (model.kindX, x));
     }
 }
 
@@ -206,42 +438,250 @@ rangeStrToFloat (const std::vector<std::string> &values)
   return std::vector<F> (floatview.begin (), floatview.end ());
 }
 
+//
+// Random workloads: each of -x, -y and -z is either '<start> <end>', of the
+// --type type, or a single 'TYPE:START:END' spec, so functions with mixed
+// argument types (pown, rootn or compoundn) are also covered.
+//
+
+enum class ArgType
+{
+  BINARY32,
+  BINARY64,
+  LDOUBLE,
+  BINARY128,
+  INT32,
+  INT64
+};
+
+struct ArgTypeInfo
+{
+  ArgType type;
+  std::string_view name;
+  std::string_view ctype;
+};
+
+static constexpr ArgTypeInfo kArgTypes[] = {
+  { ArgType::BINARY32, "binary32", "float" },
+  { ArgType::BINARY64, "binary64", "double" },
+  { ArgType::LDOUBLE, "ldouble", "long double" },
+#ifdef __STDCPP_FLOAT128_T__
+  { ArgType::BINARY128, "binary128", "_Float128" },
+#endif
+  { ArgType::INT32, "int32", "int" },
+  { ArgType::INT64, "int64", "long long int" },
+};
+
+static const ArgTypeInfo *
+find_arg_type (std::string_view name)
+{
+  for (const auto &t : kArgTypes)
+    if (t.name == name)
+      return &t;
+  return nullptr;
+}
+
+static std::string
+arg_type_names ()
+{
+  std::string ret;
+  for (const auto &t : kArgTypes)
+    ret += std::format ("{}{}", ret.empty () ? "" : ", ", t.name);
+  return ret;
+}
+
+static bool
+is_integer_type (ArgType type)
+{
+  return type == ArgType::INT32 || type == ArgType::INT64;
+}
+
+struct ArgSpec
+{
+  const ArgTypeInfo *type;
+  std::string start;
+  std::string end;
+};
+
+static ArgSpec
+parse_arg_spec (std::string_view arg, const std::vector<std::string> &values,
+		const std::string &default_type)
+{
+  std::string type = default_type;
+  std::string start, end;
+  if (values.size () == 2)
+    {
+      start = values[0];
+      end = values[1];
+    }
+  else
+    {
+      auto fields = strhelper::splitWithRanges (values[0], ":");
+      if (fields.size () != 3)
+	error ("invalid {} argument: {} (expected TYPE:START:END or "
+	       "'START END')",
+	       arg, values[0]);
+      type = fields[0];
+      start = fields[1];
+      end = fields[2];
+    }
+
+  const ArgTypeInfo *info = find_arg_type (type);
+  if (info == nullptr)
+    error ("invalid type {} for {} (valid types: {})", type, arg,
+	   arg_type_names ());
+  return ArgSpec{ info, start, end };
+}
+
+// The generated numbers of an argument, already formatted.
+struct ArgColumn
+{
+  std::vector<std::string> values;
+  std::string range;
+};
+
+// A uniform number in [START, END] with the precision of the extended
+// types (the fixed point distribution maps only use 53 random bits).
 template <typename F>
-static void
-handleType (const argparse::ArgumentParser &options,
-	    const std::optional<std::string> &name,
-	    const std::optional<std::string> &args,
-	    int count,
-	    bool append)
-{
-  auto range_x
-      = rangeStrToFloat<F> (options.get<std::vector<std::string> > ("-x"));
-  if (range_x[0] > range_x[1])
-    error ("invalid range definitions [{},{}]", range_x[0], range_x[1]);
-
-  if (!options.is_used ("-y"))
-    gen_f<F> (name, args, range_x[0], range_x[1], count, append);
+static F
+uniform_extended (rng_t &rng, F start, F end)
+{
+  const F t = static_cast<F> (rng () >> 11) * static_cast<F> (0x1p-53)
+	      + static_cast<F> (rng () >> 11) * static_cast<F> (0x1p-106);
+  return std::clamp (start * (1 - t) + end * t, start, end);
+}
+
+template <typename F>
+static ArgColumn
+gen_float_column (rng_t &rng, const distribution::Spec &dist,
+		  const ArgSpec &spec, int count)
+{
+  auto range = rangeStrToFloat<F> ({ spec.start, spec.end });
+  if (range[0] > range[1])
+    error ("invalid range definitions [{},{}]", spec.start, spec.end);
+
+  std::vector<F> values;
+  if constexpr (std::is_same_v<F, float> || std::is_same_v<F, double>)
+    values = gen_values (rng, dist, range[0], range[1], count);
   else
     {
-      auto range_y
-	  = rangeStrToFloat<F> (options.get<std::vector<std::string> > ("-y"));
-      if (range_y[0] > range_y[1])
-	error ("invalid range definitions [{},{}]", range_y[0], range_y[1]);
-
-      if (!options.is_used ("-z"))
-	gen_f_f<F> (name, args, range_x[0], range_x[1], range_y[0], range_y[1],
-		    count, append);
+      if (!dist.isUniform ())
+	error ("distribution {} is not supported for {}", dist.name,
+	       spec.type->name);
+      values.resize (count);
+      for (auto &v : values)
+	v = uniform_extended (rng, range[0], range[1]);
+    }
+
+  ArgColumn c{ {}, std::format ("[{:.2f},{:.2f}]", range[0], range[1]) };
+  c.values.reserve (count);
+  for (F v : values)
+    c.values.push_back (format_arg (v));
+  return c;
+}
+
+template <typename I>
+static ArgColumn
+gen_int_column (rng_t &rng, const ArgSpec &spec, int count)
+{
+  I range[2];
+  for (int i = 0; i < 2; i++)
+    {
+      const std::string s
+	  = adjustSignal (std::string (strhelper::trim (i == 0 ? spec.start
+							       : spec.end)));
+      auto [p, ec] = std::from_chars (s.data (), s.data () + s.size (),
+				      range[i]);
+      if (ec != std::errc () || p != s.data () + s.size ())
+	error ("invalid {} number: {}", spec.type->name, s);
+    }
+  if (range[0] > range[1])
+    error ("invalid range definitions [{},{}]", range[0], range[1]);
+
+  ArgColumn c{ {}, std::format ("[{},{}]", range[0], range[1]) };
+  std::uniform_int_distribution<I> d (range[0], range[1]);
+  c.values.reserve (count);
+  for (int i = 0; i < count; i++)
+    c.values.push_back (format_arg (d (rng)));
+  return c;
+}
+
+static ArgColumn
+gen_column (rng_t &rng, const distribution::Spec &dist, const ArgSpec &spec,
+	    int count)
+{
+  switch (spec.type->type)
+    {
+    case ArgType::BINARY32:
+      return gen_float_column<float> (rng, dist, spec, count);
+    case ArgType::BINARY64:
+      return gen_float_column<double> (rng, dist, spec, count);
+    case ArgType::LDOUBLE:
+      return gen_float_column<long double> (rng, dist, spec, count);
+    case ArgType::BINARY128:
+#ifdef __STDCPP_FLOAT128_T__
+      return gen_float_column<std::float128_t> (rng, dist, spec, count);
+#else
+      break;
+#endif
+    case ArgType::INT32:
+      return gen_int_column<int> (rng, spec, count);
+    case ArgType::INT64:
+      return gen_int_column<long long int> (rng, spec, count);
+    }
+  std::unreachable ();
+}
+
+static void
+gen_args (const std::vector<ArgSpec> &specs,
+	  const std::optional<std::string> &nameopt,
+	  const std::optional<std::string> &argsopt,
+	  const distribution::Spec &dist, int count, bool append)
+{
+  const std::string name = nameopt.value_or ("random");
+
+  if (!append)
+    {
+      if (argsopt.has_value ())
+	std::println ("## args: {}", *argsopt);
       else
 	{
-	  auto range_z = rangeStrToFloat<F> (
-	      options.get<std::vector<std::string> > ("-z"));
-	  if (range_z[0] > range_z[1])
-	    error ("invalid range definitions [{},{}]", range_z[0],
-		   range_z[1]);
-
-	  gen_f_f_f<F> (name, args, range_x[0], range_x[1], range_y[0],
-			range_y[1], range_z[0], range_z[1], count, append);
+	  std::string args;
+	  for (const auto &s : specs)
+	    args += std::format ("{}{}", args.empty () ? "" : ":",
+				 s.type->ctype);
+	  std::println ("## args: {}", args);
 	}
+      // The return type is the one of the first floating point argument.
+      auto ret = std::find_if (specs.begin (), specs.end (),
+			       [] (const ArgSpec &s) {
+				 return !is_integer_type (s.type->type);
+			       });
+      std::println ("## ret: {}", ret != specs.end () ? ret->type->ctype
+						      : specs[0].type->ctype);
+      std::println ("## includes: math.h");
+    }
+
+  rng_t rng = init_random_state ();
+  std::vector<ArgColumn> columns;
+  for (const auto &s : specs)
+    columns.push_back (gen_column (rng, dist, s, count));
+
+  std::println ("## name: workload-{}", name);
+  std::string ranges;
+  static constexpr std::string_view kArgNames[] = { "x", "y", "z" };
+  for (std::size_t i = 0; i < columns.size (); i++)
+    ranges += std::format ("{}{} in {}", i == 0 ? "" : ", ", kArgNames[i],
+			   columns[i].range);
+  std::println ("# Random inputs with {}{}", ranges,
+		distribution_suffix (dist));
+
+  for (int i = 0; i < count; i++)
+    {
+      std::string line;
+      for (const auto &c : columns)
+	line += std::format ("{}{}", line.empty () ? "" : ", ", c.values[i]);
+      std::println ("{}", line);
     }
 }
 
@@ -252,22 +692,22 @@ main (int argc, char *argv[])
 
   std::string type;
   options.add_argument ("--type", "-t")
-      .help (std::format ("floating type to use"))
+      .help (std::format ("type of the '<start> <end>' ranges ({})",
+			  arg_type_names ()))
       .default_value ("binary32")
       .store_into (type);
 
-  options.add_argument ("-x")
-      .help ("range to use in the form '<start> <end>'")
-      .required ()
-      .nargs (2);
-
-  options.add_argument ("-y")
-      .help ("range to use in the form '<start> <end>'")
-      .nargs (2);
+  for (const char *arg : { "-x", "-y", "-z" })
+    options.add_argument (arg)
+	.help ("range to use in the form '<start> <end>' or "
+	       "'<type>:<start>:<end>'")
+	.nargs (1, 2);
 
-  options.add_argument ("-z")
-      .help ("range to use in the form '<start> <end>'")
-      .nargs (2);
+  options.add_argument ("--distribution", "-d")
+      .help ("distribution of the random numbers: uniform, log-uniform, "
+	     "bits, binade, normal:MU:SIGMA, lognormal:MU:SIGMA, or a "
+	     "mixture W1*DIST1+W2*DIST2...")
+      .default_value (std::string ("uniform"));
 
   options.add_argument ("--count", "-c")
       .help (std::format ("numbers to generate (default {}", kDefaultCount))
@@ -277,6 +717,21 @@ main (int argc, char *argv[])
   options.add_argument ("--name", "-n");
   options.add_argument ("--args", "-a");
 
+  options.add_argument ("--argtrace")
+      .help ("emit the arguments captured by argcapture (a trace file or "
+	     "directory) for the --symbol function instead of random ones");
+  options.add_argument ("--symbol", "-s")
+      .help ("function of the --argtrace arguments");
+
+  options.add_argument ("--fit")
+      .help ("fit a workload model (per-binade weights and mantissa "
+	     "histograms) to the arguments of an argtrace, with --symbol, or "
+	     "of a benchtest input, and generate --count inputs from it");
+  options.add_argument ("--model")
+      .help ("generate --count inputs from a model saved with --save-model");
+  options.add_argument ("--save-model")
+      .help ("save the --fit model to a file instead of generating inputs");
+
   options.add_argument ("--append")
      .default_value (false)
      .implicit_value (true);
@@ -297,14 +752,70 @@ main (int argc, char *argv[])
     name = options.get<std::string> ("--name");
   std::optional<std::string> args;
   if (options.is_used ("--args"))
-    name = options.get<std::string> ("--args");
+    args = options.get<std::string> ("--args");
 
   bool append = options.get<bool>("--append");
 
-  if (type == "binary32")
-    handleType<float> (options, name, args, count, append);
-  else if (type == "binary64")
-    handleType<double> (options, name, args, count, append);
-  else
-    error ("invalid type{}", type);
+  if (options.is_used ("--fit") || options.is_used ("--model"))
+    {
+      std::string source;
+      std::optional<workloadmodel::Model> model;
+      if (auto path = options.present ("--model"))
+	{
+	  source = *path;
+	  model.emplace (load_model (*path));
+	}
+      else if (auto path = options.present ("--fit"); is_argtrace (*path))
+	{
+	  auto symbol = options.present ("--symbol");
+	  if (!symbol)
+	    error ("--fit {} requires --symbol", *path);
+	  source = std::format ("{} {}", *path, *symbol);
+	  model.emplace (fit_argtrace (*path, *symbol));
+	}
+      else
+	{
+	  source = *path;
+	  model.emplace (fit_benchtest (*path, type == "binary64"
+						   ? ArgKind::Binary64
+						   : ArgKind::Binary32));
+	}
+
+      if (auto out = options.present ("--save-model"))
+	{
+	  std::ofstream file (*out);
+	  if (!(file << model->serialize ()))
+	    error ("writing {}", *out);
+	}
+      else
+	gen_model (*model, name, args, source, count, append);
+      return 0;
+    }
+
+  if (auto path = options.present ("--argtrace"))
+    {
+      auto symbol = options.present ("--symbol");
+      if (!symbol)
+	error ("--argtrace {} requires --symbol", *path);
+      gen_argtrace (name, args, *path, *symbol, append);
+      return 0;
+    }
+
+  auto dist = distribution::Spec::parse (
+      options.get<std::string> ("--distribution"));
+  if (!dist)
+    error ("{}", dist.error ());
+
+  std::vector<ArgSpec> specs;
+  for (const char *arg : { "-x", "-y", "-z" })
+    {
+      if (!options.is_used (arg))
+	break;
+      specs.push_back (parse_arg_spec (
+	  arg, options.get<std::vector<std::string> > (arg), type));
+    }
+  if (specs.empty ())
+    error ("no {} range provided", "-x");
+
+  gen_args (specs, name, args, dist.value (), count, append);
 }
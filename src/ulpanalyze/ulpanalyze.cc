@@ -0,0 +1,457 @@
+//
+// Copyright (c) Adhemerval Zanella. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for
+// details.
+//
+
+// Offline analysis of the checkulps --trace files: the blocks of all the
+// input traces are decoded in parallel, filtered, and accumulated in a
+// histogram keyed by a user selected property of each evaluation, without
+// re-running the libm or the MPFR reference.
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+
+#include <fenv.h>
+#include <omp.h>
+
+#include "floatranges.h"
+#include "iohelper.h"
+#include "strhelper.h"
+#include "tracefile.h"
+#include "ulpcheck.h"
+
+using namespace iohelper;
+
+static const std::map<std::string_view, int> kRoundModes
+    = { { "rndn", FE_TONEAREST },
+	{ "rndu", FE_UPWARD },
+	{ "rndd", FE_DOWNWARD },
+	{ "rndz", FE_TOWARDZERO } };
+
+static std::string_view
+roundName (int rnd)
+{
+  for (const auto &[name, mode] : kRoundModes)
+    if (mode == rnd)
+      return name;
+  return "unknown";
+}
+
+//
+// Histogram keys: the property of each evaluation used to bucket it.
+//
+
+enum class Key
+{
+  ULP,       // ULP error.
+  ROUNDING,  // Rounding mode.
+  SIGN,      // Sign of computed - expected (-1, 0, 1).
+  EXPONENT,  // Binade of the first argument.
+  MANTISSA,  // Leading N mantissa bits of the first argument.
+  ARG2,      // Binade of the second argument (or its integer value).
+};
+
+struct KeySpec
+{
+  Key key;
+  unsigned bits;
+};
+
+static KeySpec
+keyFromOption (const std::string &str)
+{
+  auto fields = strhelper::splitWithRanges (str, ":");
+  if (fields[0] == "ulp")
+    return { Key::ULP, 0 };
+  else if (fields[0] == "rounding")
+    return { Key::ROUNDING, 0 };
+  else if (fields[0] == "sign")
+    return { Key::SIGN, 0 };
+  else if (fields[0] == "exponent")
+    return { Key::EXPONENT, 0 };
+  else if (fields[0] == "arg2")
+    return { Key::ARG2, 0 };
+  else if (fields[0] == "mantissa")
+    {
+      unsigned bits = 4;
+      if (fields.size () == 2)
+	bits = std::stoul (fields[1]);
+      if (bits == 0 || bits > 16)
+	error ("invalid mantissa bits: {} (expected 1 to 16)", str);
+      return { Key::MANTISSA, bits };
+    }
+  error ("invalid histogram key: {}", str);
+}
+
+struct Filter
+{
+  std::vector<int> roundModes;
+  double minUlp;
+  double maxUlp;
+  bool failuresOnly;
+  double failureUlp;
+};
+
+struct Bucket
+{
+  std::uint64_t count = 0;
+  double maxUlp = 0.0;
+};
+
+typedef std::map<double, Bucket> Histogram;
+
+struct Match
+{
+  int rounding;
+  double ulp;
+  tracefile::Record record;
+};
+
+template <typename F> struct Analyzer
+{
+  using Limits = floatrange::Limits<F>;
+  typedef decltype (Limits::to (F ())) UInt;
+
+  const tracefile::Header &header;
+  const KeySpec &key;
+  const Filter &filter;
+
+  // Returns the ULP error of R (the largest one for two outputs functions)
+  // and whether it is a failure (as checkulps -f would report).
+  std::pair<double, bool>
+  evaluate (const tracefile::Record &r) const
+  {
+    double ulp = 0.0;
+    bool fail = false;
+    for (std::uint32_t i = 0; i < header.outputs && i < 2; i++)
+      {
+	F computed = Limits::from (static_cast<UInt> (r.computed[i]));
+	F expected = Limits::from (static_cast<UInt> (r.expected[i]));
+	F u = ulpError (computed, expected);
+	ulp = std::max (ulp, static_cast<double> (u));
+	fail |= !checkFullValue (computed, expected, u,
+				 static_cast<F> (filter.failureUlp));
+      }
+    return { ulp, fail };
+  }
+
+  double
+  keyOf (int rounding, double ulp, const tracefile::Record &r) const
+  {
+    switch (key.key)
+      {
+      case Key::ULP:
+	return ulp;
+      case Key::ROUNDING:
+	return rounding;
+      case Key::SIGN:
+	{
+	  F computed = Limits::from (static_cast<UInt> (r.computed[0]));
+	  F expected = Limits::from (static_cast<UInt> (r.expected[0]));
+	  return computed > expected ? 1.0 : computed < expected ? -1.0 : 0.0;
+	}
+      case Key::EXPONENT:
+	return binade (Limits::from (static_cast<UInt> (r.x)));
+      case Key::MANTISSA:
+	{
+	  constexpr int mantBits = std::numeric_limits<F>::digits - 1;
+	  return static_cast<double> ((r.x >> (mantBits - key.bits))
+				      & ((1U << key.bits) - 1));
+	}
+      case Key::ARG2:
+	if (header.arg2 == tracefile::ARG2_INTEGER)
+	  return static_cast<double> (static_cast<std::int64_t> (r.y));
+	return binade (Limits::from (static_cast<UInt> (r.y)));
+      }
+    std::unreachable ();
+  }
+
+  // Zero and non finite numbers are bucketed together, below all binades.
+  static double
+  binade (F x)
+  {
+    if (x == 0 || !std::isfinite (x))
+      return -std::numeric_limits<double>::infinity ();
+    return std::ilogb (x);
+  }
+
+  bool
+  accept (int rounding, double ulp, bool fail) const
+  {
+    if (!filter.roundModes.empty ()
+	&& std::find (filter.roundModes.begin (), filter.roundModes.end (),
+		      rounding)
+	       == filter.roundModes.end ())
+      return false;
+    if (filter.failuresOnly && !fail)
+      return false;
+    return ulp >= filter.minUlp && ulp <= filter.maxUlp;
+  }
+
+  std::string
+  format (const Match &m) const
+  {
+    auto f = [] (std::uint64_t v) {
+      return std::format ("{:#a}", Limits::from (static_cast<UInt> (v)));
+    };
+    std::string input = f (m.record.x);
+    if (header.arg2 == tracefile::ARG2_FLOAT)
+      input = std::format ("({},{})", input, f (m.record.y));
+    else if (header.arg2 == tracefile::ARG2_INTEGER)
+      input = std::format ("({},{})", input,
+			   static_cast<std::int64_t> (m.record.y));
+
+    std::string ret
+	= std::format ("{} ulp={:g} input={}", roundName (m.rounding), m.ulp,
+		       input);
+    for (std::uint32_t i = 0; i < header.outputs && i < 2; i++)
+      ret += std::format (" computed={} expected={}",
+			  f (m.record.computed[i]), f (m.record.expected[i]));
+    return ret;
+  }
+};
+
+static std::string
+keyLabel (const KeySpec &key, double k)
+{
+  if (key.key == Key::ROUNDING)
+    return std::string (roundName (static_cast<int> (k)));
+  if (std::isinf (k))
+    return "zero/inf/nan";
+  return std::format ("{:g}", k);
+}
+
+template <typename F>
+static void
+analyze (const std::vector<tracefile::Reader> &traces, const KeySpec &key,
+	 const Filter &filter, std::size_t top)
+{
+  // All the blocks from all the traces, to balance the decoding among the
+  // threads regardless of the per-thread trace sizes.
+  std::vector<std::pair<std::size_t, std::size_t> > blocks;
+  for (std::size_t t = 0; t < traces.size (); t++)
+    for (std::size_t b = 0; b < traces[t].blocks ().size (); b++)
+      blocks.push_back ({ t, b });
+
+  const Analyzer<F> analyzer{ traces[0].header (), key, filter };
+
+  Histogram histogram;
+  std::vector<Match> matches;
+  std::uint64_t total = 0;
+  bool corrupted = false;
+
+#pragma omp parallel
+  {
+    Histogram local;
+    std::vector<Match> localMatches;
+    std::vector<tracefile::Record> records;
+    std::uint64_t localTotal = 0;
+
+#pragma omp for schedule(dynamic)
+    for (std::size_t i = 0; i < blocks.size (); i++)
+      {
+	const auto &trace = traces[blocks[i].first];
+	const auto &block = trace.blocks ()[blocks[i].second];
+	if (!trace.decode (block, records))
+	  {
+#pragma omp atomic write
+	    corrupted = true;
+	    continue;
+	  }
+
+	localTotal += records.size ();
+	for (const auto &r : records)
+	  {
+	    auto [ulp, fail] = analyzer.evaluate (r);
+	    if (!analyzer.accept (block.rounding, ulp, fail))
+	      continue;
+
+	    auto &bucket = local[analyzer.keyOf (block.rounding, ulp, r)];
+	    bucket.count++;
+	    bucket.maxUlp = std::max (bucket.maxUlp, ulp);
+
+	    if (top > 0)
+	      localMatches.push_back (Match{ block.rounding, ulp, r });
+	  }
+
+	// Only the worst TOP matches are reported, so keep the buffer bounded.
+	if (localMatches.size () > 4 * top)
+	  {
+	    std::nth_element (localMatches.begin (),
+			      localMatches.begin () + top,
+			      localMatches.end (),
+			      [] (const Match &a, const Match &b) {
+				return a.ulp > b.ulp;
+			      });
+	    localMatches.resize (top);
+	  }
+      }
+
+#pragma omp critical
+    {
+      for (const auto &[k, b] : local)
+	{
+	  auto &bucket = histogram[k];
+	  bucket.count += b.count;
+	  bucket.maxUlp = std::max (bucket.maxUlp, b.maxUlp);
+	}
+      matches.insert (matches.end (), localMatches.begin (),
+		      localMatches.end ());
+      total += localTotal;
+    }
+  }
+
+  if (corrupted)
+    error ("corrupted trace block");
+
+  std::uint64_t selected = 0;
+  for (const auto &[k, b] : histogram)
+    selected += b.count;
+
+  std::println ("function {}, records {}, selected {}",
+		traces[0].header ().function, total, selected);
+  for (const auto &[k, b] : histogram)
+    std::println ("    {:>14}: {:16} {:6.2f}%  max ulp {:g}",
+		  keyLabel (key, k), b.count,
+		  ((double) b.count / (double) selected) * 100.0, b.maxUlp);
+
+  if (top > 0)
+    {
+      std::sort (matches.begin (), matches.end (),
+		 [] (const Match &a, const Match &b) {
+		   return a.ulp > b.ulp;
+		 });
+      if (matches.size () > top)
+	matches.resize (top);
+      std::println ("worst {} selected records:", matches.size ());
+      for (const auto &m : matches)
+	std::println ("    {}", analyzer.format (m));
+    }
+}
+
+// Expand the directories in PATHS to the .trace files they contain.
+static std::vector<std::string>
+traceFiles (const std::vector<std::string> &paths)
+{
+  std::vector<std::string> files;
+  for (const auto &p : paths)
+    {
+      if (!std::filesystem::is_directory (p))
+	{
+	  files.push_back (p);
+	  continue;
+	}
+      for (const auto &entry : std::filesystem::directory_iterator (p))
+	if (entry.path ().extension () == ".trace")
+	  files.push_back (entry.path ().string ());
+    }
+  std::sort (files.begin (), files.end ());
+  return files;
+}
+
+int
+main (int argc, char *argv[])
+{
+  argparse::ArgumentParser options ("ulpanalyze");
+
+  options.add_argument ("--histogram", "-H")
+      .help ("histogram key: ulp, rounding, sign, exponent, mantissa[:N] or "
+	     "arg2")
+      .default_value ("ulp");
+
+  options.add_argument ("--rounding", "-r")
+      .help ("only select the rounding modes (comma separated)");
+
+  options.add_argument ("--min-ulp")
+      .help ("only select records with at least this ULP error")
+      .default_value (0.0)
+      .scan<'g', double> ();
+
+  options.add_argument ("--max-ulp")
+      .help ("only select records with at most this ULP error")
+      .default_value (std::numeric_limits<double>::infinity ())
+      .scan<'g', double> ();
+
+  options.add_argument ("--failures")
+      .help ("only select the records that fail the check with the given "
+	     "max ULP (same semantic as checkulps -m)")
+      .scan<'g', double> ();
+
+  options.add_argument ("--top", "-t")
+      .help ("print the N selected records with the largest ULP error")
+      .default_value (std::size_t (0))
+      .scan<'u', std::size_t> ();
+
+  options.add_argument ("traces")
+      .help ("trace files or directories")
+      .nargs (argparse::nargs_pattern::at_least_one)
+      .required ();
+
+  try
+    {
+      options.parse_args (argc, argv);
+    }
+  catch (const std::runtime_error &err)
+    {
+      error (std::string (err.what ()));
+    }
+
+  const KeySpec key = keyFromOption (options.get<std::string> ("-H"));
+
+  Filter filter{ {},
+		 options.get<double> ("--min-ulp"),
+		 options.get<double> ("--max-ulp"),
+		 false,
+		 0.0 };
+  if (auto rnds = options.present ("-r"))
+    {
+      for (const auto &rnd : strhelper::splitWithRanges (*rnds, ","))
+	if (auto it = kRoundModes.find (rnd); it != kRoundModes.end ())
+	  filter.roundModes.push_back (it->second);
+	else
+	  error ("invalid rounding mode: {}", rnd);
+    }
+  if (auto failure = options.present<double> ("--failures"))
+    {
+      filter.failuresOnly = true;
+      filter.failureUlp = *failure;
+    }
+
+  std::vector<tracefile::Reader> traces;
+  for (const auto &f :
+       traceFiles (options.get<std::vector<std::string> > ("traces")))
+    {
+      auto r = tracefile::Reader::open (f);
+      if (!r)
+	error ("{}", r.error ());
+      if (!traces.empty ()
+	  && std::memcmp (&r->header (), &traces[0].header (),
+			  sizeof (tracefile::Header))
+		 != 0)
+	error ("{}: trace from a different function", f);
+      traces.push_back (std::move (r.value ()));
+    }
+  if (traces.empty ())
+    error ("no trace files found");
+
+  const std::size_t top = options.get<std::size_t> ("--top");
+  switch (traces[0].header ().floatBits)
+    {
+    case 32:
+      analyze<float> (traces, key, filter, top);
+      break;
+    case 64:
+      analyze<double> (traces, key, filter, top);
+      break;
+    default:
+      error ("unsupported float size: {}", traces[0].header ().floatBits);
+    }
+
+  return 0;
+}